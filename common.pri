@@ -7,3 +7,10 @@ macx {
     # Only Intel binaries are accepted so force this
     CONFIG += x86
 }
+
+# Fast compression of item data (optional)
+unix:packagesExist(libzstd) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+    DEFINES += HAS_ZSTD
+}
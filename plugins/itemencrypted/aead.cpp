@@ -0,0 +1,381 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "aead.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QVector>
+
+#if QT_VERSION >= 0x050A00
+#   include <QRandomGenerator>
+#elif defined(Q_OS_WIN)
+#   include <windows.h>
+#   include <wincrypt.h>
+#endif
+
+#include <cstring>
+
+const int aeadKeySize = 32;
+const int aeadNonceSize = 12;
+
+namespace {
+
+const int nonceSize = aeadNonceSize;
+const int tagSize = 16;
+const int blockSize = 64;
+
+quint32 load32(const uchar *p)
+{
+    return static_cast<quint32>(p[0])
+            | (static_cast<quint32>(p[1]) << 8)
+            | (static_cast<quint32>(p[2]) << 16)
+            | (static_cast<quint32>(p[3]) << 24);
+}
+
+void store32(uchar *p, quint32 v)
+{
+    p[0] = static_cast<uchar>(v);
+    p[1] = static_cast<uchar>(v >> 8);
+    p[2] = static_cast<uchar>(v >> 16);
+    p[3] = static_cast<uchar>(v >> 24);
+}
+
+void store64(uchar *p, quint64 v)
+{
+    store32(p, static_cast<quint32>(v));
+    store32(p + 4, static_cast<quint32>(v >> 32));
+}
+
+quint32 rotl(quint32 v, int c)
+{
+    return (v << c) | (v >> (32 - c));
+}
+
+void quarterRound(quint32 *x, int a, int b, int c, int d)
+{
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
+}
+
+class ChaCha20 {
+public:
+    ChaCha20(const uchar *key, const uchar *nonce, quint32 counter)
+    {
+        m_state[0] = 0x61707865;
+        m_state[1] = 0x3320646e;
+        m_state[2] = 0x79622d32;
+        m_state[3] = 0x6b206574;
+        for (int i = 0; i < 8; ++i)
+            m_state[4 + i] = load32(key + 4 * i);
+        m_state[12] = counter;
+        for (int i = 0; i < 3; ++i)
+            m_state[13 + i] = load32(nonce + 4 * i);
+    }
+
+    void block(uchar *out)
+    {
+        quint32 x[16];
+        std::memcpy(x, m_state, sizeof(x));
+
+        for (int i = 0; i < 10; ++i) {
+            quarterRound(x, 0, 4, 8, 12);
+            quarterRound(x, 1, 5, 9, 13);
+            quarterRound(x, 2, 6, 10, 14);
+            quarterRound(x, 3, 7, 11, 15);
+            quarterRound(x, 0, 5, 10, 15);
+            quarterRound(x, 1, 6, 11, 12);
+            quarterRound(x, 2, 7, 8, 13);
+            quarterRound(x, 3, 4, 9, 14);
+        }
+
+        for (int i = 0; i < 16; ++i)
+            store32(out + 4 * i, x[i] + m_state[i]);
+
+        ++m_state[12];
+    }
+
+    void xorData(const uchar *in, uchar *out, int size)
+    {
+        uchar keyStream[blockSize];
+        for (int i = 0; i < size; i += blockSize) {
+            block(keyStream);
+            const int n = qMin(blockSize, size - i);
+            for (int j = 0; j < n; ++j)
+                out[i + j] = in[i + j] ^ keyStream[j];
+        }
+    }
+
+private:
+    quint32 m_state[16];
+};
+
+/// Poly1305 with 26-bit limbs; all input is padded to whole blocks (as in RFC 8439 AEAD).
+class Poly1305 {
+public:
+    explicit Poly1305(const uchar *key)
+    {
+        m_r[0] = load32(key + 0) & 0x3ffffff;
+        m_r[1] = (load32(key + 3) >> 2) & 0x3ffff03;
+        m_r[2] = (load32(key + 6) >> 4) & 0x3ffc0ff;
+        m_r[3] = (load32(key + 9) >> 6) & 0x3f03fff;
+        m_r[4] = (load32(key + 12) >> 8) & 0x00fffff;
+
+        for (int i = 0; i < 5; ++i)
+            m_h[i] = 0;
+
+        for (int i = 0; i < 4; ++i)
+            m_pad[i] = load32(key + 16 + 4 * i);
+    }
+
+    /// Add data padded with zeros to multiple of 16 bytes.
+    void updatePadded(const uchar *data, int size)
+    {
+        int i = 0;
+        for ( ; i + 16 <= size; i += 16 )
+            block(data + i);
+
+        if (i < size) {
+            uchar last[16] = {};
+            std::memcpy(last, data + i, static_cast<size_t>(size - i));
+            block(last);
+        }
+    }
+
+    void finish(uchar *tag)
+    {
+        quint32 h0 = m_h[0], h1 = m_h[1], h2 = m_h[2], h3 = m_h[3], h4 = m_h[4];
+
+        quint32 c = h1 >> 26; h1 &= 0x3ffffff;
+        h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+        h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+        h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+
+        // Compute h - p and select it if it is not negative.
+        quint32 g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+        quint32 g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+        quint32 g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+        quint32 g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+        quint32 g4 = h4 + c - (1u << 26);
+
+        quint32 mask = (g4 >> 31) - 1;
+        g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+        mask = ~mask;
+        h0 = (h0 & mask) | g0;
+        h1 = (h1 & mask) | g1;
+        h2 = (h2 & mask) | g2;
+        h3 = (h3 & mask) | g3;
+        h4 = (h4 & mask) | g4;
+
+        h0 = h0 | (h1 << 26);
+        h1 = (h1 >> 6) | (h2 << 20);
+        h2 = (h2 >> 12) | (h3 << 14);
+        h3 = (h3 >> 18) | (h4 << 8);
+
+        quint64 f = static_cast<quint64>(h0) + m_pad[0];
+        store32(tag + 0, static_cast<quint32>(f));
+        f = static_cast<quint64>(h1) + m_pad[1] + (f >> 32);
+        store32(tag + 4, static_cast<quint32>(f));
+        f = static_cast<quint64>(h2) + m_pad[2] + (f >> 32);
+        store32(tag + 8, static_cast<quint32>(f));
+        f = static_cast<quint64>(h3) + m_pad[3] + (f >> 32);
+        store32(tag + 12, static_cast<quint32>(f));
+    }
+
+private:
+    void block(const uchar *m)
+    {
+        const quint32 r0 = m_r[0], r1 = m_r[1], r2 = m_r[2], r3 = m_r[3], r4 = m_r[4];
+        const quint32 s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+
+        quint32 h0 = m_h[0] + (load32(m + 0) & 0x3ffffff);
+        quint32 h1 = m_h[1] + ((load32(m + 3) >> 2) & 0x3ffffff);
+        quint32 h2 = m_h[2] + ((load32(m + 6) >> 4) & 0x3ffffff);
+        quint32 h3 = m_h[3] + ((load32(m + 9) >> 6) & 0x3ffffff);
+        quint32 h4 = m_h[4] + ((load32(m + 12) >> 8) | (1u << 24));
+
+        const quint64 d0 = mul(h0, r0) + mul(h1, s4) + mul(h2, s3) + mul(h3, s2) + mul(h4, s1);
+        quint64 d1 = mul(h0, r1) + mul(h1, r0) + mul(h2, s4) + mul(h3, s3) + mul(h4, s2);
+        quint64 d2 = mul(h0, r2) + mul(h1, r1) + mul(h2, r0) + mul(h3, s4) + mul(h4, s3);
+        quint64 d3 = mul(h0, r3) + mul(h1, r2) + mul(h2, r1) + mul(h3, r0) + mul(h4, s4);
+        quint64 d4 = mul(h0, r4) + mul(h1, r3) + mul(h2, r2) + mul(h3, r1) + mul(h4, r0);
+
+        quint32 c = static_cast<quint32>(d0 >> 26); h0 = static_cast<quint32>(d0) & 0x3ffffff;
+        d1 += c; c = static_cast<quint32>(d1 >> 26); h1 = static_cast<quint32>(d1) & 0x3ffffff;
+        d2 += c; c = static_cast<quint32>(d2 >> 26); h2 = static_cast<quint32>(d2) & 0x3ffffff;
+        d3 += c; c = static_cast<quint32>(d3 >> 26); h3 = static_cast<quint32>(d3) & 0x3ffffff;
+        d4 += c; c = static_cast<quint32>(d4 >> 26); h4 = static_cast<quint32>(d4) & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+
+        m_h[0] = h0; m_h[1] = h1; m_h[2] = h2; m_h[3] = h3; m_h[4] = h4;
+    }
+
+    static quint64 mul(quint32 a, quint32 b)
+    {
+        return static_cast<quint64>(a) * b;
+    }
+
+    quint32 m_r[5];
+    quint32 m_h[5];
+    quint32 m_pad[4];
+};
+
+void calculateTag(const uchar *key, const uchar *nonce, const uchar *additionalData, int additionalSize,
+                  const uchar *cipherText, int size, uchar *tag)
+{
+    uchar polyKey[blockSize];
+    ChaCha20(key, nonce, 0).block(polyKey);
+
+    Poly1305 poly(polyKey);
+    poly.updatePadded(additionalData, additionalSize);
+    poly.updatePadded(cipherText, size);
+
+    uchar lengths[16];
+    store64(lengths, static_cast<quint64>(additionalSize));
+    store64(lengths + 8, static_cast<quint64>(size));
+    poly.updatePadded(lengths, 16);
+
+    poly.finish(tag);
+}
+
+const uchar *constBytes(const QByteArray &bytes)
+{
+    return reinterpret_cast<const uchar*>(bytes.constData());
+}
+
+bool randomBytes(uchar *data, int size)
+{
+#if QT_VERSION >= 0x050A00
+    QVector<quint32> words( (size + 3) / 4 );
+    QRandomGenerator::system()->generate( words.begin(), words.end() );
+    std::memcpy( data, words.constData(), static_cast<size_t>(size) );
+    return true;
+#elif defined(Q_OS_WIN)
+    HCRYPTPROV provider;
+    if ( !CryptAcquireContext(&provider, nullptr, nullptr, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT | CRYPT_SILENT) )
+        return false;
+    const bool ok = CryptGenRandom( provider, static_cast<DWORD>(size), data );
+    CryptReleaseContext(provider, 0);
+    return ok;
+#else
+    QFile f("/dev/urandom");
+    return f.open(QIODevice::ReadOnly)
+            && f.read( reinterpret_cast<char*>(data), size ) == size;
+#endif
+}
+
+void encrypt(const uchar *key, const uchar *nonce, const QByteArray &additionalData,
+             const QByteArray &plainText, uchar *cipherText, uchar *tag)
+{
+    const int size = plainText.size();
+    ChaCha20(key, nonce, 1).xorData(constBytes(plainText), cipherText, size);
+    calculateTag( key, nonce, constBytes(additionalData), additionalData.size(), cipherText, size, tag );
+}
+
+bool decrypt(const uchar *key, const uchar *nonce, const QByteArray &additionalData,
+             const uchar *cipherText, int size, const uchar *tag, QByteArray *plainText)
+{
+    uchar expectedTag[tagSize];
+    calculateTag( key, nonce, constBytes(additionalData), additionalData.size(), cipherText, size, expectedTag );
+
+    // Compare in constant time.
+    uchar diff = 0;
+    for (int i = 0; i < tagSize; ++i)
+        diff |= expectedTag[i] ^ tag[i];
+    if (diff != 0)
+        return false;
+
+    plainText->resize(size);
+    ChaCha20(key, nonce, 1).xorData(cipherText, reinterpret_cast<uchar*>(plainText->data()), size);
+
+    return true;
+}
+
+} // namespace
+
+QByteArray generateAeadKey()
+{
+    QByteArray key(aeadKeySize, '\0');
+    if ( !randomBytes(reinterpret_cast<uchar*>(key.data()), key.size()) )
+        return QByteArray();
+    return key;
+}
+
+QByteArray aeadEncrypt(const QByteArray &key, const QByteArray &plainText)
+{
+    if (key.size() != aeadKeySize)
+        return QByteArray();
+
+    QByteArray result(nonceSize + plainText.size() + tagSize, '\0');
+    uchar *nonce = reinterpret_cast<uchar*>(result.data());
+    uchar *cipherText = nonce + nonceSize;
+    uchar *tag = cipherText + plainText.size();
+
+    if ( !randomBytes(nonce, nonceSize) )
+        return QByteArray();
+
+    encrypt( constBytes(key), nonce, QByteArray(), plainText, cipherText, tag );
+
+    return result;
+}
+
+QByteArray aeadEncrypt(const QByteArray &key, const QByteArray &nonce,
+                       const QByteArray &additionalData, const QByteArray &plainText)
+{
+    if (key.size() != aeadKeySize || nonce.size() != nonceSize)
+        return QByteArray();
+
+    QByteArray result(plainText.size() + tagSize, '\0');
+    uchar *cipherText = reinterpret_cast<uchar*>(result.data());
+    uchar *tag = cipherText + plainText.size();
+    encrypt( constBytes(key), constBytes(nonce), additionalData, plainText, cipherText, tag );
+
+    return result;
+}
+
+bool aeadDecrypt(const QByteArray &key, const QByteArray &cipherText, QByteArray *plainText)
+{
+    const int size = cipherText.size() - nonceSize - tagSize;
+    if (key.size() != aeadKeySize || size < 0)
+        return false;
+
+    const uchar *nonce = constBytes(cipherText);
+    const uchar *data = nonce + nonceSize;
+    const uchar *tag = data + size;
+
+    return decrypt( constBytes(key), nonce, QByteArray(), data, size, tag, plainText );
+}
+
+bool aeadDecrypt(const QByteArray &key, const QByteArray &nonce,
+                 const QByteArray &additionalData, const QByteArray &cipherText, QByteArray *plainText)
+{
+    const int size = cipherText.size() - tagSize;
+    if (key.size() != aeadKeySize || nonce.size() != nonceSize || size < 0)
+        return false;
+
+    const uchar *data = constBytes(cipherText);
+    const uchar *tag = data + size;
+
+    return decrypt( constBytes(key), constBytes(nonce), additionalData, data, size, tag, plainText );
+}
@@ -0,0 +1,63 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AEAD_H
+#define AEAD_H
+
+class QByteArray;
+
+/**
+ * Authenticated encryption with ChaCha20-Poly1305 (RFC 8439).
+ *
+ * Used to encrypt items in-process with a data key that only needs
+ * to be decrypted with GnuPG once.
+ */
+
+/// Size of key in bytes.
+extern const int aeadKeySize;
+
+/// Size of nonce in bytes.
+extern const int aeadNonceSize;
+
+/// Return random key or empty array if there is no secure random source.
+QByteArray generateAeadKey();
+
+/**
+ * Return random nonce followed by encrypted @a plainText and authentication tag.
+ *
+ * Returns empty array on failure.
+ */
+QByteArray aeadEncrypt(const QByteArray &key, const QByteArray &plainText);
+
+/// Return false if @a cipherText was modified or @a key is wrong.
+bool aeadDecrypt(const QByteArray &key, const QByteArray &cipherText, QByteArray *plainText);
+
+/**
+ * Return encrypted @a plainText followed by authentication tag (RFC 8439, section 2.8).
+ *
+ * The @a nonce must never be used again with the same key.
+ */
+QByteArray aeadEncrypt(const QByteArray &key, const QByteArray &nonce,
+                       const QByteArray &additionalData, const QByteArray &plainText);
+
+/// Decrypts output of aeadEncrypt() with given @a nonce and @a additionalData.
+bool aeadDecrypt(const QByteArray &key, const QByteArray &nonce,
+                 const QByteArray &additionalData, const QByteArray &cipherText, QByteArray *plainText);
+
+#endif // AEAD_H
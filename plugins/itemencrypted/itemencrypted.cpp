@@ -20,6 +20,8 @@
 #include "itemencrypted.h"
 #include "ui_itemencryptedsettings.h"
 
+#include "aead.h"
+
 #include "common/command.h"
 #include "common/config.h"
 #include "common/contenttype.h"
@@ -35,22 +37,37 @@
 #   include "tests/itemencryptedtests.h"
 #endif
 
+#include <QCryptographicHash>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
 #include <QIODevice>
 #include <QLabel>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
 #include <QTextEdit>
+#include <QThread>
+#include <QTimer>
 #include <QtPlugin>
 #include <QVBoxLayout>
 
+#include <vector>
+
 namespace {
 
 const char mimeEncryptedData[] = "application/x-copyq-encrypted";
 
 const char dataFileHeader[] = "CopyQ_encrypted_tab";
 const char dataFileHeaderV2[] = "CopyQ_encrypted_tab v2";
+// Items encrypted separately with data key.
+const char dataFileHeaderV3[] = "CopyQ_encrypted_tab v3";
 
 const int maxItemCount = 10000;
 
+const int gpgProcessTimeoutMs = 30000;
+
 struct KeyPairPaths {
     KeyPairPaths()
     {
@@ -167,6 +184,158 @@ QByteArray readGpgOutput(const QStringList &args, const QByteArray &input = QByt
     return p.readAllStandardOutput();
 }
 
+struct DataKey {
+    QByteArray key;
+    QByteArray encryptedKey;
+    /// Public keys used to encrypt the key (see keyringStamp()).
+    QString keyringStamp;
+};
+
+QMutex dataKeyMutex;
+
+/// Decrypted data keys (encrypted key -> key).
+QHash<QByteArray, QByteArray> &dataKeys()
+{
+    static QHash<QByteArray, QByteArray> keys;
+    return keys;
+}
+
+/// Data keys encrypted with GnuPG in this session (key -> last encrypted key).
+QHash<QByteArray, DataKey> &encryptedDataKeys()
+{
+    static QHash<QByteArray, DataKey> keys;
+    return keys;
+}
+
+DataKey &sessionDataKey()
+{
+    static DataKey key;
+    return key;
+}
+
+/// Changes if public key file is modified (e.g. new keys are generated).
+QString keyringStamp()
+{
+    const KeyPairPaths keys;
+    const QFileInfo info(keys.pub);
+    return QString("%1:%2")
+            .arg( info.lastModified().toMSecsSinceEpoch() )
+            .arg( info.size() );
+}
+
+/**
+ * Encrypts data key with GnuPG unless it was already encrypted with current
+ * public key.
+ *
+ * Lock is not held while GnuPG is running.
+ */
+bool encryptDataKey(DataKey *dataKey)
+{
+    const QString stamp = keyringStamp();
+    if ( dataKey->keyringStamp == stamp )
+        return true;
+
+    {
+        QMutexLocker lock(&dataKeyMutex);
+        const DataKey encryptedKey = encryptedDataKeys().value(dataKey->key);
+        if ( encryptedKey.keyringStamp == stamp ) {
+            *dataKey = encryptedKey;
+            return true;
+        }
+    }
+
+    COPYQ_LOG("ItemEncrypt: Encrypting data key");
+    const QByteArray encryptedKey = readGpgOutput(QStringList("--encrypt"), dataKey->key);
+    if ( encryptedKey.isEmpty() ) {
+        log("ItemEncrypt ERROR: Failed to encrypt data key", LogError);
+        return false;
+    }
+
+    dataKey->encryptedKey = encryptedKey;
+    dataKey->keyringStamp = stamp;
+
+    QMutexLocker lock(&dataKeyMutex);
+    dataKeys().insert(encryptedKey, dataKey->key);
+    encryptedDataKeys().insert(dataKey->key, *dataKey);
+    return true;
+}
+
+/**
+ * Returns key to encrypt new data with.
+ *
+ * GnuPG is used only once in a session to encrypt new key (and again only
+ * if public key changes).
+ */
+bool currentDataKey(DataKey *dataKey)
+{
+    {
+        QMutexLocker lock(&dataKeyMutex);
+        *dataKey = sessionDataKey();
+    }
+
+    if ( dataKey->key.isEmpty() ) {
+        dataKey->key = generateAeadKey();
+        if ( dataKey->key.isEmpty() ) {
+            log("ItemEncrypt ERROR: Failed to generate data key", LogError);
+            return false;
+        }
+    }
+
+    if ( !encryptDataKey(dataKey) )
+        return false;
+
+    QMutexLocker lock(&dataKeyMutex);
+    DataKey &sessionKey = sessionDataKey();
+    // Keep key created in other thread meanwhile.
+    if ( sessionKey.key.isEmpty() || sessionKey.key == dataKey->key )
+        sessionKey = *dataKey;
+
+    return true;
+}
+
+/// Returns data key decrypted earlier in the session or empty array.
+QByteArray cachedDataKey(const QByteArray &encryptedKey)
+{
+    QMutexLocker lock(&dataKeyMutex);
+    return dataKeys().value(encryptedKey);
+}
+
+/// Remembers data key decrypted with GnuPG; returns false if the key is not valid.
+bool addDataKey(const QByteArray &encryptedKey, const QByteArray &key)
+{
+    if ( key.size() != aeadKeySize ) {
+        log("ItemEncrypt ERROR: Failed to decrypt data key", LogError);
+        return false;
+    }
+
+    QMutexLocker lock(&dataKeyMutex);
+    dataKeys().insert(encryptedKey, key);
+    return true;
+}
+
+/// Returns decrypted data key; GnuPG is used only once in a session for each key.
+QByteArray decryptDataKey(const QByteArray &encryptedKey)
+{
+    const QByteArray cachedKey = cachedDataKey(encryptedKey);
+    if ( !cachedKey.isEmpty() )
+        return cachedKey;
+
+    const QByteArray key = readGpgOutput(QStringList("--decrypt"), encryptedKey);
+    if ( !addDataKey(encryptedKey, key) )
+        return QByteArray();
+
+    return key;
+}
+
+/// Digest to check if item changed (depends on the key so it doesn't identify the data).
+QByteArray itemDigest(const QByteArray &key, const QVariantMap &data)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(key);
+    hash.addData( serializeData(data) );
+    return hash.result();
+}
+
 bool keysExist()
 {
     return !readGpgOutput( QStringList("--list-keys") ).isEmpty();
@@ -179,7 +348,7 @@ bool decryptMimeData(QVariantMap *detinationData, const QModelIndex &index)
         return false;
 
     const QByteArray encryptedBytes = data.value(mimeEncryptedData).toByteArray();
-    const QByteArray bytes = readGpgOutput( QStringList() << "--decrypt", encryptedBytes );
+    const QByteArray bytes = readGpgOutput( QStringList("--decrypt"), encryptedBytes );
 
     return deserializeData(detinationData, bytes);
 }
@@ -187,7 +356,10 @@ bool decryptMimeData(QVariantMap *detinationData, const QModelIndex &index)
 void encryptMimeData(const QVariantMap &data, const QModelIndex &index, QAbstractItemModel *model)
 {
     const QByteArray bytes = serializeData(data);
-    const QByteArray encryptedBytes = readGpgOutput( QStringList("--encrypt"), bytes );
+    const QByteArray encryptedBytes = readGpgOutput(QStringList("--encrypt"), bytes);
+    if ( encryptedBytes.isEmpty() )
+        return;
+
     QVariantMap dataMap;
     dataMap.insert(mimeEncryptedData, encryptedBytes);
     model->setData(index, dataMap, contentType::data);
@@ -279,37 +451,64 @@ void ItemEncrypted::setModelData(QWidget *editor, QAbstractItemModel *model,
         encryptMimeData( createDataMap(mimeText, textEdit->toPlainText()), index, model );
 }
 
+ItemEncryptedSaver::ItemEncryptedSaver(const QByteArray &key, const QByteArray &encryptedKey)
+    : m_key(key)
+    , m_encryptedKey(encryptedKey)
+{
+}
+
 bool ItemEncryptedSaver::saveItems(const QString &, const QAbstractItemModel &model, QIODevice *file)
 {
     const auto length = model.rowCount();
     if (length == 0)
         return false; // No need to encode empty tab.
 
-    QByteArray bytes;
+    DataKey dataKey;
+    dataKey.key = m_key;
+    dataKey.encryptedKey = m_encryptedKey;
+    dataKey.keyringStamp = m_keyringStamp;
+    const bool hasKey = m_key.isEmpty()
+            ? currentDataKey(&dataKey)
+            : encryptDataKey(&dataKey);
+    if (!hasKey) {
+        emitEncryptFailed();
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to get data key");
+        return false;
+    }
+    m_key = dataKey.key;
+    m_encryptedKey = dataKey.encryptedKey;
+    m_keyringStamp = dataKey.keyringStamp;
 
-    {
-        QDataStream stream(&bytes, QIODevice::WriteOnly);
-        stream.setVersion(QDataStream::Qt_4_7);
+    QDataStream stream(file);
+    stream << QString(dataFileHeaderV3) << m_encryptedKey << static_cast<quint64>(length);
+
+    // Encrypt only new and changed items.
+    QHash<uint, EncryptedItem> encryptedItems;
+    for (int i = 0; i < length && stream.status() == QDataStream::Ok; ++i) {
+        const QModelIndex index = model.index(i, 0);
+        const uint itemHash = index.data(contentType::hash).toUInt();
+        const QVariantMap data = index.data(contentType::data).toMap();
 
-        stream << static_cast<quint64>(length);
+        EncryptedItem item;
+        item.digest = itemDigest(m_key, data);
 
-        for (int i = 0; i < length && stream.status() == QDataStream::Ok; ++i) {
-            QModelIndex index = model.index(i, 0);
-            const QVariantMap dataMap = index.data(contentType::data).toMap();
-            stream << dataMap;
+        const auto it = m_encryptedItems.constFind(itemHash);
+        if ( it != m_encryptedItems.constEnd() && it->digest == item.digest ) {
+            item.encryptedData = it->encryptedData;
+        } else {
+            item.encryptedData = aeadEncrypt( m_key, serializeData(data) );
+            if ( item.encryptedData.isEmpty() ) {
+                emitEncryptFailed();
+                COPYQ_LOG("ItemEncrypt ERROR: Failed to encrypt item");
+                return false;
+            }
         }
-    }
 
-    bytes = readGpgOutput(QStringList("--encrypt"), bytes);
-    if ( bytes.isEmpty() ) {
-        emitEncryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data");
-        return false;
+        stream << item.encryptedData;
+        encryptedItems.insert(itemHash, item);
     }
 
-    QDataStream stream(file);
-    stream << QString(dataFileHeaderV2);
-    stream.writeRawData( bytes.data(), bytes.size() );
+    m_encryptedItems = encryptedItems;
 
     if ( stream.status() != QDataStream::Ok ) {
         emitEncryptFailed();
@@ -320,6 +519,15 @@ bool ItemEncryptedSaver::saveItems(const QString &, const QAbstractItemModel &mo
     return true;
 }
 
+void ItemEncryptedSaver::addEncryptedItem(
+        uint itemHash, const QVariantMap &data, const QByteArray &encryptedData)
+{
+    EncryptedItem item;
+    item.digest = itemDigest(m_key, data);
+    item.encryptedData = encryptedData;
+    m_encryptedItems.insert(itemHash, item);
+}
+
 void ItemEncryptedSaver::emitEncryptFailed()
 {
     emit error( ItemEncryptedLoader::tr("Encryption failed!") );
@@ -327,18 +535,21 @@ void ItemEncryptedSaver::emitEncryptFailed()
 
 bool ItemEncryptedScriptable::isEncrypted()
 {
+    bool hasRow = false;
+
     const auto args = currentArguments();
     for (const auto &arg : args) {
         bool ok;
         const int row = arg.toInt(&ok);
         if (ok) {
             const auto result = call("read", QVariantList() << "?" << row);
-            if ( result.toByteArray().contains(mimeEncryptedData) )
-                return true;
+            if ( !result.toByteArray().contains(mimeEncryptedData) )
+                return false;
+            hasRow = true;
         }
     }
 
-    return false;
+    return hasRow;
 }
 
 QByteArray ItemEncryptedScriptable::encrypt()
@@ -397,6 +608,7 @@ void ItemEncryptedScriptable::encryptItems()
     const auto dataValueList = call("selectedItemsData").toList();
 
     QVariantList dataList;
+    QList<QByteArray> bytesList;
     for (const auto &itemDataValue : dataValueList) {
         auto itemData = itemDataValue.toMap();
 
@@ -409,13 +621,24 @@ void ItemEncryptedScriptable::encryptItems()
             }
         }
 
-        const auto bytes = call("pack", QVariantList() << itemDataToEncrypt).toByteArray();
-        const auto encryptedBytes = encrypt(bytes);
-        if (encryptedBytes.isEmpty())
+        bytesList.append( call("pack", QVariantList() << itemDataToEncrypt).toByteArray() );
+        dataList.append(itemData);
+    }
+
+    // Items are encrypted with GnuPG processes running in parallel.
+    const auto encryptedBytesList = readGpgOutputs(
+                QStringList("--encrypt"), bytesList, ItemEncryptedLoader::tr("Encrypting Items") );
+
+    for (int i = 0; i < dataList.size(); ++i) {
+        const auto &encryptedBytes = encryptedBytesList[i];
+        if ( encryptedBytes.isEmpty() ) {
+            eval("throw 'Failed to execute GPG!'");
             return;
-        itemData.insert(mimeEncryptedData, encryptedBytes);
+        }
 
-        dataList.append(itemData);
+        auto itemData = dataList[i].toMap();
+        itemData.insert(mimeEncryptedData, encryptedBytes);
+        dataList[i] = itemData;
     }
 
     call( "setSelectedItemsData", QVariantList() << QVariant(dataList) );
@@ -425,6 +648,16 @@ void ItemEncryptedScriptable::decryptItems()
 {
     const auto dataValueList = call("selectedItemsData").toList();
 
+    QList<QByteArray> encryptedBytesList;
+    for (const auto &itemDataValue : dataValueList) {
+        const auto encryptedBytes = itemDataValue.toMap().value(mimeEncryptedData).toByteArray();
+        if ( !encryptedBytes.isEmpty() )
+            encryptedBytesList.append(encryptedBytes);
+    }
+
+    const auto decryptedBytesList = decryptItemsData(encryptedBytesList);
+    int i = 0;
+
     QVariantList dataList;
     for (const auto &itemDataValue : dataValueList) {
         auto itemData = itemDataValue.toMap();
@@ -433,9 +666,11 @@ void ItemEncryptedScriptable::decryptItems()
         if ( !encryptedBytes.isEmpty() ) {
             itemData.remove(mimeEncryptedData);
 
-            const auto decryptedBytes = decrypt(encryptedBytes);
-            if (decryptedBytes.isEmpty())
+            const auto decryptedBytes = decryptedBytesList.value(i++);
+            if (decryptedBytes.isEmpty()) {
+                eval("throw 'Failed to decrypt data!'");
                 return;
+            }
 
             const auto decryptedItemData = call("unpack", QVariantList() << decryptedBytes).toMap();
             for (auto it = decryptedItemData.constBegin(); it != decryptedItemData.constEnd(); ++it)
@@ -451,6 +686,20 @@ void ItemEncryptedScriptable::decryptItems()
 void ItemEncryptedScriptable::copyEncryptedItems()
 {
     const auto dataValueList = call("selectedItemsData").toList();
+
+    QList<QByteArray> encryptedBytesList;
+    for (const auto &dataValue : dataValueList) {
+        const auto data = dataValue.toMap();
+        if ( !data.contains(mimeText) ) {
+            const auto encryptedBytes = data.value(mimeEncryptedData).toByteArray();
+            if ( !encryptedBytes.isEmpty() )
+                encryptedBytesList.append(encryptedBytes);
+        }
+    }
+
+    const auto decryptedBytesList = decryptItemsData(encryptedBytesList);
+    int i = 0;
+
     QString text;
     for (const auto &dataValue : dataValueList) {
         if ( !text.isEmpty() )
@@ -463,9 +712,11 @@ void ItemEncryptedScriptable::copyEncryptedItems()
         } else {
             const auto encryptedBytes = data.value(mimeEncryptedData).toByteArray();
             if ( !encryptedBytes.isEmpty() ) {
-                const auto itemData = decrypt(encryptedBytes);
-                if (itemData.isEmpty())
+                const auto itemData = decryptedBytesList.value(i++);
+                if (itemData.isEmpty()) {
+                    eval("throw 'Failed to decrypt data!'");
                     return;
+                }
                 const auto dataMap = call("unpack", QVariantList() << itemData).toMap();
                 text.append( getTextData(dataMap) );
             }
@@ -521,10 +772,114 @@ QByteArray ItemEncryptedScriptable::decrypt(const QByteArray &bytes)
 {
     const auto decryptedBytes = readGpgOutput(QStringList("--decrypt"), bytes);
     if ( decryptedBytes.isEmpty() )
-        eval("throw 'Failed to execute GPG!'");
+        eval("throw 'Failed to decrypt data!'");
     return decryptedBytes;
 }
 
+QList<QByteArray> ItemEncryptedScriptable::decryptItemsData(const QList<QByteArray> &encryptedBytesList)
+{
+    // Decrypt each distinct item only once.
+    QList<QByteArray> gpgInputs;
+    QSet<QByteArray> gpgInputSet;
+    for (const auto &bytes : encryptedBytesList) {
+        if ( !gpgInputSet.contains(bytes) ) {
+            gpgInputSet.insert(bytes);
+            gpgInputs.append(bytes);
+        }
+    }
+
+    const auto gpgOutputs = readGpgOutputs(
+                QStringList("--decrypt"), gpgInputs, ItemEncryptedLoader::tr("Decrypting Items") );
+    QHash<QByteArray, QByteArray> gpgInputToOutput;
+    for (int i = 0; i < gpgInputs.size(); ++i)
+        gpgInputToOutput.insert(gpgInputs[i], gpgOutputs.value(i));
+
+    QList<QByteArray> decryptedBytesList;
+    for (const auto &bytes : encryptedBytesList)
+        decryptedBytesList.append( gpgInputToOutput.value(bytes) );
+
+    return decryptedBytesList;
+}
+
+QList<QByteArray> ItemEncryptedScriptable::readGpgOutputs(
+        const QStringList &args, const QList<QByteArray> &inputs, const QString &progressTitle)
+{
+    const int count = inputs.size();
+    QList<QByteArray> outputs;
+    for (int i = 0; i < count; ++i)
+        outputs.append(QByteArray());
+
+    // Keep multiple GnuPG processes running; event loop passes input to and
+    // reads output from all of them until any finishes or times out.
+    const int maxProcessCount = qMax(1, QThread::idealThreadCount());
+    std::vector< std::unique_ptr<QProcess> > processes( static_cast<size_t>(count) );
+    std::vector<QElapsedTimer> startTimes( static_cast<size_t>(count) );
+
+    QEventLoop loop;
+    QTimer timerTimeout;
+    timerTimeout.setSingleShot(true);
+    connect( &timerTimeout, SIGNAL(timeout()), &loop, SLOT(quit()) );
+
+    int startedCount = 0;
+    int finishedCount = 0;
+    while (finishedCount < count) {
+        for ( ; startedCount < count && startedCount - finishedCount < maxProcessCount; ++startedCount ) {
+            const auto i = static_cast<size_t>(startedCount);
+            processes[i].reset(new QProcess);
+            QProcess *p = processes[i].get();
+            connect( p, SIGNAL(finished(int,QProcess::ExitStatus)), &loop, SLOT(quit()) );
+#if QT_VERSION < 0x050600
+            connect( p, SIGNAL(error(QProcess::ProcessError)), &loop, SLOT(quit()) );
+#else
+            connect( p, SIGNAL(errorOccurred(QProcess::ProcessError)), &loop, SLOT(quit()) );
+#endif
+            startGpgProcess( p, args );
+            p->write(inputs[startedCount]);
+            p->closeWriteChannel();
+            startTimes[i].start();
+        }
+
+        int nextTimeoutMs = gpgProcessTimeoutMs;
+        for (int j = 0; j < startedCount; ++j) {
+            auto &p = processes[static_cast<size_t>(j)];
+            if (!p)
+                continue;
+
+            const qint64 elapsedMs = startTimes[static_cast<size_t>(j)].elapsed();
+            if ( p->state() == QProcess::NotRunning ) {
+                if ( verifyProcess(p.get()) )
+                    outputs[j] = p->readAllStandardOutput();
+            } else if (elapsedMs >= gpgProcessTimeoutMs) {
+                log( QString("ItemEncrypt ERROR: GnuPG process timed out after %1 ms")
+                     .arg(gpgProcessTimeoutMs), LogError );
+                p->kill();
+                p->waitForFinished();
+            } else {
+                nextTimeoutMs = qMin( nextTimeoutMs, static_cast<int>(gpgProcessTimeoutMs - elapsedMs) );
+                continue;
+            }
+
+            p.reset();
+            ++finishedCount;
+
+            if (count > 1) {
+                call( "notification", QVariantList()
+                      << ".id" << "itemencrypted-progress"
+                      << ".title" << progressTitle
+                      << ".message" << QString("%1/%2").arg(finishedCount).arg(count)
+                      << ".time" << 2000 );
+            }
+        }
+
+        if ( finishedCount < startedCount ) {
+            timerTimeout.start(nextTimeoutMs);
+            loop.exec();
+        }
+    }
+
+    return outputs;
+}
+
 ItemEncryptedLoader::ItemEncryptedLoader()
     : ui()
     , m_settings()
@@ -605,7 +960,7 @@ bool ItemEncryptedLoader::canLoadItems(QIODevice *file) const
     stream >> header;
 
     return stream.status() == QDataStream::Ok
-            && (header == dataFileHeader || header == dataFileHeaderV2);
+            && (header == dataFileHeader || header == dataFileHeaderV2 || header == dataFileHeaderV3);
 }
 
 bool ItemEncryptedLoader::canSaveItems(const QString &tabName) const
@@ -637,8 +992,15 @@ bool ItemEncryptedLoader::canSaveItems(const QString &tabName) const
 
 ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &, QAbstractItemModel *model, QIODevice *file, int maxItems)
 {
-    // This is needed to skip header.
-    if ( !canLoadItems(file) )
+    QDataStream stream(file);
+
+    QString header;
+    stream >> header;
+    if ( stream.status() != QDataStream::Ok )
+        return nullptr;
+
+    const bool encryptedItems = header == dataFileHeaderV3;
+    if ( !encryptedItems && header != dataFileHeader && header != dataFileHeaderV2 )
         return nullptr;
 
     if (m_gpgProcessStatus == GpgNotInstalled) {
@@ -648,12 +1010,14 @@ ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &, QAbstractItemModel
 
     importGpgKey();
 
+    if (encryptedItems)
+        return loadEncryptedItems(model, file, maxItems);
+
     QProcess p;
     startGpgProcess( &p, QStringList("--decrypt") );
 
     char encryptedBytes[4096];
 
-    QDataStream stream(file);
     while ( !stream.atEnd() ) {
         const int bytesRead = stream.readRawData(encryptedBytes, 4096);
         if (bytesRead == -1) {
@@ -710,6 +1074,63 @@ ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &, QAbstractItemModel
     return createSaver();
 }
 
+ItemSaverPtr ItemEncryptedLoader::loadEncryptedItems(QAbstractItemModel *model, QIODevice *file, int maxItems)
+{
+    QDataStream stream(file);
+
+    QByteArray encryptedKey;
+    quint64 length;
+    stream >> encryptedKey >> length;
+    if ( length <= 0 || stream.status() != QDataStream::Ok ) {
+        emitDecryptFailed();
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to parse item count!");
+        return nullptr;
+    }
+
+    // Only the data key is decrypted with GnuPG (once per session).
+    const QByteArray key = decryptDataKey(encryptedKey);
+    if ( key.isEmpty() ) {
+        emitDecryptFailed();
+        return nullptr;
+    }
+
+    auto saver = createSaver(key, encryptedKey);
+
+    length = qMin(length, static_cast<quint64>(maxItems)) - static_cast<quint64>(model->rowCount());
+
+    const auto count = length < maxItemCount ? static_cast<int>(length) : maxItemCount;
+    for ( int i = 0; i < count; ++i ) {
+        QByteArray encryptedBytes;
+        stream >> encryptedBytes;
+
+        QByteArray bytes;
+        QVariantMap dataMap;
+        if ( stream.status() != QDataStream::Ok
+             || !aeadDecrypt(key, encryptedBytes, &bytes)
+             || !deserializeData(&dataMap, bytes) )
+        {
+            emitDecryptFailed();
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
+            return nullptr;
+        }
+
+        if ( !model->insertRow(i) ) {
+            emitDecryptFailed();
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to insert item!");
+            return nullptr;
+        }
+
+        const QModelIndex index = model->index(i, 0);
+        model->setData(index, dataMap, contentType::data);
+        saver->addEncryptedItem(
+                    index.data(contentType::hash).toUInt(),
+                    index.data(contentType::data).toMap(),
+                    encryptedBytes );
+    }
+
+    return saver;
+}
+
 ItemSaverPtr ItemEncryptedLoader::initializeTab(const QString &, QAbstractItemModel *, int)
 {
     if (m_gpgProcessStatus == GpgNotInstalled)
@@ -721,7 +1142,11 @@ ItemSaverPtr ItemEncryptedLoader::initializeTab(const QString &, QAbstractItemMo
 QObject *ItemEncryptedLoader::tests(const TestInterfacePtr &test) const
 {
 #ifdef HAS_TESTS
+    QVariantMap settings;
+    settings["encrypt_tabs"] = QStringList() << ItemEncryptedTests::testTab(1);
+
     QObject *tests = new ItemEncryptedTests(test);
+    tests->setProperty("CopyQ_test_settings", settings);
     return tests;
 #else
     Q_UNUSED(test);
@@ -885,9 +1310,10 @@ void ItemEncryptedLoader::emitDecryptFailed()
     emit error( tr("Decryption failed!") );
 }
 
-ItemSaverPtr ItemEncryptedLoader::createSaver()
+std::shared_ptr<ItemEncryptedSaver> ItemEncryptedLoader::createSaver(
+        const QByteArray &key, const QByteArray &encryptedKey)
 {
-    auto saver = std::make_shared<ItemEncryptedSaver>();
+    auto saver = std::make_shared<ItemEncryptedSaver>(key, encryptedKey);
     connect( saver.get(), SIGNAL(error(QString)),
              this, SIGNAL(error(QString)) );
     return saver;
@@ -23,7 +23,9 @@
 #include "item/itemwidget.h"
 #include "gui/icons.h"
 
+#include <QHash>
 #include <QProcess>
+#include <QVariantMap>
 #include <QWidget>
 
 #include <memory>
@@ -52,13 +54,40 @@ class ItemEncryptedSaver : public QObject, public ItemSaverInterface
     Q_OBJECT
 
 public:
+    /**
+     * Items are encrypted with data @a key which is saved encrypted with GnuPG
+     * (@a encryptedKey) in tab file. If the key is empty, key for current
+     * session is used.
+     *
+     * The data key is encrypted again on first save and whenever GnuPG keys
+     * change.
+     */
+    explicit ItemEncryptedSaver(
+            const QByteArray &key = QByteArray(), const QByteArray &encryptedKey = QByteArray());
+
     bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file) override;
 
+    bool isEncrypted() const override { return true; }
+
+    /// Reuse encrypted data when saving unchanged item.
+    void addEncryptedItem(uint itemHash, const QVariantMap &data, const QByteArray &encryptedData);
+
 signals:
     void error(const QString &);
 
 private:
+    struct EncryptedItem {
+        /// Keyed digest of item data (plain data are not kept in memory).
+        QByteArray digest;
+        QByteArray encryptedData;
+    };
+
     void emitEncryptFailed();
+
+    QByteArray m_key;
+    QByteArray m_encryptedKey;
+    QString m_keyringStamp;
+    QHash<uint, EncryptedItem> m_encryptedItems;
 };
 
 class ItemEncryptedScriptable : public ItemScriptable
@@ -86,6 +115,17 @@ public slots:
 private:
     QByteArray encrypt(const QByteArray &bytes);
     QByteArray decrypt(const QByteArray &bytes);
+
+    /// Decrypts items running GnuPG in parallel.
+    QList<QByteArray> decryptItemsData(const QList<QByteArray> &encryptedBytesList);
+
+    /**
+     * Runs GnuPG in parallel for each input and shows progress.
+     *
+     * Output is empty for inputs which failed or timed out.
+     */
+    QList<QByteArray> readGpgOutputs(
+            const QStringList &args, const QList<QByteArray> &inputs, const QString &progressTitle);
 };
 
 class ItemEncryptedLoader : public QObject, public ItemLoaderInterface
@@ -153,7 +193,10 @@ private:
 
     void emitDecryptFailed();
 
-    ItemSaverPtr createSaver();
+    ItemSaverPtr loadEncryptedItems(QAbstractItemModel *model, QIODevice *file, int maxItems);
+
+    std::shared_ptr<ItemEncryptedSaver> createSaver(
+            const QByteArray &key = QByteArray(), const QByteArray &encryptedKey = QByteArray());
 
     std::unique_ptr<Ui::ItemEncryptedSettings> ui;
     QVariantMap m_settings;
@@ -1,8 +1,10 @@
 include(../plugins_common.pri)
 
 HEADERS += itemencrypted.h \
+    aead.h \
     ../../src/gui/iconwidget.h
-SOURCES += itemencrypted.cpp
+SOURCES += itemencrypted.cpp \
+    aead.cpp
 SOURCES += \
     ../../src/common/config.cpp \
     ../../src/common/log.cpp \
@@ -14,6 +16,9 @@ SOURCES += \
     ../../src/item/serialize.cpp
 FORMS   += itemencryptedsettings.ui
 
+# CryptGenRandom() is used with Qt older than 5.10.
+win32: LIBS += -ladvapi32
+
 CONFIG(debug, debug|release) {
     SOURCES += tests/itemencryptedtests.cpp
     HEADERS += tests/itemencryptedtests.h
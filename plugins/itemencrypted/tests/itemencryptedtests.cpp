@@ -19,6 +19,8 @@
 
 #include "itemencryptedtests.h"
 
+#include "../aead.h"
+
 #include "tests/test_utils.h"
 
 ItemEncryptedTests::ItemEncryptedTests(const TestInterfacePtr &test, QObject *parent)
@@ -27,6 +29,11 @@ ItemEncryptedTests::ItemEncryptedTests(const TestInterfacePtr &test, QObject *pa
 {
 }
 
+QString ItemEncryptedTests::testTab(int i)
+{
+    return ::testTab(i);
+}
+
 void ItemEncryptedTests::initTestCase()
 {
     if ( qgetenv("COPYQ_TESTS_SKIP_ITEMENCRYPT") == "1" )
@@ -50,6 +57,44 @@ void ItemEncryptedTests::cleanup()
     TEST( m_test->cleanup() );
 }
 
+void ItemEncryptedTests::aeadKnownAnswer()
+{
+    // Test vector from RFC 8439, section 2.8.2.
+    const QByteArray key = QByteArray::fromHex(
+                "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f");
+    const QByteArray nonce = QByteArray::fromHex("070000004041424344454647");
+    const QByteArray additionalData = QByteArray::fromHex("50515253c0c1c2c3c4c5c6c7");
+    const QByteArray plainText =
+            "Ladies and Gentlemen of the class of '99: If I could offer you only one tip"
+            " for the future, sunscreen would be it.";
+    const QByteArray cipherText = QByteArray::fromHex(
+                "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+                "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+                "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+                "3ff4def08e4b7a9de576d26586cec64b6116");
+    const QByteArray tag = QByteArray::fromHex("1ae10b594f09e26a7e902ecbd0600691");
+
+    QCOMPARE( aeadEncrypt(key, nonce, additionalData, plainText).toHex(), (cipherText + tag).toHex() );
+
+    QByteArray decrypted;
+    QVERIFY( aeadDecrypt(key, nonce, additionalData, cipherText + tag, &decrypted) );
+    QCOMPARE(decrypted, plainText);
+
+    // Modified data is rejected.
+    QByteArray modified = cipherText + tag;
+    modified[0] = static_cast<char>(modified[0] ^ 1);
+    QVERIFY( !aeadDecrypt(key, nonce, additionalData, modified, &decrypted) );
+    QVERIFY( !aeadDecrypt(key, nonce, QByteArray("X"), cipherText + tag, &decrypted) );
+
+    // Random nonce is prepended.
+    const QByteArray randomKey = generateAeadKey();
+    QCOMPARE( randomKey.size(), aeadKeySize );
+    const QByteArray encrypted = aeadEncrypt(randomKey, plainText);
+    QCOMPARE( encrypted.size(), aeadNonceSize + plainText.size() + tag.size() );
+    QVERIFY( aeadDecrypt(randomKey, encrypted, &decrypted) );
+    QCOMPARE(decrypted, plainText);
+}
+
 void ItemEncryptedTests::encryptDecryptData()
 {
     if ( !isGpgInstalled() )
@@ -72,6 +117,84 @@ void ItemEncryptedTests::encryptDecryptData()
     QCOMPARE(stdoutActual, input);
 }
 
+void ItemEncryptedTests::encryptTab()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("-e" << "plugins.itemencrypted.generateTestKeys()", "\n");
+
+    const Args args = Args("tab") << testTab(1) << "separator" << ",";
+    RUN(args << "add" << "A" << "B" << "C", "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "0" << "1" << "2", "C,B,A");
+
+    // Tab with new and changed item is saved.
+    RUN(args << "add" << "D", "");
+    RUN(args << "change" << "2" << "text/plain" << "X", "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "0" << "1" << "2" << "3", "D,C,X,A");
+}
+
+void ItemEncryptedTests::encryptDecryptItems()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("-e" << "plugins.itemencrypted.generateTestKeys()", "\n");
+
+    const auto script = R"(
+        setCommands([
+            {
+                name: 'Encrypt',
+                inMenu: true,
+                shortcuts: ['Ctrl+F1'],
+                cmd: 'copyq: plugins.itemencrypted.encryptItems()'
+            },
+            {
+                name: 'Decrypt',
+                inMenu: true,
+                shortcuts: ['Ctrl+F2'],
+                cmd: 'copyq: plugins.itemencrypted.decryptItems()'
+            },
+        ])
+        )";
+    RUN(script, "");
+
+    // Encrypted data of big item don't fit into pipe buffer of GnuPG process.
+    const auto addBigItem = R"(
+        var text = '';
+        while (text.length < 500000)
+            text += Math.random().toString(36);
+        add(text.substr(0, 500000));
+        )";
+    RUN(addBigItem, "");
+
+    RUN("add" << "C" << "B" << "A", "");
+    RUN("selectItems" << "0" << "1" << "2" << "3", "true\n");
+
+    RUN("keys" << "CTRL+F1", "");
+    WAIT_ON_OUTPUT("-e" << "plugins.itemencrypted.isEncrypted(0, 1, 2, 3)", "true\n");
+    RUN("read" << "0", "");
+
+    // All items must be encrypted.
+    RUN("add" << "D", "");
+    RUN("-e" << "plugins.itemencrypted.isEncrypted(0, 1)", "false\n");
+    RUN("-e" << "plugins.itemencrypted.isEncrypted(1)", "true\n");
+
+    // Items are decrypted with GnuPG processes running in parallel.
+    RUN("selectItems" << "1" << "2" << "3" << "4", "true\n");
+    RUN("keys" << "CTRL+F2", "");
+    WAIT_ON_OUTPUT("separator" << "," << "read" << "0" << "1" << "2" << "3", "D,A,B,C");
+    WAIT_ON_OUTPUT("-e" << "read(4).length", "500000\n");
+}
+
 bool ItemEncryptedTests::isGpgInstalled() const
 {
     QByteArray actualStdout;
@@ -30,14 +30,22 @@ class ItemEncryptedTests : public QObject
 public:
     explicit ItemEncryptedTests(const TestInterfacePtr &test, QObject *parent = nullptr);
 
+    static QString testTab(int i);
+
 private slots:
     void initTestCase();
     void cleanupTestCase();
     void init();
     void cleanup();
 
+    void aeadKnownAnswer();
+
     void encryptDecryptData();
 
+    void encryptTab();
+
+    void encryptDecryptItems();
+
 private:
     bool isGpgInstalled() const;
 
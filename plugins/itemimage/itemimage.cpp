@@ -23,17 +23,45 @@
 #include "common/contenttype.h"
 #include "item/itemeditor.h"
 
+#ifdef HAS_TESTS
+#   include "tests/itemimagetests.h"
+#endif
+
+#include <QAbstractItemModel>
 #include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QHBoxLayout>
+#include <QImageReader>
 #include <QModelIndex>
 #include <QMovie>
 #include <QPainter>
 #include <QPixmap>
+#include <QThread>
+#include <QTimer>
 #include <QtPlugin>
 #include <QVariant>
 
+#if QT_VERSION < 0x050000
+#   include <QDesktopServices>
+#else
+#   include <QStandardPaths>
+#endif
+
 namespace {
 
+/// Size of scaled images kept in memory (in KiB).
+const int maxThumbnailCacheCost = 64 * 1024;
+
+const qint64 maxDiskCacheSize = 100 * 1024 * 1024;
+
+/// Delay to remove old thumbnails from disk after new ones are saved.
+const int pruneDiskCacheDelayMs = 30000;
+
+/// Model property set for encrypted tabs.
+const char propertyNoDiskCache[] = "CopyQ_itemimage_no_disk_cache";
+
 QString findImageFormat(const QList<QString> &formats)
 {
     // Check formats in this order.
@@ -81,16 +109,41 @@ bool getAnimatedImageData(const QModelIndex &index, QByteArray *data, QByteArray
     return false;
 }
 
-bool getPixmapFromData(const QModelIndex &index, QPixmap *pix)
+/// Returns image size without decoding whole image.
+QSize imageSize(const QByteArray &data)
 {
-    QString mime;
-    QByteArray data;
-    if ( !getImageData(index, &data, &mime) )
-        return false;
+    QByteArray bytes = data;
+    QBuffer buffer(&bytes);
+    QImageReader reader(&buffer);
+    return reader.size();
+}
 
-    pix->loadFromData( data, mime.toLatin1() );
+QSize scaledImageSize(QSize size, int w, int h)
+{
+    if ( w > 0 && size.width() > w && (h <= 0 || 1.0 * size.width()/w > 1.0 * size.height()/h) )
+        return QSize( w, qMax(1, size.height() * w / size.width()) );
 
-    return true;
+    if ( h > 0 && size.height() > h )
+        return QSize( qMax(1, size.width() * h / size.height()), h );
+
+    return size;
+}
+
+uint thumbnailItemHash(const QString &key)
+{
+    return key.section('_', 0, 0).toUInt(nullptr, 16);
+}
+
+QPixmap placeholderPixmap(QSize size, const QPalette &palette)
+{
+    if ( !size.isValid() )
+        return QPixmap();
+
+    QPixmap pix(size);
+    QColor color = palette.color(QPalette::Mid);
+    color.setAlpha(64);
+    pix.fill(color);
+    return pix;
 }
 
 } // namespace
@@ -160,6 +213,18 @@ void ItemImage::setCurrent(bool current)
     }
 }
 
+void ItemImage::setThumbnail(const QPixmap &pixmap)
+{
+    m_pixmap = pixmap;
+#if QT_VERSION >= 0x050000
+    m_pixmap.setDevicePixelRatio( devicePixelRatio() );
+#endif
+
+    if ( !movie() )
+        setPixmap(m_pixmap);
+    updateSize(QSize(), 0);
+}
+
 void ItemImage::showEvent(QShowEvent *event)
 {
     startAnimation();
@@ -202,7 +267,305 @@ void ItemImage::stopAnimation()
         movie()->stop();
 }
 
+ImageThumbnailTask::ImageThumbnailTask(
+        const QString &key, const QByteArray &data, QSize size, QSize maxSize,
+        const QString &cacheFileName)
+    : m_key(key)
+    , m_data(data)
+    , m_size(size)
+    , m_maxSize(maxSize)
+    , m_cacheFileName(cacheFileName)
+{
+    setAutoDelete(false);
+}
+
+void ImageThumbnailTask::run()
+{
+    QImage image;
+
+    if ( !m_cacheFileName.isEmpty() && image.load(m_cacheFileName, "PNG")
+         && (!m_size.isValid() || image.size() == m_size) )
+    {
+        emit thumbnailLoaded(m_key, image);
+        return;
+    }
+
+    QBuffer buffer(&m_data);
+    QImageReader reader(&buffer);
+    if ( m_size.isValid() && reader.size() != m_size )
+        reader.setScaledSize(m_size);
+    image = reader.read();
+
+    // Scale image if its size was unknown before decoding.
+    if ( !m_size.isValid() && !image.isNull() ) {
+        const QSize size = scaledImageSize( image.size(), m_maxSize.width(), m_maxSize.height() );
+        if ( size != image.size() )
+            image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    if ( !image.isNull() && !m_cacheFileName.isEmpty() ) {
+        const QString tmpFileName = m_cacheFileName + ".tmp";
+        if ( image.save(tmpFileName, "PNG") ) {
+            QFile::remove(m_cacheFileName);
+            QFile::rename(tmpFileName, m_cacheFileName);
+        }
+    }
+
+    emit thumbnailLoaded(m_key, image);
+}
+
+ImageThumbnailCache::ImageThumbnailCache()
+    : m_thumbnails(maxThumbnailCacheCost)
+{
+    m_threadPool.setMaxThreadCount( qMax(1, QThread::idealThreadCount() / 2) );
+
+    m_timerPruneDiskCache.setSingleShot(true);
+    m_timerPruneDiskCache.setInterval(pruneDiskCacheDelayMs);
+    connect( &m_timerPruneDiskCache, SIGNAL(timeout()),
+             this, SLOT(pruneDiskCache()) );
+}
+
+ImageThumbnailCache::~ImageThumbnailCache()
+{
+    m_threadPool.waitForDone();
+}
+
+QString ImageThumbnailCache::thumbnailKey(uint itemHash, const QByteArray &data, QSize imageSize, QSize size)
+{
+    // Item hash alone is too weak to identify cached file.
+    return QString("%1_%2_%3x%4_%5x%6")
+            .arg(itemHash, 8, 16, QChar('0'))
+            .arg(data.size())
+            .arg(imageSize.width())
+            .arg(imageSize.height())
+            .arg(size.width())
+            .arg(size.height());
+}
+
+void ImageThumbnailCache::setDiskCacheEnabled(bool enabled)
+{
+    if (!enabled) {
+        setDiskCachePath(QString());
+        return;
+    }
+
+#if QT_VERSION < 0x050000
+    const QString cachePath = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#else
+    const QString cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#endif
+    setDiskCachePath(cachePath + "/thumbnails");
+}
+
+void ImageThumbnailCache::setDiskCachePath(const QString &path)
+{
+    m_diskCachePath = path;
+    if ( m_diskCachePath.isEmpty() )
+        return;
+
+    QDir().mkpath(m_diskCachePath);
+    pruneDiskCache();
+}
+
+QPixmap ImageThumbnailCache::thumbnail(const QString &key) const
+{
+    const QPixmap *pixmap = m_thumbnails.object(key);
+    return pixmap ? *pixmap : QPixmap();
+}
+
+void ImageThumbnailCache::loadThumbnail(
+        ItemImage *item, const QString &key, const QByteArray &data,
+        QSize size, QSize maxSize, bool useDiskCache)
+{
+    auto it = m_pending.find(key);
+    if ( it != m_pending.end() ) {
+        it->append(item);
+        return;
+    }
+
+    m_pending[key].append(item);
+
+    const QString fileName = useDiskCache ? cacheFileName(key) : QString();
+    if ( !fileName.isEmpty() )
+        m_timerPruneDiskCache.start();
+
+    auto task = new ImageThumbnailTask(key, data, size, maxSize, fileName);
+    connect( task, SIGNAL(thumbnailLoaded(QString,QImage)),
+             this, SLOT(onThumbnailLoaded(QString,QImage)) );
+    connect( task, SIGNAL(thumbnailLoaded(QString,QImage)),
+             task, SLOT(deleteLater()) );
+
+    m_threadPool.start(task);
+}
+
+void ImageThumbnailCache::removeThumbnails(const QSet<uint> &itemHashes)
+{
+    if ( itemHashes.isEmpty() )
+        return;
+
+    for ( const auto &key : m_thumbnails.keys() ) {
+        if ( itemHashes.contains(thumbnailItemHash(key)) )
+            m_thumbnails.remove(key);
+    }
+
+    for ( const auto &key : m_pending.keys() ) {
+        if ( itemHashes.contains(thumbnailItemHash(key)) )
+            m_removedPending.insert(key);
+    }
+
+    if ( m_diskCachePath.isEmpty() )
+        return;
+
+    QDir dir(m_diskCachePath);
+    for ( const auto &fileName : dir.entryList(QStringList("*.png"), QDir::Files) ) {
+        if ( itemHashes.contains(thumbnailItemHash(fileName)) )
+            dir.remove(fileName);
+    }
+}
+
+void ImageThumbnailCache::onThumbnailLoaded(const QString &key, const QImage &image)
+{
+    const auto items = m_pending.take(key);
+
+    // Item was removed while loading thumbnail (other items can still wait for it).
+    const bool isRemoved = m_removedPending.remove(key);
+    if (isRemoved) {
+        const QString fileName = cacheFileName(key);
+        if ( !fileName.isEmpty() )
+            QFile::remove(fileName);
+    }
+
+    if ( image.isNull() )
+        return;
+
+    const QPixmap pixmap = QPixmap::fromImage(image);
+
+    if (!isRemoved) {
+#if QT_VERSION >= 0x050a00
+        const qint64 bytes = image.sizeInBytes();
+#else
+        const qint64 bytes = image.byteCount();
+#endif
+        const int cost = static_cast<int>( qMax<qint64>(1, bytes / 1024) );
+        m_thumbnails.insert( key, new QPixmap(pixmap), cost );
+    }
+
+    for (const auto &item : items) {
+        if (item)
+            item->setThumbnail(pixmap);
+    }
+}
+
+void ImageThumbnailCache::pruneDiskCache()
+{
+    if ( m_diskCachePath.isEmpty() )
+        return;
+
+    const QDir dir(m_diskCachePath);
+    qint64 size = 0;
+    for ( const auto &fileInfo : dir.entryInfoList(QDir::Files, QDir::Time) ) {
+        size += fileInfo.size();
+        if (size > maxDiskCacheSize)
+            QFile::remove( fileInfo.absoluteFilePath() );
+    }
+}
+
+QString ImageThumbnailCache::cacheFileName(const QString &key) const
+{
+    return m_diskCachePath.isEmpty()
+            ? QString()
+            : m_diskCachePath + "/" + key + ".png";
+}
+
+ItemImageSaver::ItemImageSaver(
+        QAbstractItemModel *model, const ItemSaverPtr &saver,
+        const std::shared_ptr<ImageThumbnailCache> &thumbnails)
+    : m_model(model)
+    , m_saver(saver)
+    , m_thumbnails(thumbnails)
+{
+    // Don't store plain thumbnails of items from encrypted tabs.
+    model->setProperty( propertyNoDiskCache, saver->isEncrypted() );
+
+    connect( model, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+             SLOT(onRowsAboutToBeRemoved(QModelIndex,int,int)) );
+}
+
+bool ItemImageSaver::saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file)
+{
+    return m_saver->saveItems(tabName, model, file);
+}
+
+bool ItemImageSaver::canJournalItems() const
+{
+    return m_saver->canJournalItems();
+}
+
+bool ItemImageSaver::isEncrypted() const
+{
+    return m_saver->isEncrypted();
+}
+
+bool ItemImageSaver::canRemoveItems(const QList<QModelIndex> &indexList, QString *error)
+{
+    return m_saver->canRemoveItems(indexList, error);
+}
+
+bool ItemImageSaver::canMoveItems(const QList<QModelIndex> &indexList)
+{
+    return m_saver->canMoveItems(indexList);
+}
+
+void ItemImageSaver::itemsRemovedByUser(const QList<QModelIndex> &indexList)
+{
+    m_saver->itemsRemovedByUser(indexList);
+}
+
+QVariantMap ItemImageSaver::copyItem(const QAbstractItemModel &model, const QVariantMap &itemData)
+{
+    return m_saver->copyItem(model, itemData);
+}
+
+int ItemImageSaver::insertionRow(const QAbstractItemModel &model, int row) const
+{
+    return m_saver->insertionRow(model, row);
+}
+
+void ItemImageSaver::onRowsAboutToBeRemoved(const QModelIndex &, int start, int end)
+{
+    if (!m_model)
+        return;
+
+    const bool removalPending = !m_removedItemHashes.isEmpty();
+
+    for (int row = start; row <= end; ++row) {
+        const QModelIndex index = m_model->index(row, 0);
+        const QStringList formats = index.data(contentType::formats).toStringList();
+        if ( !findImageFormat(formats).isEmpty() )
+            m_removedItemHashes.insert( index.data(contentType::hash).toUInt() );
+    }
+
+    // Check later if items were only moved (e.g. to top).
+    if ( !removalPending && !m_removedItemHashes.isEmpty() )
+        QTimer::singleShot( 0, this, SLOT(removeThumbnailsOfRemovedItems()) );
+}
+
+void ItemImageSaver::removeThumbnailsOfRemovedItems()
+{
+    if (!m_model)
+        return;
+
+    for (int row = 0; row < m_model->rowCount() && !m_removedItemHashes.isEmpty(); ++row) {
+        const QModelIndex index = m_model->index(row, 0);
+        m_removedItemHashes.remove( index.data(contentType::hash).toUInt() );
+    }
+
+    m_thumbnails->removeThumbnails(m_removedItemHashes);
+    m_removedItemHashes.clear();
+}
+
 ItemImageLoader::ItemImageLoader()
+    : m_thumbnails(std::make_shared<ImageThumbnailCache>())
 {
 }
 
@@ -213,32 +576,44 @@ ItemWidget *ItemImageLoader::create(const QModelIndex &index, QWidget *parent, b
     if ( index.data(contentType::isHidden).toBool() )
         return nullptr;
 
-    // TODO: Just check if image provided and load it in different thread.
-    QPixmap pix;
-    if ( !getPixmapFromData(index, &pix) )
+    QString mime;
+    QByteArray data;
+    if ( !getImageData(index, &data, &mime) )
         return nullptr;
 
+    // Only image size is read here, image is decoded and scaled in background.
+    const int w = preview ? 0 : m_settings.value("max_image_width", 320).toInt();
+    const int h = preview ? 0 : m_settings.value("max_image_height", 240).toInt();
+    const QSize originalSize = imageSize(data);
+    const QSize size = scaledImageSize(originalSize, w, h);
+
+    const QString key = ImageThumbnailCache::thumbnailKey(
+                index.data(contentType::hash).toUInt(), data, originalSize,
+                size.isValid() ? size : QSize(w, h) );
+    QPixmap pix = m_thumbnails->thumbnail(key);
+    const bool isLoaded = !pix.isNull();
+    if (!isLoaded)
+        pix = placeholderPixmap( size, parent->palette() );
+
 #if QT_VERSION >= 0x050000
     pix.setDevicePixelRatio( parent->devicePixelRatio() );
 #endif
 
-    // scale pixmap
-    const int w = preview ? 0 : m_settings.value("max_image_width", 320).toInt();
-    const int h = preview ? 0 : m_settings.value("max_image_height", 240).toInt();
-    if ( w > 0 && pix.width() > w && (h <= 0 || 1.0 * pix.width()/w > 1.0 * pix.height()/h) ) {
-        pix = pix.scaledToWidth(w, Qt::SmoothTransformation);
-    } else if (h > 0 && pix.height() > h) {
-        pix = pix.scaledToHeight(h, Qt::SmoothTransformation);
-    }
-
     QByteArray animationData;
     QByteArray animationFormat;
     getAnimatedImageData(index, &animationData, &animationFormat);
 
-    return new ItemImage(pix,
-                         animationData, animationFormat,
-                         m_settings.value("image_editor").toString(),
-                         m_settings.value("svg_editor").toString(), parent);
+    auto item = new ItemImage(pix,
+                              animationData, animationFormat,
+                              m_settings.value("image_editor").toString(),
+                              m_settings.value("svg_editor").toString(), parent);
+
+    if (!isLoaded) {
+        const bool useDiskCache = !index.model()->property(propertyNoDiskCache).toBool();
+        m_thumbnails->loadThumbnail( item, key, data, size, QSize(w, h), useDiskCache );
+    }
+
+    return item;
 }
 
 QStringList ItemImageLoader::formatsToSave() const
@@ -255,9 +630,16 @@ QVariantMap ItemImageLoader::applySettings()
     m_settings["max_image_height"] = ui->spinBoxImageHeight->value();
     m_settings["image_editor"] = ui->lineEditImageEditor->text();
     m_settings["svg_editor"] = ui->lineEditSvgEditor->text();
+    m_settings["thumbnail_disk_cache"] = ui->checkBoxThumbnailDiskCache->isChecked();
     return m_settings;
 }
 
+void ItemImageLoader::loadSettings(const QVariantMap &settings)
+{
+    m_settings = settings;
+    m_thumbnails->setDiskCacheEnabled( m_settings.value("thumbnail_disk_cache", false).toBool() );
+}
+
 QWidget *ItemImageLoader::createSettingsWidget(QWidget *parent)
 {
     ui.reset(new Ui::ItemImageSettings);
@@ -267,7 +649,24 @@ QWidget *ItemImageLoader::createSettingsWidget(QWidget *parent)
     ui->spinBoxImageHeight->setValue( m_settings.value("max_image_height", 240).toInt() );
     ui->lineEditImageEditor->setText( m_settings.value("image_editor", "").toString() );
     ui->lineEditSvgEditor->setText( m_settings.value("svg_editor", "").toString() );
+    ui->checkBoxThumbnailDiskCache->setChecked( m_settings.value("thumbnail_disk_cache", false).toBool() );
     return w;
 }
 
+ItemSaverPtr ItemImageLoader::transformSaver(const ItemSaverPtr &saver, QAbstractItemModel *model)
+{
+    return std::make_shared<ItemImageSaver>(model, saver, m_thumbnails);
+}
+
+QObject *ItemImageLoader::tests(const TestInterfacePtr &test) const
+{
+#ifdef HAS_TESTS
+    QObject *tests = new ItemImageTests(test);
+    return tests;
+#else
+    Q_UNUSED(test);
+    return nullptr;
+#endif
+}
+
 Q_EXPORT_PLUGIN2(itemimage, ItemImageLoader)
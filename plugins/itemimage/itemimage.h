@@ -23,8 +23,17 @@
 #include "gui/icons.h"
 #include "item/itemwidget.h"
 
+#include <QCache>
+#include <QHash>
+#include <QImage>
 #include <QLabel>
+#include <QList>
 #include <QPixmap>
+#include <QPointer>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
 
 #include <memory>
 
@@ -53,6 +62,9 @@ public:
 
     void setCurrent(bool current) override;
 
+    /// Replaces placeholder with loaded thumbnail.
+    void setThumbnail(const QPixmap &pixmap);
+
 protected:
     void showEvent(QShowEvent *event) override;
     void hideEvent(QHideEvent *event) override;
@@ -70,6 +82,140 @@ private:
     QMovie *m_animation;
 };
 
+/**
+ * Decodes and scales image (in a thread pool).
+ *
+ * If @a size is invalid (image size cannot be read without decoding it),
+ * the image is scaled to fit @a maxSize after decoding.
+ *
+ * If @a cacheFileName is not empty, the scaled image is loaded from the file
+ * if it exists, otherwise it's saved to the file.
+ */
+class ImageThumbnailTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ImageThumbnailTask(const QString &key, const QByteArray &data, QSize size, QSize maxSize,
+                       const QString &cacheFileName);
+
+    void run() override;
+
+signals:
+    /// Emitted when done (image is null if it cannot be decoded).
+    void thumbnailLoaded(const QString &key, const QImage &image);
+
+private:
+    QString m_key;
+    QByteArray m_data;
+    QSize m_size;
+    QSize m_maxSize;
+    QString m_cacheFileName;
+};
+
+/**
+ * Scaled images for items, keyed by item hash, image data length, image size
+ * and thumbnail size.
+ *
+ * Images are decoded and scaled in background. Memory cache is bounded,
+ * thumbnails can be also cached on disk.
+ */
+class ImageThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    ImageThumbnailCache();
+
+    ~ImageThumbnailCache();
+
+    static QString thumbnailKey(uint itemHash, const QByteArray &data, QSize imageSize, QSize size);
+
+    /// Enables storing thumbnails in application cache directory.
+    void setDiskCacheEnabled(bool enabled);
+
+    /// Sets directory for thumbnails stored on disk (empty to disable disk cache).
+    void setDiskCachePath(const QString &path);
+
+    /// Returns cached thumbnail or null pixmap.
+    QPixmap thumbnail(const QString &key) const;
+
+    /**
+     * Loads thumbnail in background and passes it to @a item
+     * (see ItemImage::setThumbnail()).
+     *
+     * Thumbnail is not stored on disk if @a useDiskCache is false.
+     */
+    void loadThumbnail(ItemImage *item, const QString &key, const QByteArray &data,
+                       QSize size, QSize maxSize, bool useDiskCache);
+
+    /// Removes thumbnails of items with given hashes from memory and disk.
+    void removeThumbnails(const QSet<uint> &itemHashes);
+
+private slots:
+    void onThumbnailLoaded(const QString &key, const QImage &image);
+
+    /// Removes oldest thumbnails from disk if cache is too big.
+    void pruneDiskCache();
+
+private:
+    QString cacheFileName(const QString &key) const;
+
+    QCache<QString, QPixmap> m_thumbnails;
+
+    /// Items waiting for thumbnails which are being loaded.
+    QHash< QString, QList< QPointer<ItemImage> > > m_pending;
+
+    /// Thumbnails being loaded for removed items (passed to waiting items but not cached).
+    QSet<QString> m_removedPending;
+
+    QThreadPool m_threadPool;
+    QString m_diskCachePath;
+    QTimer m_timerPruneDiskCache;
+};
+
+/**
+ * Removes thumbnails of items removed from tab.
+ *
+ * Disables disk cache for encrypted tabs.
+ */
+class ItemImageSaver : public QObject, public ItemSaverInterface
+{
+    Q_OBJECT
+
+public:
+    ItemImageSaver(QAbstractItemModel *model, const ItemSaverPtr &saver,
+                   const std::shared_ptr<ImageThumbnailCache> &thumbnails);
+
+    bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file) override;
+
+    bool canJournalItems() const override;
+
+    bool isEncrypted() const override;
+
+    bool canRemoveItems(const QList<QModelIndex> &indexList, QString *error) override;
+
+    bool canMoveItems(const QList<QModelIndex> &indexList) override;
+
+    void itemsRemovedByUser(const QList<QModelIndex> &indexList) override;
+
+    QVariantMap copyItem(const QAbstractItemModel &model, const QVariantMap &itemData) override;
+
+    int insertionRow(const QAbstractItemModel &model, int row) const override;
+
+private slots:
+    void onRowsAboutToBeRemoved(const QModelIndex &parent, int start, int end);
+
+    void removeThumbnailsOfRemovedItems();
+
+private:
+    QPointer<QAbstractItemModel> m_model;
+    /// Hashes of removed items (item can be moved by removing and inserting it again).
+    QSet<uint> m_removedItemHashes;
+    ItemSaverPtr m_saver;
+    std::shared_ptr<ImageThumbnailCache> m_thumbnails;
+};
+
 class ItemImageLoader : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -94,13 +240,18 @@ public:
 
     QVariantMap applySettings() override;
 
-    void loadSettings(const QVariantMap &settings) override { m_settings = settings; }
+    void loadSettings(const QVariantMap &settings) override;
 
     QWidget *createSettingsWidget(QWidget *parent) override;
 
+    ItemSaverPtr transformSaver(const ItemSaverPtr &saver, QAbstractItemModel *model) override;
+
+    QObject *tests(const TestInterfacePtr &test) const override;
+
 private:
     QVariantMap m_settings;
     std::unique_ptr<Ui::ItemImageSettings> ui;
+    std::shared_ptr<ImageThumbnailCache> m_thumbnails;
 };
 
 #endif // ITEMIMAGE_H
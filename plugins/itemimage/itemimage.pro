@@ -11,3 +11,8 @@ SOURCES += \
 FORMS   += itemimagesettings.ui
 TARGET   = $$qtLibraryTarget(itemimage)
 
+CONFIG(debug, debug|release) {
+    SOURCES += tests/itemimagetests.cpp
+    HEADERS += tests/itemimagetests.h
+}
+
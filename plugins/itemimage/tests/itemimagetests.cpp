@@ -0,0 +1,287 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "itemimagetests.h"
+
+#include "tests/test_utils.h"
+
+#include "common/contenttype.h"
+#include "common/sleeptimer.h"
+#include "itemimage.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QImage>
+#include <QStandardItemModel>
+
+#include <memory>
+
+namespace {
+
+const uint testItemHash = 0x1234;
+
+const QSize testImageSize(40, 20);
+
+QString testCachePath()
+{
+    return QDir::tempPath() + "/copyq_test_thumbnails";
+}
+
+void clearTestCache()
+{
+    QDir dir( testCachePath() );
+    for ( const auto &fileName : dir.entryList(QDir::Files) )
+        dir.remove(fileName);
+}
+
+bool isCacheEmpty()
+{
+    return QDir( testCachePath() ).entryList(QDir::Files).isEmpty();
+}
+
+QByteArray createImage(const QColor &color)
+{
+    QImage image(testImageSize, QImage::Format_RGB32);
+    image.fill( color.rgb() );
+
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return bytes;
+}
+
+QString thumbnailKey(const QByteArray &image)
+{
+    return ImageThumbnailCache::thumbnailKey(testItemHash, image, testImageSize, testImageSize);
+}
+
+QString thumbnailFileName(const QString &key)
+{
+    return testCachePath() + "/" + key + ".png";
+}
+
+std::unique_ptr<ItemImage> createItem()
+{
+    return std::unique_ptr<ItemImage>(
+                new ItemImage(QPixmap(), QByteArray(), QByteArray(), QString(), QString(), nullptr) );
+}
+
+void loadThumbnail(ImageThumbnailCache *cache, ItemImage *item, const QByteArray &image, bool useDiskCache = true)
+{
+    cache->loadThumbnail( item, thumbnailKey(image), image, testImageSize, testImageSize, useDiskCache );
+}
+
+bool waitForThumbnail(const ImageThumbnailCache &cache, const QString &key)
+{
+    SleepTimer t(8000);
+    while ( cache.thumbnail(key).isNull() && t.sleep() ) {}
+    return !cache.thumbnail(key).isNull();
+}
+
+bool waitForItemThumbnail(const ItemImage &item)
+{
+    SleepTimer t(8000);
+    while ( (item.pixmap() == nullptr || item.pixmap()->isNull()) && t.sleep() ) {}
+    return item.pixmap() != nullptr && !item.pixmap()->isNull();
+}
+
+QStandardItem *createImageItem(uint itemHash)
+{
+    auto item = new QStandardItem();
+    item->setData( QStringList("image/png"), contentType::formats );
+    item->setData( itemHash, contentType::hash );
+    return item;
+}
+
+class EncryptedSaver : public ItemSaverInterface
+{
+public:
+    bool isEncrypted() const override { return true; }
+};
+
+} // namespace
+
+ItemImageTests::ItemImageTests(const TestInterfacePtr &test, QObject *parent)
+    : QObject(parent)
+    , m_test(test)
+{
+}
+
+void ItemImageTests::initTestCase()
+{
+    QVERIFY( QDir().mkpath(testCachePath()) );
+}
+
+void ItemImageTests::cleanupTestCase()
+{
+    clearTestCache();
+    QDir().rmdir( testCachePath() );
+}
+
+void ItemImageTests::init()
+{
+    clearTestCache();
+}
+
+void ItemImageTests::cleanup()
+{
+    clearTestCache();
+}
+
+void ItemImageTests::thumbnailCacheHit()
+{
+    ImageThumbnailCache cache;
+    const QByteArray image = createImage(Qt::red);
+    const QString key = thumbnailKey(image);
+    QVERIFY( cache.thumbnail(key).isNull() );
+
+    const auto item = createItem();
+    loadThumbnail(&cache, item.get(), image);
+    QVERIFY( waitForThumbnail(cache, key) );
+    QCOMPARE( cache.thumbnail(key).size(), testImageSize );
+    QVERIFY( waitForItemThumbnail(*item) );
+}
+
+void ItemImageTests::thumbnailDiskCacheHit()
+{
+    const QByteArray image = createImage(Qt::red);
+    const QString key = thumbnailKey(image);
+
+    {
+        ImageThumbnailCache cache;
+        cache.setDiskCachePath( testCachePath() );
+        const auto item = createItem();
+        loadThumbnail(&cache, item.get(), image);
+        QVERIFY( waitForThumbnail(cache, key) );
+    }
+
+    // Change cached file to check that it's used instead of decoding the image again.
+    const QString fileName = thumbnailFileName(key);
+    QVERIFY( QFile::exists(fileName) );
+    QVERIFY( QFile::remove(fileName) );
+    QImage cachedImage(testImageSize, QImage::Format_RGB32);
+    cachedImage.fill( QColor(Qt::blue).rgb() );
+    QVERIFY( cachedImage.save(fileName, "PNG") );
+
+    ImageThumbnailCache cache;
+    cache.setDiskCachePath( testCachePath() );
+    const auto item = createItem();
+    loadThumbnail(&cache, item.get(), image);
+    QVERIFY( waitForThumbnail(cache, key) );
+    QCOMPARE( cache.thumbnail(key).toImage().pixel(0, 0), QColor(Qt::blue).rgb() );
+}
+
+void ItemImageTests::removeThumbnails()
+{
+    ImageThumbnailCache cache;
+    cache.setDiskCachePath( testCachePath() );
+    const QByteArray image = createImage(Qt::red);
+    const QString key = thumbnailKey(image);
+
+    const auto item = createItem();
+    loadThumbnail(&cache, item.get(), image);
+    QVERIFY( waitForThumbnail(cache, key) );
+    QVERIFY( QFile::exists(thumbnailFileName(key)) );
+
+    cache.removeThumbnails( QSet<uint>() << testItemHash + 1 );
+    QVERIFY( !cache.thumbnail(key).isNull() );
+    QVERIFY( QFile::exists(thumbnailFileName(key)) );
+
+    cache.removeThumbnails( QSet<uint>() << testItemHash );
+    QVERIFY( cache.thumbnail(key).isNull() );
+    QVERIFY( isCacheEmpty() );
+}
+
+void ItemImageTests::removeThumbnailsWhileLoading()
+{
+    ImageThumbnailCache cache;
+    cache.setDiskCachePath( testCachePath() );
+    const QByteArray image = createImage(Qt::red);
+    const QString key = thumbnailKey(image);
+
+    const auto item = createItem();
+    loadThumbnail(&cache, item.get(), image);
+    cache.removeThumbnails( QSet<uint>() << testItemHash );
+
+    // Waiting items get the thumbnail but it's not cached.
+    QVERIFY( waitForItemThumbnail(*item) );
+    QVERIFY( cache.thumbnail(key).isNull() );
+    QVERIFY( isCacheEmpty() );
+}
+
+void ItemImageTests::keepThumbnailsOfMovedItems()
+{
+    const auto cache = std::make_shared<ImageThumbnailCache>();
+    const QByteArray image = createImage(Qt::red);
+    const QString key = thumbnailKey(image);
+
+    QStandardItemModel model;
+    model.appendRow( createImageItem(testItemHash + 1) );
+    model.appendRow( createImageItem(testItemHash) );
+    ItemImageSaver saver( &model, std::make_shared<ItemSaverInterface>(), cache );
+
+    const auto item = createItem();
+    loadThumbnail(cache.get(), item.get(), image);
+    QVERIFY( waitForThumbnail(*cache, key) );
+
+    // Move item to top.
+    model.insertRow( 0, model.takeRow(1) );
+    QCoreApplication::processEvents();
+    QVERIFY( !cache->thumbnail(key).isNull() );
+
+    model.removeRow(0);
+    SleepTimer t(8000);
+    while ( !cache->thumbnail(key).isNull() && t.sleep() ) {}
+    QVERIFY( cache->thumbnail(key).isNull() );
+}
+
+void ItemImageTests::thumbnailDiskCacheOptOut()
+{
+    ImageThumbnailCache cache;
+    cache.setDiskCachePath( testCachePath() );
+    const QByteArray image = createImage(Qt::red);
+    const QString key = thumbnailKey(image);
+
+    const auto item = createItem();
+    loadThumbnail(&cache, item.get(), image, false);
+    QVERIFY( waitForThumbnail(cache, key) );
+    QVERIFY( isCacheEmpty() );
+
+    // Disk cache is disabled by default.
+    ImageThumbnailCache cache2;
+    const auto item2 = createItem();
+    loadThumbnail(&cache2, item2.get(), image);
+    QVERIFY( waitForThumbnail(cache2, key) );
+    QVERIFY( isCacheEmpty() );
+}
+
+void ItemImageTests::noDiskCacheForEncryptedTabs()
+{
+    const auto cache = std::make_shared<ImageThumbnailCache>();
+
+    QStandardItemModel model;
+    ItemImageSaver saver( &model, std::make_shared<ItemSaverInterface>(), cache );
+    QVERIFY( !model.property("CopyQ_itemimage_no_disk_cache").toBool() );
+
+    QStandardItemModel encryptedModel;
+    ItemImageSaver encryptedSaver( &encryptedModel, std::make_shared<EncryptedSaver>(), cache );
+    QVERIFY( encryptedModel.property("CopyQ_itemimage_no_disk_cache").toBool() );
+}
@@ -348,10 +348,10 @@ ItemWidget *ItemNotesLoader::transform(ItemWidget *itemWidget, const QModelIndex
             m_settings["show_tooltip"].toBool() );
 }
 
-bool ItemNotesLoader::matches(const QModelIndex &index, const QRegExp &re) const
+QString ItemNotesLoader::searchableText(const QVariantMap &data) const
 {
-    const QString text = index.data(contentType::notes).toString();
-    return re.indexIn(text) != -1;
+    const QByteArray notes = data.value(mimeNotes).toByteArray();
+    return QString::fromUtf8( notes.constData(), notes.size() );
 }
 
 Q_EXPORT_PLUGIN2(itemnotes, ItemNotesLoader)
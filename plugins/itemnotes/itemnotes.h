@@ -104,7 +104,7 @@ public:
 
     ItemWidget *transform(ItemWidget *itemWidget, const QModelIndex &index) override;
 
-    bool matches(const QModelIndex &index, const QRegExp &re) const override;
+    QString searchableText(const QVariantMap &data) const override;
 
 private:
     QVariantMap m_settings;
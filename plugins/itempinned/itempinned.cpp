@@ -205,6 +205,16 @@ bool ItemPinnedSaver::saveItems(const QString &tabName, const QAbstractItemModel
     return m_saver->saveItems(tabName, model, file);
 }
 
+bool ItemPinnedSaver::canJournalItems() const
+{
+    return m_saver->canJournalItems();
+}
+
+bool ItemPinnedSaver::isEncrypted() const
+{
+    return m_saver->isEncrypted();
+}
+
 bool ItemPinnedSaver::canRemoveItems(const QList<QModelIndex> &indexList, QString *error)
 {
     const bool containsPinnedItems = std::any_of(
@@ -240,6 +250,15 @@ QVariantMap ItemPinnedSaver::copyItem(const QAbstractItemModel &model, const QVa
     return m_saver->copyItem(model, itemData);
 }
 
+int ItemPinnedSaver::insertionRow(const QAbstractItemModel &model, int row) const
+{
+    // Skip pinned rows so they don't need to be moved back after insertion.
+    int newRow = m_saver->insertionRow(model, row);
+    while ( newRow <= m_lastPinned && isPinned(model.index(newRow, 0)) )
+        ++newRow;
+    return newRow;
+}
+
 void ItemPinnedSaver::onRowsInserted(const QModelIndex &, int start, int end)
 {
     if (!m_model || m_lastPinned < start) {
@@ -250,12 +269,20 @@ void ItemPinnedSaver::onRowsInserted(const QModelIndex &, int start, int end)
     disconnect( m_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
                 this, SLOT(onRowsMoved(QModelIndex,int,int,QModelIndex,int)) );
 
-    // Shift rows below inserted up.
+    // Shift pinned rows below inserted up (each continuous block at once).
     const int rowCount = end - start + 1;
-    for (int row = end + 1; row <= m_lastPinned + rowCount; ++row) {
+    const int lastRow = m_lastPinned + rowCount;
+    for (int row = end + 1; row <= lastRow; ++row) {
         const auto index = m_model->index(row, 0);
-        if ( isPinned(index) )
-            moveRow(row, row - rowCount);
+        if ( !isPinned(index) )
+            continue;
+
+        int blockEnd = row;
+        while ( blockEnd < lastRow && isPinned(m_model->index(blockEnd + 1, 0)) )
+            ++blockEnd;
+
+        moveRowsUp(row, blockEnd - row + 1, row - rowCount);
+        row = blockEnd;
     }
 
     connect( m_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
@@ -313,6 +340,16 @@ void ItemPinnedSaver::moveRow(int from, int to)
 #endif
 }
 
+void ItemPinnedSaver::moveRowsUp(int from, int count, int to)
+{
+#if QT_VERSION < 0x050000
+    for (int i = 0; i < count; ++i)
+        moveRow(from + i, to + i);
+#else
+    m_model->moveRows(QModelIndex(), from, count, QModelIndex(), to);
+#endif
+}
+
 void ItemPinnedSaver::updateLastPinned(int from, int to)
 {
     for (int row = to; row >= from; --row) {
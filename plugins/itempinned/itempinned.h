@@ -85,6 +85,10 @@ public:
 
     bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file) override;
 
+    bool canJournalItems() const override;
+
+    bool isEncrypted() const override;
+
     bool canRemoveItems(const QList<QModelIndex> &indexList, QString *error) override;
 
     bool canMoveItems(const QList<QModelIndex> &indexList) override;
@@ -93,6 +97,8 @@ public:
 
     QVariantMap copyItem(const QAbstractItemModel &model, const QVariantMap &itemData) override;
 
+    int insertionRow(const QAbstractItemModel &model, int row) const override;
+
 private slots:
     void onRowsInserted(const QModelIndex &parent, int start, int end);
     void onRowsRemoved(const QModelIndex &parent, int start, int end);
@@ -101,6 +107,8 @@ private slots:
 
 private:
     void moveRow(int from, int to);
+    /// Moves @a count rows starting at @a from up to row @a to.
+    void moveRowsUp(int from, int count, int to);
     void updateLastPinned(int from, int to);
 
     QPointer<QAbstractItemModel> m_model;
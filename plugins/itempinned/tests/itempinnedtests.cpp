@@ -150,6 +150,74 @@ void ItemPinnedTests::pinToRow()
     RUN(read << "0" << "1" << "2", "a b d");
 }
 
+void ItemPinnedTests::addBelowPinned()
+{
+    const auto read = Args() << "separator" << " " << "read";
+
+    RUN("add" << "d" << "c" << "b" << "a", "");
+    RUN("-e" << "plugins.itempinned.pin(0,1,3)", "");
+
+    RUN("add" << "X", "");
+    RUN(read << "0" << "1" << "2" << "3" << "4", "a b X d c");
+
+    RUN("insert" << "3" << "Y", "");
+    RUN(read << "0" << "1" << "2" << "3" << "4" << "5", "a b X d Y c");
+
+    // New item is placed below pinned items on top.
+    RUN("-e" << "plugins.itempinned.unpin(3); remove(3); add('d')", "");
+    RUN(read << "0" << "1" << "2" << "3" << "4" << "5", "a b d X Y c");
+
+    // Pinned items stay in place if these are not in single block.
+    RUN("-e" << "plugins.itempinned.pin(3, 5)", "");
+    RUN("add" << "Z", "");
+    RUN(read << "0" << "1" << "2" << "3" << "4" << "5" << "6", "a b Z X d c Y");
+}
+
+void ItemPinnedTests::benchmarkAddBelowPinned_data()
+{
+    QTest::addColumn<int>("pinnedCount");
+    QTest::addColumn<bool>("pinnedOnTop");
+
+    for (int pinnedCount : {0, 10, 100, 1000}) {
+        const auto count = QByteArray::number(pinnedCount);
+        QTest::newRow(("on top " + count).constData()) << pinnedCount << true;
+        QTest::newRow(("scattered " + count).constData()) << pinnedCount << false;
+    }
+}
+
+void ItemPinnedTests::benchmarkAddBelowPinned()
+{
+    QFETCH(int, pinnedCount);
+    QFETCH(bool, pinnedOnTop);
+
+    RUN("config" << "maxitems" << "10000", "10000\n");
+
+    // Pin every other item or items on top.
+    const auto script = QString(R"(
+        var pinnedCount = %1;
+        var pinnedOnTop = %2;
+        var rows = [];
+        for (var i = 0; i < 2 * pinnedCount; ++i) {
+            add('item ' + i);
+            if (pinnedOnTop ? i < pinnedCount : i % 2 == 0)
+                rows.push(i);
+        }
+        plugins.itempinned.pin.apply(this, rows);
+        )").arg(pinnedCount).arg(pinnedOnTop ? "true" : "false");
+    RUN(script, "");
+
+    const auto addItems = "for (var i = 0; i < 100; ++i) add('new ' + i)";
+    QBENCHMARK {
+        RUN(addItems, "");
+    }
+
+    const auto lastPinnedRow = pinnedOnTop ? pinnedCount - 1 : 2 * (pinnedCount - 1);
+    if (pinnedCount > 0) {
+        RUN("-e" << QString("plugins.itempinned.isPinned(%1)").arg(lastPinnedRow), "true\n");
+        RUN("-e" << QString("plugins.itempinned.isPinned(%1)").arg(lastPinnedRow + 1), "false\n");
+    }
+}
+
 void ItemPinnedTests::fullTab()
 {
     RUN("config" << "maxitems" << "3", "3\n");
@@ -45,6 +45,9 @@ private slots:
     void removePinnedThrows();
 
     void pinToRow();
+    void addBelowPinned();
+    void benchmarkAddBelowPinned_data();
+    void benchmarkAddBelowPinned();
 
     void fullTab();
 
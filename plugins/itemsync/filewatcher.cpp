@@ -25,8 +25,10 @@
 
 #include <QAbstractItemModel>
 #include <QCryptographicHash>
+#include <QDateTime>
 #include <QDir>
 #include <QMimeData>
+#include <QSet>
 #include <QUrl>
 
 const char mimeExtensionMap[] = COPYQ_MIME_PREFIX_ITEMSYNC "mime-to-extension-map";
@@ -62,7 +64,13 @@ namespace {
 const char dataFileSuffix[] = "_copyq.dat";
 const char noteFileSuffix[] = "_note.txt";
 
-const int updateItemsIntervalMs = 5000; // Interval to update items after a file has changed.
+const int updateItemsIntervalMs = 5000; // Interval to update items if files cannot be watched.
+const int updateItemsDelayMs = 100; // Delay to update items after a file has changed.
+const int updateAllItemsIntervalMs = 60000; // Interval to check all files even if watched.
+
+// File changed less than this before its size and modification time were
+// read can change again without changing the modification time.
+const qint64 fileModificationTimePrecisionMs = 2000;
 
 const qint64 sizeLimit = 10 << 20;
 
@@ -256,6 +264,40 @@ QStringList listFiles(const QDir &dir, QDir::SortFlags sortFlags = QDir::NoSort)
     return files;
 }
 
+/**
+ * Return sizes and modification times of item files (changes if any file changes).
+ *
+ * Returns empty string if any file changed too recently for the modification
+ * time to be reliable so that the files are read again on next update.
+ */
+QString fileStamp(const QDir &dir, const BaseNameExtensions &baseNameWithExts)
+{
+    QString stamp;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (const auto &ext : baseNameWithExts.exts) {
+        const QFileInfo info( dir.absoluteFilePath(baseNameWithExts.baseName + ext.extension) );
+        const qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+        if ( now - lastModified < fileModificationTimePrecisionMs )
+            return QString();
+
+        stamp.append( QString("%1:%2:%3;")
+                      .arg(ext.extension)
+                      .arg(info.size())
+                      .arg(lastModified) );
+    }
+
+    return stamp;
+}
+
+QStringList filePaths(const QDir &dir, const BaseNameExtensions &baseNameWithExts)
+{
+    QStringList paths;
+    for (const auto &ext : baseNameWithExts.exts)
+        paths.append( dir.absoluteFilePath(baseNameWithExts.baseName + ext.extension) );
+    return paths;
+}
+
 /// Return true only if no file name in @a fileNames starts with @a baseName.
 bool isUniqueBaseName(const QString &baseName, const QStringList &fileNames,
                       const QStringList &baseNames = QStringList())
@@ -352,13 +394,13 @@ FileWatcher::FileWatcher(
         QObject *parent)
     : QObject(parent)
     , m_model(model)
+    , m_updateIntervalMs(updateItemsIntervalMs)
     , m_formatSettings(formatSettings)
     , m_path(path)
     , m_valid(true)
     , m_indexData()
     , m_maxItems(maxItems)
 {
-    m_updateTimer.setInterval(updateItemsIntervalMs);
     m_updateTimer.setSingleShot(true);
 
 #ifdef HAS_TESTS
@@ -368,12 +410,23 @@ FileWatcher::FileWatcher(
 #else
     if ( !qEnvironmentVariableIsEmpty("COPYQ_TEST_ID") )
 #endif
-        m_updateTimer.setInterval(100);
+        m_updateIntervalMs = 100;
 #endif
 
     connect( &m_updateTimer, SIGNAL(timeout()),
              SLOT(updateItems()) );
 
+    // Check all files occasionally in case some changes were not reported.
+    m_updateAllTimer.setInterval(updateAllItemsIntervalMs);
+    connect( &m_updateAllTimer, SIGNAL(timeout()),
+             SLOT(updateAllItems()) );
+    m_updateAllTimer.start();
+
+    connect( &m_watcher, SIGNAL(directoryChanged(QString)),
+             SLOT(onDirectoryChanged()) );
+    connect( &m_watcher, SIGNAL(fileChanged(QString)),
+             SLOT(onFileChanged(QString)) );
+
     connect( m_model.data(), SIGNAL(rowsInserted(QModelIndex,int,int)),
              this, SLOT(onRowsInserted(QModelIndex,int,int)), Qt::UniqueConnection );
     connect( m_model.data(), SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
@@ -436,42 +489,128 @@ void FileWatcher::updateItems()
 {
     m_updateTimer.stop();
 
-    if ( !lock() )
+    if ( !lock() ) {
+        // Try again later so changes are not lost.
+        scheduleUpdate();
         return;
+    }
 
     QDir dir(m_path);
-    const QStringList files = listFiles(dir, QDir::Time | QDir::Reversed);
-    BaseNameExtensionsList fileList = listFiles(files, m_formatSettings);
+    bool watching = true;
+
+    if (m_directoryChanged) {
+        m_directoryChanged = false;
+
+        const QStringList files = listFiles(dir, QDir::Time | QDir::Reversed);
+        const BaseNameExtensionsList fileList = listFiles(files, m_formatSettings);
+
+        QSet<QString> baseNames;
+        BaseNameExtensionsList newFileList;
+        m_fileBaseNames.clear();
+
+        // Read only files which changed since last update.
+        for (const auto &baseNameWithExts : fileList) {
+            const QString &baseName = baseNameWithExts.baseName;
+            baseNames.insert(baseName);
+
+            const QStringList paths = filePaths(dir, baseNameWithExts);
+            m_baseNameFiles.insert(baseName, paths);
+            for (const auto &path : paths)
+                m_fileBaseNames.insert(path, baseName);
+
+            const QString stamp = fileStamp(dir, baseNameWithExts);
+            const QPersistentModelIndex index = m_baseNameIndex.value(baseName);
+            if ( !index.isValid() ) {
+                newFileList.append(baseNameWithExts);
+            } else if ( stamp.isEmpty() || m_fileStamps.value(baseName) != stamp
+                        || m_changedBaseNames.contains(baseName) )
+            {
+                updateItemFromFiles(dir, baseNameWithExts, index);
+            }
 
-    for ( int row = 0; row < m_model->rowCount(); ++row ) {
-        const QModelIndex index = m_model->index(row, 0);
-        const QString baseName = getBaseName(index);
+            m_fileStamps.insert(baseName, stamp);
+        }
 
-        int i = 0;
-        for ( i = 0; i < fileList.size() && fileList[i].baseName != baseName; ++i ) {}
+        // Remove items without files.
+        QList<QPersistentModelIndex> removedIndexes;
+        for ( auto it = m_baseNameIndex.constBegin(); it != m_baseNameIndex.constEnd(); ++it ) {
+            if ( !baseNames.contains(it.key()) )
+                removedIndexes.append(it.value());
+        }
 
-        QVariantMap dataMap;
-        QVariantMap mimeToExtension;
+        for (const auto &index : removedIndexes) {
+            if ( index.isValid() )
+                m_model->removeRow(index.row());
+        }
 
-        if ( i < fileList.size() ) {
-            updateDataAndWatchFile(dir, fileList[i], &dataMap, &mimeToExtension);
-            fileList.removeAt(i);
+        for ( auto it = m_baseNameFiles.begin(); it != m_baseNameFiles.end(); ) {
+            if ( baseNames.contains(it.key()) )
+                ++it;
+            else
+                it = m_baseNameFiles.erase(it);
         }
 
-        if ( mimeToExtension.isEmpty() ) {
-            m_model->removeRow(row--);
-        } else {
-            dataMap.insert(mimeBaseName, baseName);
-            dataMap.insert(mimeExtensionMap, mimeToExtension);
-            updateIndexData(index, dataMap);
+        createItemsFromFiles(dir, newFileList);
+
+        watching = watchFiles(files);
+    } else {
+        // Read only changed files without listing directory.
+        for (const auto &baseName : m_changedBaseNames) {
+            const QPersistentModelIndex index = m_baseNameIndex.value(baseName);
+            const BaseNameExtensionsList fileList = listFiles(m_baseNameFiles.value(baseName), m_formatSettings);
+            if ( !index.isValid() || fileList.size() != 1 ) {
+                // Files were removed or renamed.
+                m_directoryChanged = true;
+                continue;
+            }
+
+            const BaseNameExtensions &baseNameWithExts = fileList.first();
+            updateItemFromFiles(dir, baseNameWithExts, index);
+            m_fileStamps.insert( baseName, fileStamp(dir, baseNameWithExts) );
         }
     }
 
-    createItemsFromFiles(dir, fileList);
+    m_changedBaseNames.clear();
 
     unlock();
 
-    m_updateTimer.start();
+    if (!watching) {
+        m_directoryChanged = true;
+        m_updateTimer.start(m_updateIntervalMs);
+    } else if (m_directoryChanged) {
+        scheduleUpdate();
+    }
+}
+
+void FileWatcher::updateAllItems()
+{
+    m_directoryChanged = true;
+    updateItems();
+}
+
+void FileWatcher::onDirectoryChanged()
+{
+    m_directoryChanged = true;
+    scheduleUpdate();
+}
+
+void FileWatcher::onFileChanged(const QString &path)
+{
+    // Read the files even if the size and modification time is same.
+    const QString baseName = m_fileBaseNames.value(path);
+    if ( baseName.isEmpty() )
+        m_directoryChanged = true;
+    else
+        m_changedBaseNames.insert(baseName);
+
+    scheduleUpdate();
+}
+
+void FileWatcher::scheduleUpdate()
+{
+    // Postpone update so multiple changes are handled together.
+    if ( !m_updateTimer.isActive() || m_updateTimer.interval() > updateItemsDelayMs )
+        m_updateTimer.start(updateItemsDelayMs);
 }
 
 void FileWatcher::onRowsInserted(const QModelIndex &, int first, int last)
@@ -492,6 +631,10 @@ void FileWatcher::onRowsRemoved(const QModelIndex &, int first, int last)
         Q_ASSERT( it != m_indexData.end() );
         if ( isOwnBaseName(it->baseName) )
             removeFilesForRemovedIndex(m_path, index);
+        if ( m_baseNameIndex.value(it->baseName) == index ) {
+            m_baseNameIndex.remove(it->baseName);
+            m_fileStamps.remove(it->baseName);
+        }
         m_indexData.erase(it);
     }
 }
@@ -533,7 +676,12 @@ void FileWatcher::updateIndexData(const QModelIndex &index, const QVariantMap &i
 
     IndexData &data = indexData(index);
 
-    data.baseName = baseName;
+    if (data.baseName != baseName) {
+        if ( m_baseNameIndex.value(data.baseName) == index )
+            m_baseNameIndex.remove(data.baseName);
+        data.baseName = baseName;
+    }
+    m_baseNameIndex.insert(baseName, index);
 
     QMap<QString, Hash> &formatData = data.formatHash;
     formatData.clear();
@@ -765,6 +913,24 @@ void FileWatcher::updateDataAndWatchFile(const QDir &dir, const BaseNameExtensio
     }
 }
 
+void FileWatcher::updateItemFromFiles(
+        const QDir &dir, const BaseNameExtensions &baseNameWithExts, const QPersistentModelIndex &index)
+{
+    QVariantMap dataMap;
+    QVariantMap mimeToExtension;
+    updateDataAndWatchFile(dir, baseNameWithExts, &dataMap, &mimeToExtension);
+
+    if ( mimeToExtension.isEmpty() ) {
+        m_model->removeRow(index.row());
+        return;
+    }
+
+    dataMap.insert(mimeBaseName, baseNameWithExts.baseName);
+    dataMap.insert(mimeExtensionMap, mimeToExtension);
+    if ( dataMap != index.data(contentType::data).toMap() )
+        updateIndexData(index, dataMap);
+}
+
 bool FileWatcher::copyFilesFromUriList(const QByteArray &uriData, int targetRow, const QStringList &baseNames)
 {
     QMimeData tmpData;
@@ -802,3 +968,33 @@ bool FileWatcher::copyFilesFromUriList(const QByteArray &uriData, int targetRow,
 
     return copied;
 }
+
+bool FileWatcher::watchFiles(const QStringList &files)
+{
+    if ( m_watcher.directories().isEmpty() && !m_watcher.addPath(m_path) )
+        return false;
+
+    const QSet<QString> fileSet = files.toSet();
+    const QStringList watchedFiles = m_watcher.files();
+    const QSet<QString> watchedFileSet = watchedFiles.toSet();
+
+    QStringList removedFiles;
+    for (const auto &filePath : watchedFiles) {
+        if ( !fileSet.contains(filePath) )
+            removedFiles.append(filePath);
+    }
+    if ( !removedFiles.isEmpty() )
+        m_watcher.removePaths(removedFiles);
+
+    QStringList newFiles;
+    for (const auto &filePath : files) {
+        if ( !watchedFileSet.contains(filePath) )
+            newFiles.append(filePath);
+    }
+    if ( !newFiles.isEmpty() && !m_watcher.addPaths(newFiles).isEmpty() ) {
+        COPYQ_LOG( QString("ItemSync: Cannot watch all files in \"%1\", using polling").arg(m_path) );
+        return false;
+    }
+
+    return true;
+}
@@ -22,9 +22,12 @@
 
 #include "common/mimetypes.h"
 
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QObject>
 #include <QPointer>
 #include <QPersistentModelIndex>
+#include <QSet>
 #include <QStringList>
 #include <QTimer>
 #include <QVector>
@@ -88,11 +91,21 @@ public slots:
     void createItemsFromFiles(const QDir &dir, const BaseNameExtensionsList &fileList);
 
     /**
-     * Check for new files.
+     * Check for new, changed and removed files.
+     *
+     * Directory is listed only if it changed, otherwise only files reported
+     * as changed are read.
      */
     void updateItems();
 
 private slots:
+    /// Lists directory and checks all files.
+    void updateAllItems();
+
+    void onDirectoryChanged();
+
+    void onFileChanged(const QString &path);
+
     void onRowsInserted(const QModelIndex &, int first, int last);
 
     void onDataChanged(const QModelIndex &a, const QModelIndex &b);
@@ -120,6 +133,12 @@ private:
 
     void updateIndexData(const QModelIndex &index, const QVariantMap &itemData);
 
+    /// Reads files of existing item again (removes item if no files can be read).
+    void updateItemFromFiles(const QDir &dir, const BaseNameExtensions &baseNameWithExts,
+                             const QPersistentModelIndex &index);
+
+    void scheduleUpdate();
+
     QList<QPersistentModelIndex> indexList(int first, int last);
 
     void saveItems(int first, int last);
@@ -134,8 +153,28 @@ private:
 
     bool copyFilesFromUriList(const QByteArray &uriData, int targetRow, const QStringList &baseNames);
 
+    /**
+     * Watch directory and given files for changes.
+     * Returns false if some paths cannot be watched and polling must be used.
+     */
+    bool watchFiles(const QStringList &files);
+
     QPointer<QAbstractItemModel> m_model;
     QTimer m_updateTimer;
+    QTimer m_updateAllTimer;
+    int m_updateIntervalMs;
+    QFileSystemWatcher m_watcher;
+    /// Item for each base name.
+    QHash<QString, QPersistentModelIndex> m_baseNameIndex;
+    /// File sizes and modification times for each base name.
+    QHash<QString, QString> m_fileStamps;
+    /// File paths for each base name and base name for each file path.
+    QHash<QString, QStringList> m_baseNameFiles;
+    QHash<QString, QString> m_fileBaseNames;
+    /// Base names with files reported as changed since last update.
+    QSet<QString> m_changedBaseNames;
+    /// True if directory needs to be listed on next update.
+    bool m_directoryChanged = true;
     const QList<FileFormat> &m_formatSettings;
     QString m_path;
     bool m_valid;
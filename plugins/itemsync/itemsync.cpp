@@ -784,11 +784,9 @@ ItemWidget *ItemSyncLoader::transform(ItemWidget *itemWidget, const QModelIndex
     return new ItemSync(baseName, iconForItem(index, m_formatSettings), itemWidget);
 }
 
-bool ItemSyncLoader::matches(const QModelIndex &index, const QRegExp &re) const
+QString ItemSyncLoader::searchableText(const QVariantMap &data) const
 {
-    const QVariantMap dataMap = index.data(contentType::data).toMap();
-    const QString text = dataMap.value(mimeBaseName).toString();
-    return re.indexIn(text) != -1;
+    return data.value(mimeBaseName).toString();
 }
 
 QObject *ItemSyncLoader::tests(const TestInterfacePtr &test) const
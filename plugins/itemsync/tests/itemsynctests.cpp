@@ -418,6 +418,41 @@ void ItemSyncTests::modifyFiles()
     RUN(args << "size", "4\n");
 }
 
+void ItemSyncTests::modifyAddRemoveFiles()
+{
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    const Args args = Args() << "separator" << "," << "tab" << tab1;
+
+    RUN(args << "add" << "A" << "B" << "C" << "D", "");
+
+    const QString fileB = fileNameForId(1);
+    const QString fileC = fileNameForId(2);
+
+    // Change multiple files at once.
+    FilePtr file = dir1.file(fileB);
+    QVERIFY(file->open(QIODevice::Append));
+    file->write("X");
+    file->close();
+
+    QVERIFY(dir1.remove(fileC));
+
+    TEST(createFile(dir1, "test.txt", "E"));
+
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2" << "3", "E,D,BX,A");
+    RUN(args << "size", "4\n");
+
+    // Rewrite file without changing its size (modification time can stay same).
+    const QString fileD = fileNameForId(3);
+    file = dir1.file(fileD);
+    QVERIFY(file->open(QIODevice::WriteOnly));
+    file->write("Y");
+    file->close();
+
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2" << "3", "E,Y,BX,A");
+    RUN(args << "size", "4\n");
+}
+
 void ItemSyncTests::notes()
 {
     TestDir dir1(1);
@@ -51,6 +51,7 @@ private slots:
 
     void modifyItems();
     void modifyFiles();
+    void modifyAddRemoveFiles();
 
     void notes();
 
@@ -51,6 +51,8 @@ const char configTags[] = "tags";
 
 const char propertyColor[] = "CopyQ_color";
 
+const int maxCachedTagLists = 1000;
+
 namespace tagsTableColumns {
 enum {
     name,
@@ -266,22 +268,6 @@ void addTagButtons(QBoxLayout *layout, const ItemTags::Tags &tags)
     }
 }
 
-ItemTags::Tag findMatchingTag(const QString &tagText, const ItemTags::Tags &tags)
-{
-    for (const auto &tag : tags) {
-        if ( tag.match.isEmpty() ) {
-            if (tag.name == tagText)
-                return tag;
-        } else {
-            const QRegExp re(tag.match);
-            if ( re.exactMatch(tagText) )
-                return tag;
-        }
-    }
-
-    return ItemTags::Tag();
-}
-
 class TagTableWidgetItem : public QTableWidgetItem
 {
 public:
@@ -640,6 +626,8 @@ QVariantMap ItemTagsLoader::applySettings()
         }
     }
 
+    updateTagRules();
+
     m_settings.insert(configTags, tags);
 
     return m_settings;
@@ -655,6 +643,8 @@ void ItemTagsLoader::loadSettings(const QVariantMap &settings)
         if (isTagValid(tag))
             m_tags.append(tag);
     }
+
+    updateTagRules();
 }
 
 QWidget *ItemTagsLoader::createSettingsWidget(QWidget *parent)
@@ -696,9 +686,9 @@ ItemWidget *ItemTagsLoader::transform(ItemWidget *itemWidget, const QModelIndex
     return new ItemTags(itemWidget, tags);
 }
 
-bool ItemTagsLoader::matches(const QModelIndex &index, const QRegExp &re) const
+QString ItemTagsLoader::searchableText(const QVariantMap &data) const
 {
-    return re.indexIn(tags(index)) != -1;
+    return getTextData( data.value(mimeTags).toByteArray() );
 }
 
 QObject *ItemTagsLoader::tests(const TestInterfacePtr &test) const
@@ -839,32 +829,66 @@ ItemTagsLoader::Tag ItemTagsLoader::deserializeTag(const QString &tagText)
     return tag;
 }
 
+void ItemTagsLoader::updateTagRules()
+{
+    m_tagRules.clear();
+    m_tagRules.reserve( m_tags.size() );
+    for (const auto &tag : m_tags) {
+        TagRule rule;
+        rule.tag = tag;
+        if ( !tag.match.isEmpty() )
+            rule.re = QRegExp(tag.match);
+        m_tagRules.append(rule);
+    }
+
+    m_tagsCache.clear();
+
+    // Get default tag style from theme.
+    const QSettings settings;
+    m_defaultTagColor = settings.value("Theme/num_fg").toString();
+}
+
+const ItemTagsLoader::TagRule *ItemTagsLoader::findTagRule(const QString &tagName) const
+{
+    for (const auto &rule : m_tagRules) {
+        if ( rule.tag.match.isEmpty() ? rule.tag.name == tagName : rule.re.exactMatch(tagName) )
+            return &rule;
+    }
+
+    return nullptr;
+}
+
 ItemTagsLoader::Tags ItemTagsLoader::toTags(const QString &tagsContent)
 {
+    const auto it = m_tagsCache.constFind(tagsContent);
+    if ( it != m_tagsCache.constEnd() )
+        return it.value();
+
     Tags tags;
 
     for (const auto &tagText : tagsContent.split(',', QString::SkipEmptyParts)) {
         QString tagName = tagText.trimmed();
-        Tag tag = findMatchingTag(tagName, m_tags);
+        const TagRule *rule = findTagRule(tagName);
 
-        if (isTagValid(tag)) {
-            if (tag.match.isEmpty()) {
+        Tag tag;
+        if (rule) {
+            tag = rule->tag;
+            if (tag.match.isEmpty())
                 tag.name = tagName;
-            } else {
-                const QRegExp re(tag.match);
-                tag.name = QString(tagName).replace(re, tag.name);
-            }
+            else
+                tag.name = QString(tagName).replace(rule->re, tag.name);
         } else {
             tag.name = tagName;
-
-            // Get default tag style from theme.
-            const QSettings settings;
-            tag.color = settings.value("Theme/num_fg").toString();
+            tag.color = m_defaultTagColor;
         }
 
         tags.append(tag);
     }
 
+    if ( m_tagsCache.size() >= maxCachedTagLists )
+        m_tagsCache.clear();
+    m_tagsCache.insert(tagsContent, tags);
+
     return tags;
 }
 
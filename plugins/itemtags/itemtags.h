@@ -23,6 +23,8 @@
 #include "gui/icons.h"
 #include "item/itemwidget.h"
 
+#include <QHash>
+#include <QRegExp>
 #include <QVariant>
 #include <QVector>
 #include <QWidget>
@@ -138,7 +140,7 @@ public:
 
     ItemWidget *transform(ItemWidget *itemWidget, const QModelIndex &index) override;
 
-    bool matches(const QModelIndex &index, const QRegExp &re) const override;
+    QString searchableText(const QVariantMap &data) const override;
 
     QObject *tests(const TestInterfacePtr &test) const override;
 
@@ -165,9 +167,19 @@ private:
     using Tag = ItemTags::Tag;
     using Tags = ItemTags::Tags;
 
+    /// Tag with compiled match expression.
+    struct TagRule {
+        Tag tag;
+        QRegExp re;
+    };
+
     static QString serializeTag(const Tag &tag);
     static Tag deserializeTag(const QString &tagText);
 
+    void updateTagRules();
+
+    const TagRule *findTagRule(const QString &tagName) const;
+
     Tags toTags(const QString &tagsContent);
 
     void addTagToSettingsTable(const Tag &tag = Tag());
@@ -176,6 +188,11 @@ private:
 
     QVariantMap m_settings;
     Tags m_tags;
+    QVector<TagRule> m_tagRules;
+    /// Parsed tags for tag strings from items.
+    QHash<QString, Tags> m_tagsCache;
+    /// Default tag color from theme.
+    QString m_defaultTagColor;
     std::unique_ptr<Ui::ItemTagsSettings> ui;
 
     bool m_blockDataChange;
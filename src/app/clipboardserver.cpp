@@ -102,6 +102,10 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
     connect( m_wnd, SIGNAL(requestExit()),
              this, SLOT(maybeQuit()) );
 
+    // Run scripts from commands without starting new client process.
+    connect( m_wnd, SIGNAL(requestScriptStart(ClientSocketPtr)),
+             this, SLOT(doCommand(ClientSocketPtr)) );
+
     loadSettings();
 
     // notify window if configuration changes
@@ -117,6 +121,13 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
     // Allow to run at least few client and internal threads concurrently.
     m_clientThreads.setMaxThreadCount( qMax(m_clientThreads.maxThreadCount(), 8) );
 
+    // Keep client threads with initialized script engines alive.
+    m_clientThreads.setExpiryTimeout(-1);
+
+    // Prepare script engine for first client once event loop is running
+    // (engine initialization needs to call functions in main thread).
+    QMetaObject::invokeMethod(this, "prepareScriptEngine", Qt::QueuedConnection);
+
     // run clipboard monitor
     startMonitoring();
 
@@ -305,7 +316,7 @@ void ClipboardServer::doCommand(const ClientSocketPtr &client)
     // There is no parent so as it's possible to move the worker to another thread.
     // QThreadPool takes ownership and worker will be automatically deleted
     // after run() (see QRunnable::setAutoDelete()).
-    auto worker = new ScriptableWorker(m_wnd, client, m_itemFactory->scriptableObjects(this));
+    auto worker = new ScriptableWorker(m_wnd, client, m_itemFactory, m_scriptEngineGeneration);
 
     // Terminate worker at application exit.
     connect( this, SIGNAL(terminateClientThreads()),
@@ -417,8 +428,17 @@ bool ClipboardServer::eventFilter(QObject *object, QEvent *ev)
     return false;
 }
 
+void ClipboardServer::prepareScriptEngine()
+{
+    m_clientThreads.start(
+                new ScriptableWorker(m_wnd, nullptr, m_itemFactory, m_scriptEngineGeneration) );
+}
+
 void ClipboardServer::loadSettings()
 {
+    // Script engines need to be recreated with new plugin settings.
+    ++m_scriptEngineGeneration;
+
     // reload clipboard monitor configuration
     if ( isMonitoring() )
         loadMonitorSettings();
@@ -92,6 +92,9 @@ private slots:
     void doCommand(const ClientSocketPtr &client = nullptr //!< For sending responses.
             );
 
+    /** Initialize script engine in a client thread. */
+    void prepareScriptEngine();
+
     /** New message from monitor process. */
     void newMonitorMessage(const QByteArray &message);
 
@@ -128,6 +131,7 @@ private:
     RemoteProcess *m_monitor;
     QMap<QxtGlobalShortcut*, Command> m_shortcutActions;
     QThreadPool m_clientThreads;
+    int m_scriptEngineGeneration = 0;
     QTimer m_ignoreKeysTimer;
     ItemFactory *m_itemFactory;
 };
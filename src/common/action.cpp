@@ -19,6 +19,9 @@
 
 #include "action.h"
 
+#include "common/arguments.h"
+#include "common/clientsocket.h"
+#include "common/commandstatus.h"
 #include "common/common.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
@@ -26,7 +29,10 @@
 #include "item/serialize.h"
 
 #include <QCoreApplication>
+#include <QDataStream>
+#include <QEventLoop>
 #include <QProcessEnvironment>
+#include <QTimer>
 
 #include <cstring>
 
@@ -43,6 +49,15 @@ void startProcess(QProcess *process, const QStringList &args)
     process->start(executable, args.mid(1), QIODevice::ReadWrite);
 }
 
+/// Return true if command was created from "copyq:" label (see parseCommands()).
+bool isScriptCommand(const QStringList &args)
+{
+    return args.size() > 3
+            && args[0] == "copyq"
+            && args[1] == "eval"
+            && args[2] == "--";
+}
+
 template <typename Entry, typename Container>
 void appendAndClearNonEmpty(Entry &entry, Container &containter)
 {
@@ -228,6 +243,11 @@ void Action::start()
 
     Q_ASSERT( !cmds.isEmpty() );
 
+    if ( canStartScript(cmds) ) {
+        startScript( cmds.first() );
+        return;
+    }
+
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     if (m_id != -1)
         env.insert("COPYQ_ACTION_ID", QString::number(m_id));
@@ -280,6 +300,9 @@ void Action::start()
 
 bool Action::waitForStarted(int msecs)
 {
+    if (m_scriptSocket)
+        return true;
+
     return !m_processes.isEmpty() && m_processes.last()->waitForStarted(msecs);
 }
 
@@ -288,6 +311,16 @@ bool Action::waitForFinished(int msecs)
     if ( !isRunning() )
         return true;
 
+    if (m_scriptSocket) {
+        // Sleep until action finishes (script can start next command) or timeout.
+        QEventLoop loop;
+        connect( this, SIGNAL(actionFinished(Action*)), &loop, SLOT(quit()) );
+        if (msecs >= 0)
+            QTimer::singleShot( msecs, &loop, SLOT(quit()) );
+        loop.exec();
+        return !isRunning();
+    }
+
     for ( int waitMsec = 0;
           waitMsec < msecs && !m_processes.isEmpty() && !m_processes.last()->waitForFinished(100);
           waitMsec += 100 )
@@ -300,6 +333,9 @@ bool Action::waitForFinished(int msecs)
 
 bool Action::isRunning() const
 {
+    if (m_scriptSocket)
+        return true;
+
     return !m_processes.isEmpty() && m_processes.last()->state() != QProcess::NotRunning;
 }
 
@@ -350,6 +386,11 @@ void Action::onSubProcessOutput()
 
     auto p = m_processes.last();
     const auto output = p->readAll();
+    appendOutput(output);
+}
+
+void Action::appendOutput(const QByteArray &output)
+{
     if ( output.isEmpty() )
         return;
 
@@ -395,8 +436,93 @@ void Action::onBytesWritten()
         m_processes.first()->closeWriteChannel();
 }
 
+void Action::onScriptMessageReceived(const QByteArray &message, int messageCode)
+{
+    switch (messageCode) {
+    case CommandFinished:
+        appendOutput(message);
+        finishScript(0);
+        break;
+
+    case CommandError:
+    case CommandBadSyntax:
+    case CommandException:
+        m_errorOutput.append( getTextData(message) );
+        finishScript(messageCode);
+        break;
+
+    case CommandPrint:
+        appendOutput(message);
+        break;
+
+    case CommandReadInput:
+        m_scriptSocket->sendMessage(m_input, CommandReadInputReply);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void Action::onScriptDisconnected()
+{
+    m_errorOutput.append("Connection lost!");
+    finishScript(1);
+}
+
+bool Action::canStartScript(const QList<QStringList> &cmds) const
+{
+    return cmds.size() == 1
+            && isScriptCommand(cmds.first())
+            && receivers(SIGNAL(requestScriptStart(ClientSocketPtr))) > 0;
+}
+
+void Action::startScript(const QStringList &args)
+{
+    ClientSocketPtr serverSocket;
+    ClientSocket::createLocalPair(&m_scriptSocket, &serverSocket);
+
+    connect( m_scriptSocket.get(), SIGNAL(messageReceived(QByteArray,int)),
+             this, SLOT(onScriptMessageReceived(QByteArray,int)) );
+    connect( m_scriptSocket.get(), SIGNAL(disconnected()),
+             this, SLOT(onScriptDisconnected()) );
+
+    m_scriptSocket->start();
+
+    // Pass the same arguments as client process would.
+    Arguments arguments( args.mid(1) );
+    if ( !m_workingDirectoryPath.isEmpty() )
+        arguments.setArgument( Arguments::CurrentPath, m_workingDirectoryPath.toUtf8() );
+    arguments.setArgument(
+                Arguments::ActionId, m_id == -1 ? QByteArray() : QByteArray::number(m_id) );
+    arguments.setArgument( Arguments::ActionName, m_name.toUtf8() );
+
+    QByteArray message;
+    QDataStream out(&message, QIODevice::WriteOnly);
+    out << arguments;
+    m_scriptSocket->sendMessage(message, CommandArguments);
+
+    COPYQ_LOG( QString("Starting script in server process (action %1)").arg(m_id) );
+    emit requestScriptStart(serverSocket);
+
+    if (m_currentLine == 0)
+        emit actionStarted(this);
+}
+
+void Action::finishScript(int exitCode)
+{
+    m_exitCode = exitCode;
+    start();
+}
+
 void Action::terminate()
 {
+    if (m_scriptSocket) {
+        // Script stops after connection is closed.
+        m_scriptSocket->close();
+        return;
+    }
+
     if (m_processes.isEmpty())
         return;
 
@@ -411,6 +537,12 @@ void Action::terminate()
 
 void Action::closeSubCommands()
 {
+    if (m_scriptSocket) {
+        m_scriptSocket->disconnect(this);
+        m_scriptSocket->close();
+        m_scriptSocket = nullptr;
+    }
+
     terminate();
 
     if (m_processes.isEmpty())
@@ -26,11 +26,19 @@
 #include <QVariantMap>
 #include <QVector>
 
+#include <memory>
+
+class ClientSocket;
 class QAction;
 
+using ClientSocketPtr = std::shared_ptr<ClientSocket>;
+
 /**
  * Execute external program and emits signals
  * to create or change items from the program's stdout.
+ *
+ * Scripts (commands starting with "copyq:") are executed in the server
+ * process if requestScriptStart() signal is connected.
  */
 class Action : public QObject
 {
@@ -149,6 +157,14 @@ signals:
 
     void dataChanged(const QVariantMap &data);
 
+    /**
+     * Emitted to execute script in current process instead of starting new client.
+     *
+     * Script receives arguments and input from the @a socket
+     * and sends output back.
+     */
+    void requestScriptStart(const ClientSocketPtr &socket);
+
 private slots:
     void onSubProcessError(QProcess::ProcessError error);
     void onSubProcessStarted();
@@ -157,8 +173,14 @@ private slots:
     void onSubProcessErrorOutput();
     void writeInput();
     void onBytesWritten();
+    void onScriptMessageReceived(const QByteArray &message, int messageCode);
+    void onScriptDisconnected();
 
 private:
+    bool canStartScript(const QList<QStringList> &cmds) const;
+    void startScript(const QStringList &args);
+    void finishScript(int exitCode);
+    void appendOutput(const QByteArray &output);
     void closeSubCommands();
     void actionFinished();
 
@@ -178,6 +200,7 @@ private:
     QString m_name;
     QVariantMap m_data;
     QVector<QProcess*> m_processes;
+    ClientSocketPtr m_scriptSocket;
 
     int m_exitCode;
     QString m_errorString;
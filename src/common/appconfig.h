@@ -113,6 +113,11 @@ struct show_simple_items : Config<bool> {
     static Value defaultValue() { return false; }
 };
 
+struct paint_items : Config<bool> {
+    static QString name() { return "paint_items"; }
+    static Value defaultValue() { return false; }
+};
+
 struct check_clipboard : Config<bool> {
     static QString name() { return "check_clipboard"; }
     static Value defaultValue() { return true; }
@@ -238,6 +243,14 @@ struct command_history_size : Config<int> {
     static Value defaultValue() { return 100; }
 };
 
+struct preload_tabs : Config<bool> {
+    static QString name() { return "preload_tabs"; }
+};
+
+struct item_data_compression : Config<QString> {
+    static QString name() { return "item_data_compression"; }
+};
+
 struct check_selection : Config<bool> {
     static QString name() { return "check_selection"; }
 };
@@ -60,17 +60,20 @@ bool readValue(T *value, QByteArray *message)
     return stream.status() == QDataStream::Ok;
 }
 
-bool writeMessage(QLocalSocket *socket, const QByteArray &msg)
+bool writeMessage(QLocalSocket *socket, int messageCode, const QByteArray &msg)
 {
     COPYQ_LOG_VERBOSE( QString("Write message (%1 bytes).").arg(msg.size()) );
 
     if (msg.size() > bigMessageThreshold)
         COPYQ_LOG( QString("Sending big message: %1 MiB").arg(msg.size() / 1024 / 1024) );
 
+    // Message is written directly to socket after its header without copying
+    // it to a framed message first.
+    // Length (quint32) is followed by message code (qint32) and message.
     QDataStream out(socket);
-    // length is serialized as a quint32, followed by msg
-    const auto length = static_cast<quint32>(msg.length());
-    out.writeBytes( msg.constData(), length );
+    const auto length = static_cast<quint32>( msg.length() + streamDataSize(static_cast<qint32>(messageCode)) );
+    out << length << static_cast<qint32>(messageCode);
+    out.writeRawData( msg.constData(), msg.length() );
 
     if (out.status() != QDataStream::Ok) {
         COPYQ_LOG("Cannot write message!");
@@ -138,8 +141,39 @@ ClientSocket::~ClientSocket()
     close();
 }
 
+void ClientSocket::createLocalPair(ClientSocketPtr *socket1, ClientSocketPtr *socket2)
+{
+    // Sockets can be destroyed while handling own signals.
+    const auto deleter = [](ClientSocket *socket) { socket->deleteLater(); };
+    socket1->reset(new ClientSocket, deleter);
+    socket2->reset(new ClientSocket, deleter);
+
+    for (auto socket : {socket1->get(), socket2->get()}) {
+        socket->m_local = true;
+        socket->m_closed = false;
+    }
+
+    (*socket1)->m_peer = socket2->get();
+    (*socket2)->m_peer = socket1->get();
+}
+
 void ClientSocket::start()
 {
+    if (m_local) {
+        if (m_closed) {
+            emit connectionFailed();
+            return;
+        }
+
+        SOCKET_LOG("Starting local socket.");
+        m_started = true;
+        while ( !m_pendingMessages.isEmpty() && !m_closed ) {
+            const auto message = m_pendingMessages.takeFirst();
+            emit messageReceived(message.first, message.second);
+        }
+        return;
+    }
+
     if ( !m_socket || !m_socket->waitForConnected(4000) )
     {
         emit connectionFailed();
@@ -164,16 +198,20 @@ void ClientSocket::sendMessage(const QByteArray &message, int messageCode)
 {
     SOCKET_LOG( QString("Sending message to client (exit code: %1).").arg(messageCode) );
 
-    if (!m_socket) {
+    if (m_local) {
+        if (m_closed || !m_peer) {
+            SOCKET_LOG("Client disconnected!");
+        } else {
+            QMetaObject::invokeMethod(
+                        m_peer, "onLocalMessageReceived", Qt::QueuedConnection,
+                        Q_ARG(QByteArray, message), Q_ARG(int, messageCode) );
+        }
+    } else if (!m_socket) {
         SOCKET_LOG("Cannot send message to client. Socket is already deleted.");
     } else if (m_closed) {
         SOCKET_LOG("Client disconnected!");
     } else {
-        QByteArray msg;
-        QDataStream out(&msg, QIODevice::WriteOnly);
-        out << static_cast<qint32>(messageCode);
-        out.writeRawData( message.constData(), message.length() );
-        if ( writeMessage(m_socket, msg) )
+        if ( writeMessage(m_socket, messageCode, message) )
             SOCKET_LOG("Message sent to client.");
         else
             SOCKET_LOG("Failed to send message to client!");
@@ -185,6 +223,11 @@ void ClientSocket::close()
     if (m_socket) {
         SOCKET_LOG("Disconnecting socket.");
         m_socket->disconnectFromServer();
+    } else if (m_local && !m_closed) {
+        SOCKET_LOG("Disconnecting local socket.");
+        if (m_peer)
+            QMetaObject::invokeMethod(m_peer, "close", Qt::QueuedConnection);
+        onStateChanged(QLocalSocket::UnconnectedState);
     }
 }
 
@@ -266,6 +309,17 @@ void ClientSocket::onStateChanged(QLocalSocket::LocalSocketState state)
     }
 }
 
+void ClientSocket::onLocalMessageReceived(const QByteArray &message, int messageCode)
+{
+    if (m_closed)
+        return;
+
+    if (m_started)
+        emit messageReceived(message, messageCode);
+    else
+        m_pendingMessages.append( qMakePair(message, messageCode) );
+}
+
 void ClientSocket::error(const QString &errorMessage)
 {
     log(errorMessage, LogError);
@@ -20,10 +20,17 @@
 #ifndef CLIENTSOCKET_H
 #define CLIENTSOCKET_H
 
+#include <QList>
 #include <QLocalSocket>
 #include <QObject>
+#include <QPair>
 #include <QPointer>
 
+#include <memory>
+
+class ClientSocket;
+using ClientSocketPtr = std::shared_ptr<ClientSocket>;
+
 class LocalSocketGuard
 {
 public:
@@ -54,6 +61,14 @@ public:
 
     ~ClientSocket();
 
+    /**
+     * Create pair of connected sockets for communication within the process.
+     *
+     * Messages sent to one socket are received by the other one.
+     * Both sockets must be used in the same thread.
+     */
+    static void createLocalPair(ClientSocketPtr *socket1, ClientSocketPtr *socket2);
+
     /// Return socket ID unique in process (thread-safe).
     int id() const { return m_socketId; }
 
@@ -80,6 +95,7 @@ private slots:
     void onReadyRead();
     void onError(QLocalSocket::LocalSocketError error);
     void onStateChanged(QLocalSocket::LocalSocketState state);
+    void onLocalMessageReceived(const QByteArray &message, int messageCode);
 
 private:
     void error(const QString &errorMessage);
@@ -91,6 +107,11 @@ private:
     bool m_hasMessageLength = false;
     quint32 m_messageLength = 0;
     QByteArray m_message;
+
+    bool m_local = false;
+    bool m_started = false;
+    QPointer<ClientSocket> m_peer;
+    QList< QPair<QByteArray, int> > m_pendingMessages;
 };
 
 #endif // CLIENTSOCKET_H
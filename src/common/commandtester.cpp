@@ -26,33 +26,60 @@
 #include <QProcess>
 #include <QCoreApplication>
 
+namespace {
+
+/// Limit number of remembered match command results.
+const int maxCachedResults = 1000;
+
+} // namespace
+
 CommandTester::CommandTester(QObject *parent)
     : QObject(parent)
-    , m_action(nullptr)
+    , m_maxActionCount(1)
     , m_abort(false)
     , m_restart(false)
+    , m_cacheResults(false)
+    , m_dataHash(0)
 {
 }
 
 void CommandTester::abort()
 {
     m_commands.clear();
+    m_commandIndexes.clear();
     m_data.clear();
     m_abort = true;
     m_restart = false;
+
+    // Stop running tests so they don't block new ones.
+    QList<Action*> actions;
+    for (const auto &test : m_tests) {
+        if (test.action)
+            actions.append(test.action);
+    }
+    m_tests.clear();
+
+    for (auto action : actions) {
+        m_abortedActions.insert(action);
+        action->terminate();
+    }
 }
 
 void CommandTester::setCommands(
-        const QList<Command> &commands, const QVariantMap &data)
+        const QList<Command> &commands, const QVariantMap &data, const QList<int> &commandIndexes)
 {
     abort();
     m_commands = commands;
+    m_commandIndexes = commandIndexes;
     m_data = data;
+
+    if (m_cacheResults)
+        m_dataHash = hash(m_data);
 }
 
 bool CommandTester::isCompleted() const
 {
-    return !m_action;
+    return runningActionCount() == 0 && m_abortedActions.isEmpty();
 }
 
 bool CommandTester::hasCommands() const
@@ -73,9 +100,28 @@ void CommandTester::waitForAction(Action *action)
             this, SLOT(setData(QVariantMap)));
 }
 
+void CommandTester::setMaxActionCount(int count)
+{
+    m_maxActionCount = qMax(1, count);
+}
+
+void CommandTester::setCacheResults(bool cacheResults)
+{
+    m_cacheResults = cacheResults;
+    if (m_cacheResults)
+        m_dataHash = hash(m_data);
+    else
+        clearCache();
+}
+
+void CommandTester::clearCache()
+{
+    m_cachedResults.clear();
+}
+
 void CommandTester::start()
 {
-    if (m_action)
+    if (runningActionCount() >= m_maxActionCount)
         m_restart = true;
     else
         startNext();
@@ -83,15 +129,25 @@ void CommandTester::start()
 
 void CommandTester::actionFinished()
 {
-    Q_ASSERT(m_action);
-    Q_ASSERT(!m_action->isRunning());
-
-    bool passed = !m_action->actionFailed() && m_action->exitCode() == 0;
-    m_action->deleteLater();
-    m_action = nullptr;
-
-    if (!m_abort)
-        commandPassed(passed);
+    auto action = qobject_cast<Action*>(sender());
+    Q_ASSERT(action);
+    Q_ASSERT(!action->isRunning());
+
+    const bool passed = !action->actionFailed() && action->exitCode() == 0;
+    action->deleteLater();
+
+    if ( !m_abortedActions.remove(action) ) {
+        for (auto &test : m_tests) {
+            if (test.action == action) {
+                test.action = nullptr;
+                test.passed = passed;
+                cacheResult(test.commandIndex, passed);
+                break;
+            }
+        }
+
+        emitFinishedTests();
+    }
 
     if (m_restart)
         start();
@@ -99,44 +155,101 @@ void CommandTester::actionFinished()
 
 void CommandTester::setData(const QVariantMap &data)
 {
-    if (!m_abort)
-        m_data = data;
+    if (m_abort)
+        return;
+
+    m_data = data;
+    if (m_cacheResults)
+        m_dataHash = hash(m_data);
 }
 
 void CommandTester::startNext()
 {
-    Q_ASSERT(!m_action);
-
     m_abort = false;
     m_restart = false;
 
-    if (!hasCommands())
-        return;
+    while ( hasCommands() && runningActionCount() < m_maxActionCount ) {
+        Test test;
+        test.command = m_commands.takeFirst();
+        test.commandIndex = m_commandIndexes.isEmpty() ? -1 : m_commandIndexes.takeFirst();
+        test.action = nullptr;
+        test.passed = true;
+
+        if ( test.command.matchCmd.isEmpty() || cachedResult(test.commandIndex, &test.passed) ) {
+            m_tests.append(test);
 
-    Command *command = &m_commands[0];
+            // Receiver of commandPassed() calls start() again to test next command.
+            if (m_tests.size() == 1) {
+                emitFinishedTests();
+                return;
+            }
 
-    if (command->matchCmd.isEmpty()) {
-        commandPassed(true);
-    } else {
-        m_action = new Action(this);
+            continue;
+        }
+
+        auto action = new Action(this);
 
         const QString text = getTextData(m_data);
-        m_action->setInput(text.toUtf8());
-        m_action->setData(m_data);
-        m_action->setIgnoreExitCode(true);
+        action->setInput(text.toUtf8());
+        action->setData(m_data);
+        action->setIgnoreExitCode(true);
+
+        const QString arg = getTextData(action->input());
+        action->setCommand(test.command.matchCmd, QStringList(arg));
+
+        test.action = action;
+        m_tests.append(test);
 
-        const QString arg = getTextData(m_action->input());
-        m_action->setCommand(command->matchCmd, QStringList(arg));
+        connect(action, SIGNAL(actionFinished(Action*)), SLOT(actionFinished()));
 
-        connect(m_action, SIGNAL(actionFinished(Action*)), SLOT(actionFinished()));
+        emit requestActionStart(action);
+    }
+}
+
+void CommandTester::emitFinishedTests()
+{
+    // Keep order of commands even if later tests finish first.
+    while ( !m_tests.isEmpty() && m_tests.first().action == nullptr ) {
+        const Test test = m_tests.takeFirst();
+        emit commandPassed(test.command, test.passed);
+    }
+}
 
-        emit requestActionStart(m_action);
+int CommandTester::runningActionCount() const
+{
+    int count = 0;
+    for (const auto &test : m_tests) {
+        if (test.action)
+            ++count;
     }
+    return count;
+}
+
+bool CommandTester::cachedResult(int commandIndex, bool *passed) const
+{
+    if (!m_cacheResults || commandIndex < 0)
+        return false;
+
+    const auto it = m_cachedResults.constFind( resultKey(commandIndex) );
+    if ( it == m_cachedResults.constEnd() )
+        return false;
+
+    *passed = it.value();
+    return true;
+}
+
+void CommandTester::cacheResult(int commandIndex, bool passed)
+{
+    if (!m_cacheResults || commandIndex < 0)
+        return;
+
+    if (m_cachedResults.size() >= maxCachedResults)
+        m_cachedResults.clear();
+
+    m_cachedResults.insert( resultKey(commandIndex), passed );
 }
 
-void CommandTester::commandPassed(bool passed)
+quint64 CommandTester::resultKey(int commandIndex) const
 {
-    Q_ASSERT(hasCommands());
-    const Command command = m_commands.takeFirst();
-    emit commandPassed(command, passed);
+    return (static_cast<quint64>(m_dataHash) << 32) | static_cast<quint32>(commandIndex);
 }
@@ -22,7 +22,9 @@
 
 #include "common/command.h"
 
+#include <QHash>
 #include <QObject>
+#include <QSet>
 #include <QVariant>
 
 Q_DECLARE_METATYPE(Command)
@@ -38,8 +40,14 @@ public:
     /// Stop current processing and clear commands and data.
     void abort();
 
-    /// Abort current processing set new commands and data.
-    void setCommands(const QList<Command> &commands, const QVariantMap &data);
+    /**
+     * Abort current processing set new commands and data.
+     *
+     * Results are cached (see setCacheResults()) for item data hash and
+     * @a commandIndexes which identify the commands (e.g. index in configuration).
+     */
+    void setCommands(const QList<Command> &commands, const QVariantMap &data,
+                     const QList<int> &commandIndexes = QList<int>());
 
     bool isCompleted() const;
 
@@ -50,6 +58,15 @@ public:
     /** Start next test after action finishes and update data from action. */
     void waitForAction(Action *action);
 
+    /// Set maximum number of match commands running at the same time (default is 1).
+    void setMaxActionCount(int count);
+
+    /// Remember results of match commands for the same command index and data hash.
+    void setCacheResults(bool cacheResults);
+
+    /// Forget remembered results (e.g. after commands changed).
+    void clearCache();
+
 public slots:
     void start();
 
@@ -62,14 +79,38 @@ private slots:
     void setData(const QVariantMap &data);
 
 private:
+    struct Test {
+        Command command;
+        /// Index to identify cached result (negative if not cached).
+        int commandIndex;
+        /// Running action or null if the test finished.
+        Action *action;
+        bool passed;
+    };
+
     void startNext();
-    void commandPassed(bool passed);
+    void emitFinishedTests();
+    int runningActionCount() const;
+    bool cachedResult(int commandIndex, bool *passed) const;
+    void cacheResult(int commandIndex, bool passed);
+    quint64 resultKey(int commandIndex) const;
 
     QList<Command> m_commands;
+    QList<int> m_commandIndexes;
     QVariantMap m_data;
-    Action *m_action;
+
+    /// Started tests in order of commands (results are passed in the same order).
+    QList<Test> m_tests;
+    /// Actions terminated after abort().
+    QSet<Action*> m_abortedActions;
+
+    int m_maxActionCount;
     bool m_abort;
     bool m_restart;
+
+    bool m_cacheResults;
+    uint m_dataHash;
+    QHash<quint64, bool> m_cachedResults;
 };
 
 #endif // COMMANDTESTER_H
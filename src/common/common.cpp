@@ -349,6 +349,22 @@ QString elideText(const QString &text, const QFont &font, const QString &format,
     return format.isEmpty() ? result : format.arg(result);
 }
 
+QString textLabelForText(const QString &text, int lineCount, const QFont &font, const QString &format,
+                         bool escapeAmpersands, int maxWidthPixels, int maxLines)
+{
+    QString label;
+
+    if (lineCount > 1)
+        label = QObject::tr("%1 (%n lines)", "Label for multi-line text in clipboard", lineCount);
+    else
+        label = QString("%1");
+
+    if (!format.isEmpty())
+        label = format.arg(label);
+
+    return elideText(text, font, label, escapeAmpersands, maxWidthPixels, maxLines);
+}
+
 QString textLabelForData(const QVariantMap &data, const QFont &font, const QString &format,
                          bool escapeAmpersands, int maxWidthPixels, int maxLines)
 {
@@ -363,17 +379,8 @@ QString textLabelForData(const QVariantMap &data, const QFont &font, const QStri
     } else if ( formats.contains(mimeText) ) {
         const QString text = getTextData(data);
         const int n = text.count(QChar('\n')) + 1;
-
-        if (n > 1)
-            label = QObject::tr("%1 (%n lines)", "Label for multi-line text in clipboard", n);
-        else
-            label = QString("%1");
-
-        if (!format.isEmpty())
-            label = format.arg(label);
-
         const QString textWithNotes = notes.isEmpty() ? text : notes + ": " + text;
-        return elideText(textWithNotes, font, label, escapeAmpersands, maxWidthPixels, maxLines);
+        return textLabelForText(textWithNotes, n, font, format, escapeAmpersands, maxWidthPixels, maxLines);
     } else if ( formats.indexOf(QRegExp("^image/.*")) != -1 ) {
         label = QObject::tr("<IMAGE>", "Label for image in clipboard");
     } else if ( formats.indexOf(mimeUriList) != -1 ) {
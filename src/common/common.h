@@ -103,6 +103,18 @@ QString elideText(const QString &text, const QFont &font = QFont(),
                   const QString &format = QString(), bool escapeAmpersands = false,
                   int maxWidthPixels = -1, int maxLines = 1);
 
+/**
+ * Show small label for text.
+ *
+ * @param text  text or its preview (see textPreview())
+ * @param lineCount  number of lines in whole text
+ *
+ * @see textLabelForData()
+ */
+QString textLabelForText(const QString &text, int lineCount, const QFont &font = QFont(),
+                         const QString &format = QString(), bool escapeAmpersands = false,
+                         int maxWidthPixels = -1, int maxLines = 1);
+
 /**
  * Show small label for data.
  *
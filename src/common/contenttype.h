@@ -59,7 +59,24 @@ enum {
     color,
 
     /// If true, hide content of item (not notes, tags etc.).
-    isHidden
+    isHidden,
+
+    /// Short single-line preview of text (see textPreview()).
+    previewText,
+
+    /// Number of lines of text.
+    textLineCount,
+
+    /// Item formats (QStringList of MIME types) without reading the data.
+    formats,
+
+    /**
+     * Formats for matching item with search expression (QVariantMap).
+     *
+     * Same as data but big formats kept only in tab file are omitted,
+     * except text.
+     */
+    searchData
 };
 
 }
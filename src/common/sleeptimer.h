@@ -22,31 +22,49 @@
 
 #include <QCoreApplication>
 #include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+
+/// Blocks in event loop until timer or any event wakes it (instead of busy waiting).
+inline void sleepInEventLoop(int ms)
+{
+    QEventLoop loop;
+    QTimer::singleShot(ms, &loop, SLOT(quit()));
+    loop.exec();
+}
 
 class SleepTimer
 {
 public:
-    explicit SleepTimer(int timeoutMs)
+    explicit SleepTimer(int timeoutMs, int checkIntervalMs = 5)
         : m_timeoutMs(timeoutMs)
+        , m_checkIntervalMs(checkIntervalMs)
     {
         m_timer.start();
     }
 
     bool sleep()
     {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+        const auto remainingMs = m_timeoutMs - m_timer.elapsed();
+        if (remainingMs <= 0)
+            return false;
+
+        sleepInEventLoop( static_cast<int>(qMin<qint64>(remainingMs, m_checkIntervalMs)) );
         return m_timer.elapsed() < m_timeoutMs;
     }
 
 private:
     QElapsedTimer m_timer;
     int m_timeoutMs;
+    int m_checkIntervalMs;
 };
 
 inline void waitFor(int ms)
 {
-    SleepTimer t(ms);
-    while (t.sleep()) {}
+    if (ms > 0)
+        sleepInEventLoop(ms);
+    else
+        QCoreApplication::processEvents();
 }
 
 #endif // SLEEPTIMER_H
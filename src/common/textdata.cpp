@@ -30,6 +30,19 @@
 
 namespace {
 
+/// Maximum number of characters of line in text preview.
+const int maxPreviewLength = 1024;
+
+bool isEmptyLine(const QString &text, int start, int end)
+{
+    for (int i = start; i < end; ++i) {
+        if ( !text[i].isSpace() )
+            return false;
+    }
+
+    return true;
+}
+
 QString escapeHtmlSpaces(const QString &str)
 {
     QString str2 = str;
@@ -90,6 +103,39 @@ QString getTextData(const QVariantMap &data)
     return getTextData(data, data.contains(mimeText) ? mimeText : mimeUriList);
 }
 
+QString textPreview(const QString &text)
+{
+    // Find first non-empty line without splitting whole text.
+    int start = 0;
+    int end = text.indexOf('\n');
+    if (end == -1)
+        end = text.size();
+
+    while ( end < text.size() && isEmptyLine(text, start, end) ) {
+        start = end + 1;
+        end = text.indexOf('\n', start);
+        if (end == -1)
+            end = text.size();
+    }
+
+    if ( isEmptyLine(text, start, end) ) {
+        start = 0;
+        end = text.indexOf('\n');
+        if (end == -1)
+            end = text.size();
+    }
+
+    QString preview = text.mid( start, qMin(end - start, maxPreviewLength) );
+
+    if (start != 0)
+        preview.prepend("...");
+
+    if (end != text.size() || end - start > maxPreviewLength)
+        preview.append("...");
+
+    return preview.simplified();
+}
+
 void setTextData(QVariantMap *data, const QString &text, const QString &mime)
 {
     data->insert(mime, text.toUtf8());
@@ -42,6 +42,14 @@ QString getTextData(const QVariantMap &data, const QString &mime);
 /** Helper function that calls getTextData(data, "text/plain"). */
 QString getTextData(const QVariantMap &data);
 
+/**
+ * Returns first non-empty line of text with redundant spaces removed.
+ *
+ * Line is prefixed with "..." if there are empty lines before it and
+ * suffixed with "..." if more lines follow. Very long lines are cut.
+ */
+QString textPreview(const QString &text);
+
 void setTextData(QVariantMap *data, const QString &text, const QString &mime);
 
 void setTextData(QVariantMap *data, const QString &text);
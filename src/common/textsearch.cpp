@@ -0,0 +1,198 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textsearch.h"
+
+#include <QString>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define HAS_TEXTSEARCH_SSE2
+#   include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#   include <immintrin.h>
+#endif
+
+namespace {
+
+bool isAscii(ushort c)
+{
+    return c < 0x80;
+}
+
+bool isAsciiLetter(ushort c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool equalsAt(
+        const QString &text, int position, const QString &literal, Qt::CaseSensitivity cs)
+{
+    if (cs == Qt::CaseSensitive) {
+        return std::memcmp(
+                    text.constData() + position, literal.constData(),
+                    static_cast<size_t>(literal.size()) * sizeof(QChar) ) == 0;
+    }
+
+    return QStringRef(&text, position, literal.size()).compare(literal, cs) == 0;
+}
+
+#ifdef HAS_TEXTSEARCH_SSE2
+struct Sse2 {
+    using Vector = __m128i;
+    static const int lanes = 8;
+
+    static Vector load(const ushort *data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+    static Vector set(ushort c) { return _mm_set1_epi16(static_cast<short>(c)); }
+    static Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi16(a, b); }
+    static Vector bitOr(Vector a, Vector b) { return _mm_or_si128(a, b); }
+    static Vector bitAnd(Vector a, Vector b) { return _mm_and_si128(a, b); }
+    static Vector bitNot(Vector a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+    static Vector zero() { return _mm_setzero_si128(); }
+    /// Two bits per lane.
+    static uint mask(Vector a) { return static_cast<uint>( _mm_movemask_epi8(a) ); }
+};
+#endif
+
+#ifdef __AVX2__
+struct Avx2 {
+    using Vector = __m256i;
+    static const int lanes = 16;
+
+    static Vector load(const ushort *data) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); }
+    static Vector set(ushort c) { return _mm256_set1_epi16(static_cast<short>(c)); }
+    static Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi16(a, b); }
+    static Vector bitOr(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+    static Vector bitAnd(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+    static Vector bitNot(Vector a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+    static Vector zero() { return _mm256_setzero_si256(); }
+    /// Two bits per lane.
+    static uint mask(Vector a) { return static_cast<uint>( _mm256_movemask_epi8(a) ); }
+};
+#endif
+
+/**
+ * Matches lanes which can contain given character.
+ *
+ * For case-insensitive search, lanes with any non-ASCII character are also
+ * matched since these can be equal to ASCII characters if case is ignored
+ * (e.g. Kelvin sign and 'k').
+ */
+template <typename Simd>
+class Anchor {
+public:
+    Anchor(ushort c, Qt::CaseSensitivity cs)
+        : m_c1( Simd::set(c) )
+        , m_c2( Simd::set(c) )
+        , m_nonAscii(cs == Qt::CaseInsensitive)
+        , m_asciiMask( Simd::set(0xff80) )
+    {
+        if ( m_nonAscii && isAsciiLetter(c) ) {
+            m_c1 = Simd::set( static_cast<ushort>(c | 0x20) );
+            m_c2 = Simd::set( static_cast<ushort>(c & ~0x20) );
+        }
+    }
+
+    typename Simd::Vector match(typename Simd::Vector v) const
+    {
+        auto result = Simd::bitOr( Simd::equal(v, m_c1), Simd::equal(v, m_c2) );
+        if (m_nonAscii) {
+            const auto nonAscii = Simd::bitNot(
+                        Simd::equal(Simd::bitAnd(v, m_asciiMask), Simd::zero()) );
+            result = Simd::bitOr(result, nonAscii);
+        }
+        return result;
+    }
+
+private:
+    typename Simd::Vector m_c1;
+    typename Simd::Vector m_c2;
+    bool m_nonAscii;
+    typename Simd::Vector m_asciiMask;
+};
+
+/**
+ * Finds literal by comparing first and last character of the literal with
+ * whole blocks of text and verifying only the candidate positions.
+ *
+ * @return position of literal, -1 if not found or
+ *         first position which was not checked (with @a *done set to false)
+ */
+template <typename Simd>
+int indexOfSimd(
+        const QString &text, const QString &literal, int from, Qt::CaseSensitivity cs, bool *done)
+{
+    const auto data = reinterpret_cast<const ushort*>( text.constData() );
+    const int last = literal.size() - 1;
+    const Anchor<Simd> first( literal[0].unicode(), cs );
+    const Anchor<Simd> end( literal[last].unicode(), cs );
+
+    int i = from;
+    for ( ; i + last + Simd::lanes <= text.size(); i += Simd::lanes ) {
+        const auto candidates = Simd::bitAnd(
+                    first.match(Simd::load(data + i)),
+                    end.match(Simd::load(data + i + last)) );
+
+        const uint mask = Simd::mask(candidates);
+        if (mask == 0)
+            continue;
+
+        for (int lane = 0; lane < Simd::lanes; ++lane) {
+            if ( (mask & (1u << (2 * lane))) && equalsAt(text, i + lane, literal, cs) ) {
+                *done = true;
+                return i + lane;
+            }
+        }
+    }
+
+    *done = false;
+    return i;
+}
+
+} // namespace
+
+int indexOfLiteral(const QString &text, const QString &literal, int from, Qt::CaseSensitivity cs)
+{
+    if ( literal.isEmpty() || literal.size() > text.size() - from )
+        return text.indexOf(literal, from, cs);
+
+    // Lanes can be compared with non-ASCII characters only if case matters.
+    if ( cs == Qt::CaseInsensitive
+         && (!isAscii(literal[0].unicode()) || !isAscii(literal[literal.size() - 1].unicode())) )
+    {
+        return text.indexOf(literal, from, cs);
+    }
+
+#if defined(__AVX2__) || defined(HAS_TEXTSEARCH_SSE2)
+    bool done;
+#   ifdef __AVX2__
+    from = indexOfSimd<Avx2>(text, literal, from, cs, &done);
+#   else
+    from = indexOfSimd<Sse2>(text, literal, from, cs, &done);
+#   endif
+    if (done)
+        return from;
+#endif
+
+    // Check remaining positions (shorter than a block).
+    return text.indexOf(literal, from, cs);
+}
@@ -0,0 +1,37 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+
+#include <Qt>
+
+class QString;
+
+/**
+ * Returns position of first occurrence of @a literal in @a text
+ * starting at @a from or -1 if not found.
+ *
+ * Same as QString::indexOf() but faster for long texts since it uses SIMD
+ * instructions (if available) to find candidate positions.
+ */
+int indexOfLiteral(const QString &text, const QString &literal, int from = 0,
+                   Qt::CaseSensitivity cs = Qt::CaseSensitive);
+
+#endif // TEXTSEARCH_H
@@ -112,6 +112,8 @@ void ActionHandler::action(Action *action)
              this, SLOT(closeAction(Action*)) );
     connect( action, SIGNAL(actionError(Action*)),
              this, SLOT(closeAction(Action*)) );
+    connect( action, SIGNAL(requestScriptStart(ClientSocketPtr)),
+             this, SIGNAL(requestScriptStart(ClientSocketPtr)) );
 
     ++m_actionCounter;
 
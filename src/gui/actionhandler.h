@@ -28,7 +28,10 @@
 #include <QPointer>
 #include <QMap>
 
+#include <memory>
+
 class Action;
+class ClientSocket;
 class ActionDialog;
 class ProcessManagerDialog;
 class ClipboardBrowser;
@@ -36,6 +39,8 @@ class QDialog;
 class MainWindow;
 class QModelIndex;
 
+using ClientSocketPtr = std::shared_ptr<ClientSocket>;
+
 /**
  * Creates action dialog and handles actions created by the dialog.
  */
@@ -71,6 +76,9 @@ signals:
     /** Emitted new action starts or ends. */
     void runningActionsCountChanged();
 
+    /** Emitted if action requests to execute script in current process. */
+    void requestScriptStart(const ClientSocketPtr &socket);
+
 private slots:
     /** Called after action was started (creates menu item to kill it). */
     void actionStarted(Action *action);
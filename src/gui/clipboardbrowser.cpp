@@ -37,6 +37,7 @@
 #include "item/itemwidget.h"
 
 #include <QApplication>
+#include <QBitArray>
 #include <QDrag>
 #include <QKeyEvent>
 #include <QMimeData>
@@ -47,6 +48,7 @@
 #include <QPainter>
 #include <QProcess>
 #include <QScrollBar>
+#include <QThreadPool>
 #include <QTemporaryFile>
 #include <QUrl>
 #include <QElapsedTimer>
@@ -57,6 +59,9 @@
 
 namespace {
 
+/// Number of items to filter immediately, rest is filtered in background.
+const int syncFilterRowCount = 500;
+
 /// Save drag'n'drop image data in temporary file (required by some applications).
 class TemporaryDragAndDropImage : public QObject {
 public:
@@ -156,6 +161,7 @@ ClipboardBrowser::ClipboardBrowser(
     , m_tabName(tabName)
     , m(this)
     , d(this, sharedData)
+    , m_journal(&m)
     , m_editor(nullptr)
     , m_sharedData(sharedData)
     , m_dragTargetRow(-1)
@@ -176,6 +182,7 @@ ClipboardBrowser::ClipboardBrowser(
     initSingleShotTimer( &m_timerSave, 30000, this, SLOT(saveItems()) );
     initSingleShotTimer( &m_timerEmitItemCount, 0, this, SLOT(emitItemCount()) );
     initSingleShotTimer( &m_timerUpdateSizes, 0, this, SLOT(updateSizes()) );
+    initSingleShotTimer( &m_timerRestartFiltering, 0, this, SLOT(restartFiltering()) );
 
     // ScrollPerItem doesn't work well with hidden items
     setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
@@ -194,8 +201,36 @@ ClipboardBrowser::ClipboardBrowser(
 
 ClipboardBrowser::~ClipboardBrowser()
 {
+    cancelFiltering();
     d.invalidateCache();
     saveUnsavedItems();
+
+    if ( isLoaded() && !m_tabName.isEmpty() ) {
+        if (m_sharedData->itemFactory)
+            saveItemSearchFile(m_tabName, m, m_itemSaver, *m_sharedData->itemFactory);
+        saveItemHeights(m_tabName, m, *d.heightCache(), m_itemSaver);
+    }
+}
+
+QList<int> ClipboardBrowser::findItems(const QRegExp &re)
+{
+    QList<int> rows;
+    if ( !loadItems() || !m_sharedData->itemFactory )
+        return rows;
+
+    QSet<uint> itemHashes;
+    const bool useIndex = !filterMatchesFormats(re) && m.searchCandidates(re, &itemHashes);
+    const TextMatcher matcher(re);
+
+    for (int row = 0; row < length(); ++row) {
+        const QModelIndex ind = m.index(row);
+        if ( useIndex && !itemHashes.contains(ind.data(contentType::hash).toUInt()) )
+            continue;
+        if ( m_sharedData->itemFactory->matches(ind, matcher) )
+            rows.append(row);
+    }
+
+    return rows;
 }
 
 bool ClipboardBrowser::moveToClipboard(uint itemHash)
@@ -263,12 +298,23 @@ bool ClipboardBrowser::isFiltered(int row) const
     const QModelIndex ind = m.index(row);
     return m_filterRow != row
             && m_sharedData->itemFactory
-            && !m_sharedData->itemFactory->matches( ind, d.searchExpression() );
+            && !m_sharedData->itemFactory->matches(ind, m_filterMatcher);
 }
 
 bool ClipboardBrowser::hideFiltered(int row)
 {
     const bool hide = isFiltered(row);
+    setRowFiltered(row, hide);
+    return hide;
+}
+
+bool ClipboardBrowser::hideFiltered(const QModelIndex &index)
+{
+    return hideFiltered(index.row());
+}
+
+void ClipboardBrowser::setRowFiltered(int row, bool hide)
+{
     setRowHidden(row, hide);
 
     auto w = d.cacheOrNull(row);
@@ -278,13 +324,133 @@ bool ClipboardBrowser::hideFiltered(int row)
         else
             d.highlightMatches(w);
     }
+}
 
-    return hide;
+void ClipboardBrowser::startFiltering()
+{
+    cancelFiltering();
+
+    // Reuse results if search expression only changes to previous or refined one.
+    bool restored;
+    const QBitArray previousHidden = m_filterCache.begin(d.searchExpression(), &restored);
+    if ( restored && previousHidden.size() == length() ) {
+        restoreFiltered(previousHidden);
+        return;
+    }
+
+    const bool filterInBackground =
+            !d.searchExpression().isEmpty() && m_itemSaver && m_sharedData->itemFactory;
+    const int syncRowCount = filterInBackground ? qMin(length(), syncFilterRowCount) : length();
+
+    // Rows which are not candidates are hidden without matching.
+    QBitArray candidates = filterCandidates();
+    if ( !restored && previousHidden.size() == length() ) {
+        if ( candidates.isEmpty() )
+            candidates = ~previousHidden;
+        else
+            candidates &= ~previousHidden;
+    }
+    const auto hideRow = [&](int row) {
+        if ( candidates.isEmpty() || candidates.testBit(row) || row == m_filterRow )
+            return hideFiltered(row);
+        setRowFiltered(row, true);
+        return true;
+    };
+
+    int row = 0;
+    for ( ; row < syncRowCount && hideRow(row); ++row ) {}
+
+    m_filterSetCurrent = row == syncRowCount && syncRowCount < length();
+    setCurrentIndex( m_filterSetCurrent ? QModelIndex() : index(row) );
+
+    for ( ; row < syncRowCount; ++row )
+        hideRow(row);
+
+    if ( m_filterRow >= 0 && m_filterRow < m.rowCount() ) {
+        setCurrentIndex( index(m_filterRow) );
+        m_filterSetCurrent = false;
+    }
+
+    if ( syncRowCount < length() )
+        startFilterTask(syncRowCount, candidates);
+    else
+        m_filterCache.setResult( filteredRows() );
 }
 
-bool ClipboardBrowser::hideFiltered(const QModelIndex &index)
+void ClipboardBrowser::restoreFiltered(const QBitArray &hidden)
 {
-    return hideFiltered(index.row());
+    int firstVisibleRow = -1;
+    for (int row = 0; row < length(); ++row) {
+        const bool hide = hidden.testBit(row) && row != m_filterRow;
+        setRowFiltered(row, hide);
+        if (!hide && firstVisibleRow == -1)
+            firstVisibleRow = row;
+    }
+
+    m_filterSetCurrent = false;
+    if ( m_filterRow >= 0 && m_filterRow < length() )
+        setCurrentIndex( index(m_filterRow) );
+    else
+        setCurrentIndex( index(firstVisibleRow) );
+}
+
+QBitArray ClipboardBrowser::filteredRows() const
+{
+    QBitArray hidden( length() );
+    for (int row = 0; row < length(); ++row) {
+        if ( isRowHidden(row) )
+            hidden.setBit(row);
+    }
+
+    return hidden;
+}
+
+void ClipboardBrowser::startFilterTask(int firstRow, const QBitArray &candidates)
+{
+    cancelFiltering();
+
+    const QRegExp &re = d.searchExpression();
+    // Task collects item texts from copies of items so rows can change while it runs.
+    const auto items = std::make_shared<const QVector<ClipboardItem>>( m.items() );
+    m_filterTask = new ItemFilterTask(
+                items, m_sharedData->itemFactory->enabledLoaders(),
+                firstRow, m_filterMatcher, m_filterRow );
+    m_filterTask->setCandidates(candidates);
+
+    connect( m_filterTask, SIGNAL(rowsFiltered(int,QBitArray)),
+             this, SLOT(onRowsFiltered(int,QBitArray)) );
+    connect( m_filterTask, SIGNAL(finished()),
+             this, SLOT(onFilterFinished()) );
+    connect( m_filterTask, SIGNAL(finished()),
+             m_filterTask, SLOT(deleteLater()) );
+
+    QThreadPool::globalInstance()->start(m_filterTask);
+}
+
+void ClipboardBrowser::cancelFiltering()
+{
+    if (m_filterTask) {
+        // Task deletes itself when finished.
+        m_filterTask->cancel();
+        m_filterTask = nullptr;
+    }
+}
+
+QBitArray ClipboardBrowser::filterCandidates()
+{
+    const QRegExp &re = d.searchExpression();
+    QSet<uint> itemHashes;
+    if ( filterMatchesFormats(re) || !m.searchCandidates(re, &itemHashes) )
+        return QBitArray();
+
+    QBitArray candidates( length() );
+    for (int row = 0; row < length(); ++row) {
+        const uint itemHash = m.index(row).data(contentType::hash).toUInt();
+        if ( itemHashes.contains(itemHash) )
+            candidates.setBit(row);
+    }
+
+    return candidates;
 }
 
 bool ClipboardBrowser::startEditor(QObject *editor, bool changeClipboard)
@@ -438,6 +604,25 @@ void ClipboardBrowser::connectModelAndDelegate()
     connect( &m, SIGNAL(rowsInserted(QModelIndex,int,int)),
              SLOT(onRowsInserted(QModelIndex,int,int)));
 
+    // Filtering in background
+    connect( &m, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+             SLOT(invalidateFilterCache()) );
+    connect( &m, SIGNAL(layoutChanged()),
+             SLOT(invalidateFilterCache()) );
+    connect( &m, SIGNAL(modelReset()),
+             SLOT(invalidateFilterCache()) );
+
+    connect( &m, SIGNAL(rowsInserted(QModelIndex,int,int)),
+             SLOT(onFilteredRowsChanged()) );
+    connect( &m, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+             SLOT(onFilteredRowsChanged()) );
+    connect( &m, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+             SLOT(onFilteredRowsChanged()) );
+    connect( &m, SIGNAL(layoutChanged()),
+             SLOT(onFilteredRowsChanged()) );
+    connect( &m, SIGNAL(modelReset()),
+             SLOT(onFilteredRowsChanged()) );
+
     // Item count change
     connect( &m, SIGNAL(rowsInserted(QModelIndex,int,int)),
              SLOT(onItemCountChanged()) );
@@ -541,19 +726,15 @@ void ClipboardBrowser::preload(int pixels, bool above, const QModelIndex &curren
         if ( isRowHidden(row) ) {
             d.invalidateCache(row);
         } else {
-            itemWidget(ind);
+            cacheItem(ind);
             y += s + d.sizeHint(ind).height();
         }
         row += direction;
     }
 
     // Unload item widgets below the threshold (unloding pixels above would change the scroll offset).
-    if (!above) {
-        for ( auto ind = index(row); ind.isValid(); ind = index(row) ) {
-            d.invalidateCache(row);
-            row += direction;
-        }
-    }
+    if (!above)
+        d.invalidateCacheFromRow(row);
 }
 
 void ClipboardBrowser::moveToTop(const QModelIndex &index)
@@ -564,7 +745,7 @@ void ClipboardBrowser::moveToTop(const QModelIndex &index)
     const auto data = index.data(contentType::data).toMap();
     if ( m_itemSaver->canMoveItems(QList<QModelIndex>() << index) ) {
         m.removeRow( index.row() );
-        m.insertItem(data, 0);
+        m.insertItem( data, m_itemSaver->insertionRow(m, 0) );
     }
 }
 
@@ -735,6 +916,54 @@ void ClipboardBrowser::onRowsInserted(const QModelIndex &, int first, int)
     }
 }
 
+void ClipboardBrowser::onRowsFiltered(int firstRow, const QBitArray &hidden)
+{
+    // Ignore results from cancelled task.
+    if (sender() != m_filterTask)
+        return;
+
+    for (int i = 0; i < hidden.size(); ++i) {
+        const int row = firstRow + i;
+        const bool hide = hidden.testBit(i);
+        setRowFiltered(row, hide);
+
+        if (m_filterSetCurrent && !hide) {
+            m_filterSetCurrent = false;
+            setCurrentIndex( index(row) );
+        }
+    }
+}
+
+void ClipboardBrowser::onFilterFinished()
+{
+    if (sender() == m_filterTask) {
+        m_filterTask = nullptr;
+        m_filterCache.setResult( filteredRows() );
+    }
+}
+
+void ClipboardBrowser::onFilteredRowsChanged()
+{
+    m_filterCache.clear();
+
+    // Rows in filter results no longer match model rows.
+    if (m_filterTask) {
+        cancelFiltering();
+        m_timerRestartFiltering.start();
+    }
+}
+
+void ClipboardBrowser::invalidateFilterCache()
+{
+    m_filterCache.clear();
+}
+
+void ClipboardBrowser::restartFiltering()
+{
+    if ( !d.searchExpression().isEmpty() )
+        startFilterTask( 0, filterCandidates() );
+}
+
 void ClipboardBrowser::onItemCountChanged()
 {
     if (!m_timerEmitItemCount.isActive())
@@ -920,22 +1149,11 @@ void ClipboardBrowser::paintEvent(QPaintEvent *e)
 {
     // Hide items outside viewport.
     const auto firstVisibleIndex = indexNear(0);
-    if ( firstVisibleIndex.isValid() ) {
-        for (int row = firstVisibleIndex.row() - 1; row >= 0; --row) {
-            auto w = d.cacheOrNull(row);
-            if (w)
-                w->widget()->hide();
-        }
-    }
     const int h = viewport()->contentsRect().height();
     const auto lastVisibleIndex = indexNear(h - spacing());
-    if ( lastVisibleIndex.isValid() ) {
-        for (int row = lastVisibleIndex.row() + 1; row < m.rowCount(); ++row) {
-            auto w = d.cacheOrNull(row);
-            if (w)
-                w->widget()->hide();
-        }
-    }
+    d.hideWidgetsOutside(
+                firstVisibleIndex.isValid() ? firstVisibleIndex.row() : 0,
+                lastVisibleIndex.isValid() ? lastVisibleIndex.row() : m.rowCount() );
 
     QListView::paintEvent(e);
 
@@ -1151,6 +1369,7 @@ void ClipboardBrowser::filterItems(const QRegExp &re)
         return;
 
     d.setSearch(re);
+    m_filterMatcher = TextMatcher(re);
 
     if ( isInternalEditorOpen() ) {
         m_editor->search(re);
@@ -1163,16 +1382,7 @@ void ClipboardBrowser::filterItems(const QRegExp &re)
     if (!ok)
         m_filterRow = -1;
 
-    int row = 0;
-    for ( ; row < length() && hideFiltered(row); ++row ) {}
-
-    setCurrentIndex(index(row));
-
-    for ( ; row < length(); ++row )
-        hideFiltered(row);
-
-    if ( ok && m_filterRow >= 0 && m_filterRow < m.rowCount() )
-        setCurrentIndex( index(m_filterRow) );
+    startFiltering();
 }
 
 void ClipboardBrowser::moveToClipboard(const QModelIndex &ind)
@@ -1425,7 +1635,7 @@ bool ClipboardBrowser::add(const QVariantMap &data, int row)
 
     // create new item
     const int newRow = row < 0 ? m.rowCount() : qMin(row, m.rowCount());
-    m.insertItem(data, newRow);
+    m.insertItem( data, m_itemSaver ? m_itemSaver->insertionRow(m, newRow) : newRow );
 
     delayedSaveItems();
 
@@ -1505,10 +1715,15 @@ bool ClipboardBrowser::loadItems()
     m_itemSaver = ::loadItems(m_tabName, m, m_sharedData->itemFactory, m_sharedData->maxItems);
     m.blockSignals(false);
 
+    m_journal.clear();
+
     if ( !isLoaded() )
         return false;
 
     d.rowsInserted(QModelIndex(), 0, m.rowCount());
+    loadItemHeights(m_tabName, d.heightCache());
+    d.estimateItemHeights();
+    m.buildSearchIndex();
     if ( hasFocus() )
         setCurrent(0);
     onItemCountChanged();
@@ -1523,7 +1738,14 @@ bool ClipboardBrowser::saveItems()
     if ( !isLoaded() || m_tabName.isEmpty() )
         return false;
 
-    return ::saveItems(m_tabName, m, m_itemSaver);
+    if ( !::saveItems(m_tabName, m, m_itemSaver, &m_journal) )
+        return false;
+
+    // Keep search file up-to-date in case the application doesn't exit normally.
+    if (m_sharedData->itemFactory)
+        saveItemSearchFile(m_tabName, m, m_itemSaver, *m_sharedData->itemFactory);
+
+    return true;
 }
 
 void ClipboardBrowser::moveToClipboard()
@@ -1558,6 +1780,7 @@ void ClipboardBrowser::purgeItems()
 
     removeItems(tabName());
     m_timerSave.stop();
+    m_journal.clear();
 }
 
 const QString ClipboardBrowser::selectedText() const
@@ -1628,6 +1851,11 @@ ItemWidget *ClipboardBrowser::itemWidget(const QModelIndex &index)
     return d.cache(index);
 }
 
+void ClipboardBrowser::cacheItem(const QModelIndex &index)
+{
+    d.cacheItem(index);
+}
+
 bool ClipboardBrowser::isInternalEditorOpen() const
 {
     return m_editor != nullptr;
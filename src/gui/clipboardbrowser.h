@@ -26,6 +26,8 @@
 #include "gui/theme.h"
 #include "item/clipboardmodel.h"
 #include "item/itemdelegate.h"
+#include "item/itemfilter.h"
+#include "item/itemstore.h"
 #include "item/itemwidget.h"
 
 #include <QListView>
@@ -37,6 +39,7 @@
 
 class ItemEditorWidget;
 class ItemFactory;
+class QBitArray;
 class QProgressBar;
 class QPushButton;
 
@@ -152,6 +155,13 @@ class ClipboardBrowser : public QListView
         /** Number of items in list. */
         int length() const { return m.rowCount(); }
 
+        /**
+         * Find rows of items matching @a re (loads items if needed).
+         *
+         * Uses search index of items to skip items which cannot match.
+         */
+        QList<int> findItems(const QRegExp &re);
+
         /** Receive key event. */
         void keyEvent(QKeyEvent *event) { keyPressEvent(event); }
         /** Move item to clipboard. */
@@ -204,6 +214,9 @@ class ClipboardBrowser : public QListView
 
         ItemWidget *itemWidget(const QModelIndex & index);
 
+        /** Prepare item for rendering (creates widget only if needed). */
+        void cacheItem(const QModelIndex &index);
+
         /**
          * Load items from configuration.
          * This function does nothing if model is disabled (e.g. loading failed previously).
@@ -318,6 +331,22 @@ class ClipboardBrowser : public QListView
          */
         void updateSizes();
 
+        void onRowsFiltered(int firstRow, const QBitArray &hidden);
+
+        void onFilterFinished();
+
+        /**
+         * Invalidates filter results and restarts filtering in background
+         * if needed.
+         */
+        void onFilteredRowsChanged();
+
+        /// Drops results of previous search expressions (items changed).
+        void invalidateFilterCache();
+
+        /// Filters all items again in background (keeps current item).
+        void restartFiltering();
+
     private:
         bool isLoaded() const;
 
@@ -330,6 +359,34 @@ class ClipboardBrowser : public QListView
         bool hideFiltered(int row);
         bool hideFiltered(const QModelIndex &index);
 
+        void setRowFiltered(int row, bool hide);
+
+        /**
+         * Filters first items immediately and starts filtering rest of the
+         * items in background.
+         */
+        void startFiltering();
+
+        /// Hides rows using cached results of the current search expression.
+        void restoreFiltered(const QBitArray &hidden);
+
+        /// Returns rows currently hidden by filter.
+        QBitArray filteredRows() const;
+
+        /**
+         * Starts filtering items from @a firstRow in background.
+         * Only rows in @a candidates are matched (if not empty).
+         */
+        void startFilterTask(int firstRow, const QBitArray &candidates);
+
+        void cancelFiltering();
+
+        /**
+         * Returns rows which can match current search expression using search
+         * index or empty bit array if all rows need to be matched.
+         */
+        QBitArray filterCandidates();
+
         /**
          * Connects signals and starts external editor.
          */
@@ -380,6 +437,7 @@ class ClipboardBrowser : public QListView
         QString m_tabName;
         ClipboardModel m;
         ItemDelegate d;
+        ItemJournal m_journal;
         QTimer m_timerSave;
         QTimer m_timerEmitItemCount;
         QTimer m_timerUpdateSizes;
@@ -394,6 +452,14 @@ class ClipboardBrowser : public QListView
         QPoint m_dragStartPosition;
 
         int m_filterRow = -1;
+
+        ItemFilterTask *m_filterTask = nullptr;
+        ItemFilterCache m_filterCache;
+        /// Matcher for current search expression.
+        TextMatcher m_filterMatcher;
+        /// Current item should be set to first item matched in background.
+        bool m_filterSetCurrent = false;
+        QTimer m_timerRestartFiltering;
 };
 
 #endif // CLIPBOARDBROWSER_H
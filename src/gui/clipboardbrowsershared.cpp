@@ -21,6 +21,60 @@
 
 #include "common/appconfig.h"
 
+#include <QDataStream>
+#include <QSettings>
+#include <QStringList>
+
+namespace {
+
+/// Returns hash of settings which can change size of items.
+uint hashItemLayoutSettings(const ClipboardBrowserShared &shared)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+
+    QSettings settings;
+    for ( const auto &group : QStringList() << "Theme" << "Plugins" ) {
+        settings.beginGroup(group);
+        QStringList keys = settings.allKeys();
+        keys.sort();
+        for (const auto &key : keys)
+            stream << key << settings.value(key);
+        settings.endGroup();
+    }
+
+    stream << shared.textWrap << shared.showSimpleItems << shared.paintItems;
+
+    return qHash(bytes);
+}
+
+/// Reads options of item plugins which painted items need to follow.
+PaintedItemSettings loadPaintedItemSettings()
+{
+    PaintedItemSettings paintedItemSettings;
+
+    QSettings settings;
+    settings.beginGroup("Plugins");
+
+    settings.beginGroup("itemtext");
+    paintedItemSettings.paintText = settings.value("enabled", true).toBool();
+    paintedItemSettings.useRichText = settings.value("use_rich_text", true).toBool();
+    paintedItemSettings.maxLines = settings.value("max_lines", 0).toInt();
+    paintedItemSettings.maxHeight = settings.value("max_height", 0).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("itemimage");
+    paintedItemSettings.paintImages = settings.value("enabled", true).toBool();
+    paintedItemSettings.maxImageSize = QSize(
+                settings.value("max_image_width", 320).toInt(),
+                settings.value("max_image_height", 240).toInt() );
+    settings.endGroup();
+
+    return paintedItemSettings;
+}
+
+} // namespace
+
 ClipboardBrowserShared::ClipboardBrowserShared(ItemFactory *itemFactory)
     : editor()
     , maxItems(100)
@@ -29,6 +83,8 @@ ClipboardBrowserShared::ClipboardBrowserShared(ItemFactory *itemFactory)
     , saveOnReturnKey(false)
     , moveItemOnReturnKey(false)
     , showSimpleItems(false)
+    , paintItems(false)
+    , itemLayoutKey(0)
     , minutesToExpire(0)
     , itemFactory(itemFactory)
 {
@@ -44,5 +100,8 @@ void ClipboardBrowserShared::loadFromConfiguration()
     saveOnReturnKey = !appConfig.option<Config::edit_ctrl_return>();
     moveItemOnReturnKey = appConfig.option<Config::move>();
     showSimpleItems = appConfig.option<Config::show_simple_items>();
+    paintItems = appConfig.option<Config::paint_items>();
     minutesToExpire = appConfig.option<Config::expire_tab>();
+    paintedItemSettings = loadPaintedItemSettings();
+    itemLayoutKey = hashItemLayoutSettings(*this);
 }
@@ -20,6 +20,7 @@
 #define CLIPBOARDBROWSERSHARED_H
 
 #include "gui/theme.h"
+#include "item/painteditem.h"
 
 #include <QString>
 
@@ -39,8 +40,15 @@ struct ClipboardBrowserShared {
     bool saveOnReturnKey;
     bool moveItemOnReturnKey;
     bool showSimpleItems;
+    bool paintItems;
     int minutesToExpire;
 
+    /// Options of item plugins for painted items (see PaintedItem).
+    PaintedItemSettings paintedItemSettings;
+
+    /// Hash of settings which affect size of items (see ItemHeightCache).
+    uint itemLayoutKey;
+
     ItemFactory *itemFactory;
 
     Theme theme;
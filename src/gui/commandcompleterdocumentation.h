@@ -37,6 +37,7 @@ void addDocumentation(AddDocumentationCallback addDocumentation)
     addDocumentation("renameTab", "renameTab(tabName, newTabName)", "Renames tab.");
     addDocumentation("tabIcon", "String tabIcon(tabName)", "Returns path to icon for tab.");
     addDocumentation("tabIcon", "tabIcon(tabName, iconPath)", "Sets icon for tab.");
+    addDocumentation("searchAllTabs", "Object[] searchAllTabs(pattern)", "Returns items matching regular expression in all tabs.");
     addDocumentation("count", "count(), length(), size()", "Returns amount of items in current tab.");
     addDocumentation("select", "select(row)", "Copies item in the row to clipboard.");
     addDocumentation("next", "next()", "Copies next item from current tab to clipboard.");
@@ -216,6 +216,7 @@ void ConfigurationManager::initOptions()
     bind<Config::notification_maximum_height>(ui->spinBoxNotificationMaximumHeight);
     bind<Config::edit_ctrl_return>(ui->checkBoxEditCtrlReturn);
     bind<Config::show_simple_items>(ui->checkBoxShowSimpleItems);
+    bind<Config::preload_tabs>(ui->checkBoxPreloadTabs);
     bind<Config::move>(ui->checkBoxMove);
     bind<Config::check_clipboard>(ui->checkBoxClip);
     bind<Config::confirm_exit>(ui->checkBoxConfirmExit);
@@ -248,6 +249,8 @@ void ConfigurationManager::initOptions()
 
     /* other options */
     bind<Config::command_history_size>();
+    bind<Config::item_data_compression>();
+    bind<Config::paint_items>();
 #ifdef HAS_MOUSE_SELECTIONS
     /* X11 clipboard selection monitoring and synchronization */
     bind<Config::check_selection>(ui->checkBoxSel);
@@ -57,6 +57,7 @@
 #include "gui/traymenu.h"
 #include "gui/windowgeometryguard.h"
 #include "item/itemfactory.h"
+#include "item/itemstore.h"
 #include "item/serialize.h"
 #include "platform/platformnativeinterface.h"
 #include "platform/platformwindow.h"
@@ -98,6 +99,12 @@ const QIcon iconTabRename() { return getIconFromResources("tab_rename"); }
 
 const char propertyWidgetSizeGuarded[] = "CopyQ_widget_size_guarded";
 
+/// Maximum number of menu match commands running at the same time.
+const int maxMenuCommandTests = 4;
+
+/// Time to keep items read in background for tabs which are not opened.
+const int preloadedTabsTimeoutMs = 5 * 60 * 1000;
+
 /// Omit size changes of a widget.
 class WidgetSizeGuard final : public QObject {
 public:
@@ -516,6 +523,8 @@ MainWindow::MainWindow(ItemFactory *itemFactory, QWidget *parent)
              this, SLOT(findNextOrPrevious()) );
     connect( m_actionHandler, SIGNAL(runningActionsCountChanged()),
              this, SLOT(updateIconSnip()) );
+    connect( m_actionHandler, SIGNAL(requestScriptStart(ClientSocketPtr)),
+             this, SIGNAL(requestScriptStart(ClientSocketPtr)) );
     connect( qApp, SIGNAL(aboutToQuit()),
              this, SLOT(onAboutToQuit()) );
     connect( this, SIGNAL(configurationChanged()),
@@ -535,6 +544,12 @@ MainWindow::MainWindow(ItemFactory *itemFactory, QWidget *parent)
     connect(&m_automaticCommandTester, SIGNAL(requestActionStart(Action*)),
             m_actionHandler, SLOT(action(Action*)));
 
+    // Automatic commands must run in order; menu items can be enabled in any order.
+    for (auto tester : {&m_itemMenuCommandTester, &m_trayMenuCommandTester}) {
+        tester->setMaxActionCount(maxMenuCommandTests);
+        tester->setCacheResults(true);
+    }
+
     connect(itemFactory, SIGNAL(error(QString)),
             this, SLOT(showError(QString)));
     connect(itemFactory, SIGNAL(addCommands(QList<Command>)),
@@ -543,6 +558,9 @@ MainWindow::MainWindow(ItemFactory *itemFactory, QWidget *parent)
     m_commands = loadEnabledCommands();
     loadSettings();
 
+    if ( AppConfig().option<Config::preload_tabs>() )
+        preloadTabs();
+
     ui->tabWidget->setCurrentIndex(0);
 
     initSingleShotTimer( &m_timerUpdateFocusWindows, 50, this, SLOT(updateFocusWindows()) );
@@ -920,6 +938,7 @@ void MainWindow::onAboutToQuit()
 void MainWindow::onCommandDialogSaved()
 {
     m_commands = loadEnabledCommands();
+    clearMenuCommandResults();
     updateContextMenu();
     emit commandsSaved();
 }
@@ -1080,6 +1099,12 @@ void MainWindow::addCommandsToTrayMenu(const Command &command, bool passed)
     m_trayMenuCommandTester.start();
 }
 
+void MainWindow::clearMenuCommandResults()
+{
+    m_itemMenuCommandTester.clearCache();
+    m_trayMenuCommandTester.clearCache();
+}
+
 void MainWindow::nextItemFormat()
 {
     auto c = browser();
@@ -1462,6 +1487,26 @@ QAction *MainWindow::addTrayAction(int id)
     return act;
 }
 
+void MainWindow::preloadTabs()
+{
+    QStringList tabNames;
+    for ( int i = 0; i < ui->tabWidget->count(); ++i ) {
+        const auto placeholder = getPlaceholder(i);
+        if ( !placeholder->browser() )
+            tabNames.append( placeholder->tabName() );
+    }
+
+    preloadItems(tabNames, m_sharedData->maxItems);
+
+    // Don't keep items of tabs which user doesn't open soon.
+    QTimer::singleShot(preloadedTabsTimeoutMs, this, SLOT(dropPreloadedTabs()));
+}
+
+void MainWindow::dropPreloadedTabs()
+{
+    dropUnusedPreloadedItems();
+}
+
 void MainWindow::updateTabIcon(const QString &newName, const QString &oldName)
 {
     const QString icon = getIconNameForTabName(oldName);
@@ -1478,15 +1523,18 @@ QAction *MainWindow::addItemAction(int id, QObject *receiver, const char *slot)
     return act;
 }
 
-QList<Command> MainWindow::commandsForMenu(const QVariantMap &data, const QString &tabName)
+QList<Command> MainWindow::commandsForMenu(
+        const QVariantMap &data, const QString &tabName, QList<int> *commandIndexes)
 {
     QList<Command> commands;
-    for (const auto &command : m_commands) {
+    for (int i = 0; i < m_commands.size(); ++i) {
+        const auto &command = m_commands[i];
         if ( command.inMenu && !command.name.isEmpty() && canExecuteCommand(command, data, tabName) ) {
             Command cmd = command;
             if ( cmd.outputTab.isEmpty() )
                 cmd.outputTab = tabName;
             commands.append(cmd);
+            commandIndexes->append(i);
         }
     }
 
@@ -1499,14 +1547,17 @@ void MainWindow::addCommandsToItemMenu(ClipboardBrowser *c)
         return;
 
     const auto data = addSelectionData(*c);
-    const QList<Command> commands = commandsForMenu(data, c->tabName());
+    QList<int> commandIndexes;
+    const QList<Command> commands = commandsForMenu(data, c->tabName(), &commandIndexes);
 
     QList<QKeySequence> usedShortcuts = m_disabledShortcuts;
 
     QList<Command> disabledCommands;
+    QList<int> disabledCommandIndexes;
     QList<QKeySequence> uniqueShortcuts;
 
-    for (const auto &command : commands) {
+    for (int i = 0; i < commands.size(); ++i) {
+        const auto &command = commands[i];
         QString name = command.name;
         QMenu *currentMenu = createSubMenus(&name, m_menuItem);
         QAction *act = new CommandAction(command, name, currentMenu);
@@ -1515,6 +1566,7 @@ void MainWindow::addCommandsToItemMenu(ClipboardBrowser *c)
         if (!command.matchCmd.isEmpty()) {
             act->setDisabled(true);
             disabledCommands.append(command);
+            disabledCommandIndexes.append(commandIndexes[i]);
         }
 
         connect(act, SIGNAL(triggerCommand(CommandAction*,QString)),
@@ -1540,7 +1592,7 @@ void MainWindow::addCommandsToItemMenu(ClipboardBrowser *c)
 
     setDisabledShortcuts(usedShortcuts);
 
-    m_itemMenuCommandTester.setCommands(disabledCommands, data);
+    m_itemMenuCommandTester.setCommands(disabledCommands, data, disabledCommandIndexes);
     m_itemMenuCommandTester.start();
 }
 
@@ -1561,11 +1613,14 @@ void MainWindow::addCommandsToTrayMenu(const QVariantMap &clipboardData)
     if (m_lastWindow)
         data.insert( mimeWindowTitle, m_lastWindow->getTitle() );
 
-    const QList<Command> commands = commandsForMenu(data, c->tabName());
+    QList<int> commandIndexes;
+    const QList<Command> commands = commandsForMenu(data, c->tabName(), &commandIndexes);
 
     QList<Command> disabledCommands;
+    QList<int> disabledCommandIndexes;
 
-    for (const auto &command : commands) {
+    for (int i = 0; i < commands.size(); ++i) {
+        const auto &command = commands[i];
         QString name = command.name;
         QMenu *currentMenu = createSubMenus(&name, m_trayMenu);
         QAction *act = new CommandAction(command, name, currentMenu);
@@ -1573,13 +1628,14 @@ void MainWindow::addCommandsToTrayMenu(const QVariantMap &clipboardData)
         if (!command.matchCmd.isEmpty()) {
             act->setDisabled(true);
             disabledCommands.append(command);
+            disabledCommandIndexes.append(commandIndexes[i]);
         }
 
         connect(act, SIGNAL(triggerCommand(CommandAction*,QString)),
                 this, SLOT(onClipboardCommandActionTriggered(CommandAction*,QString)));
     }
 
-    m_trayMenuCommandTester.setCommands(disabledCommands, data);
+    m_trayMenuCommandTester.setCommands(disabledCommands, data, disabledCommandIndexes);
     m_trayMenuCommandTester.start();
 }
 
@@ -1788,8 +1844,8 @@ void MainWindow::addMenuItems(TrayMenu *menu, ClipboardBrowser *c, int maxItemCo
     for ( int i = 0; i < c->length() && itemCount < maxItemCount; ++i ) {
         const QModelIndex index = c->model()->index(i, 0);
         if ( !searchText.isEmpty() ) {
-            const QString itemText = index.data(contentType::text).toString().toLower();
-            if ( !itemText.contains(searchText.toLower()) )
+            const QString itemText = index.data(contentType::text).toString();
+            if ( !itemText.contains(searchText, Qt::CaseInsensitive) )
                 continue;
         }
         menu->addClipboardItemAction(index, m_options.trayImages, i == current);
@@ -1838,12 +1894,17 @@ bool MainWindow::exportData(const QString &fileName, const QStringList &tabs, bo
         return false;
 
     QDataStream out(&file);
-    return exportDataV3(&out, tabs, exportConfiguration, exportCommands);
+    return exportDataV4(&out, tabs, exportConfiguration, exportCommands);
 }
 
-bool MainWindow::exportDataV3(QDataStream *out, const QStringList &tabs, bool exportConfiguration, bool exportCommands)
+bool MainWindow::exportDataV4(QDataStream *out, const QStringList &tabs, bool exportConfiguration, bool exportCommands)
 {
+    // Items are written after header for each tab directly to the output
+    // so the whole tab data don't need to be kept in memory.
+    // Version 3.0.3 and older can import only "CopyQ v3" files
+    // (see docs/backup.rst).
     QVariantList tabsList;
+    QList<ClipboardBrowser*> browsers;
     for (const auto &tab : tabs) {
         const auto i = findTabIndex(tab);
         if (i == -1)
@@ -1854,24 +1915,15 @@ bool MainWindow::exportDataV3(QDataStream *out, const QStringList &tabs, bool ex
             return false;
 
         const auto &tabName = c->tabName();
-
-        QByteArray tabBytes;
-        {
-            QDataStream tabOut(&tabBytes, QIODevice::WriteOnly);
-            tabOut.setVersion(QDataStream::Qt_4_7);
-            if ( !serializeData(*c->model(), &tabOut) )
-                return false;
-        }
-
         const auto iconName = getIconNameForTabName(tabName);
 
         QVariantMap tabMap;
         tabMap["name"] = tabName;
-        tabMap["data"] = tabBytes;
         if ( !iconName.isEmpty() )
             tabMap["icon"] = iconName;
 
         tabsList.append(tabMap);
+        browsers.append(c);
     }
 
     QVariantMap settingsMap;
@@ -1912,17 +1964,27 @@ bool MainWindow::exportDataV3(QDataStream *out, const QStringList &tabs, bool ex
         data["commands"] = commandsList;
 
     out->setVersion(QDataStream::Qt_4_7);
-    (*out) << QByteArray("CopyQ v3");
+    (*out) << QByteArray("CopyQ v4");
     (*out) << data;
 
+    for (const auto c : browsers) {
+        if ( !serializeData(*c->model(), out) )
+            return false;
+    }
+
     return out->status() == QDataStream::Ok;
 }
 
-bool MainWindow::importDataV3(QDataStream *in, ImportOptions options)
+bool MainWindow::importDataV4(QDataStream *in, ImportOptions options)
 {
+    in->setVersion(QDataStream::Qt_4_7);
+
     QByteArray header;
     (*in) >> header;
-    if ( !header.startsWith("CopyQ v3") )
+
+    // In version 3, items are stored in tab data instead of following header.
+    const bool itemsFollowHeader = header.startsWith("CopyQ v4");
+    if ( !itemsFollowHeader && !header.startsWith("CopyQ v3") )
         return false;
 
     QVariantMap data;
@@ -1962,11 +2024,19 @@ bool MainWindow::importDataV3(QDataStream *in, ImportOptions options)
         importCommands = importDialog.isCommandsEnabled();
     }
 
+    // Don't read items based on current value of "maxitems" option since
+    // the option can be later also imported.
+    const int maxItems = importConfiguration ? Config::maxItems : m_sharedData->maxItems;
+
     for (const auto &tabMapValue : tabsList) {
         const auto tabMap = tabMapValue.toMap();
         const auto oldTabName = tabMap["name"].toString();
-        if ( !tabs.contains(oldTabName) )
+        if ( !tabs.contains(oldTabName) ) {
+            // Skip items of the tab.
+            if ( itemsFollowHeader && !appendDeserializedData(nullptr, in, 0) )
+                return false;
             continue;
+        }
 
         auto tabName = oldTabName;
         renameToUnique( &tabName, ui->tabWidget->tabs() );
@@ -1979,15 +2049,16 @@ bool MainWindow::importDataV3(QDataStream *in, ImportOptions options)
         if (!c)
             return false;
 
-        const auto tabBytes = tabMap.value("data").toByteArray();
-        QDataStream tabIn(tabBytes);
-        tabIn.setVersion(QDataStream::Qt_4_7);
-
-        // Don't read items based on current value of "maxitems" option since
-        // the option can be later also imported.
-        const int maxItems = importConfiguration ? Config::maxItems : m_sharedData->maxItems;
-        if ( !deserializeData( c->model(), &tabIn, maxItems ) )
-            return false;
+        if (itemsFollowHeader) {
+            if ( !appendDeserializedData(c->model(), in, maxItems) )
+                return false;
+        } else {
+            const auto tabBytes = tabMap.value("data").toByteArray();
+            QDataStream tabIn(tabBytes);
+            tabIn.setVersion(QDataStream::Qt_4_7);
+            if ( !deserializeData( c->model(), &tabIn, maxItems ) )
+                return false;
+        }
     }
 
     if (importConfiguration) {
@@ -2061,6 +2132,30 @@ int MainWindow::findTabIndex(const QString &name)
     return -1;
 }
 
+QList< QPair<QString, int> > MainWindow::findItemsInTabs(const QRegExp &re)
+{
+    QList< QPair<QString, int> > result;
+
+    for ( int i = 0; i < ui->tabWidget->count(); ++i ) {
+        ClipboardBrowserPlaceholder *placeholder = getPlaceholder(i);
+        const QString tabName = placeholder->tabName();
+
+        QList<int> rows;
+        ClipboardBrowser *c = placeholder->browser();
+        if ( c || !searchSavedItems(tabName, re, &rows) ) {
+            if (!c)
+                c = placeholder->createBrowser();
+            if (c)
+                rows = c->findItems(re);
+        }
+
+        for (const auto row : rows)
+            result.append( qMakePair(tabName, row) );
+    }
+
+    return result;
+}
+
 ClipboardBrowser *MainWindow::tab(const QString &name)
 {
     return createTab(name, MatchSimilarTabName)->createBrowser();
@@ -2325,6 +2420,8 @@ void MainWindow::loadSettings()
 {
     COPYQ_LOG("Loading configuration");
 
+    clearMenuCommandResults();
+
     QSettings settings;
 
     loadItemFactorySettings(m_sharedData->itemFactory, &settings);
@@ -2342,6 +2439,9 @@ void MainWindow::loadSettings()
 
     m_options.confirmExit = appConfig.option<Config::confirm_exit>();
 
+    m_sharedData->itemFactory->setDataCompressionPolicy(
+                appConfig.option<Config::item_data_compression>() );
+
     // always on top window hint
     bool alwaysOnTop = appConfig.option<Config::always_on_top>();
     setAlwaysOnTop(this, alwaysOnTop);
@@ -2777,6 +2877,7 @@ void MainWindow::setCommands(const QList<Command> &commands)
         return;
 
     m_commands = commands;
+    clearMenuCommandResults();
     saveCommands(commands);
     updateContextMenu();
     if (m_options.trayCommands)
@@ -3383,7 +3484,7 @@ bool MainWindow::importData(const QString &fileName, ImportOptions options)
 
     QDataStream in(&file);
 
-    return importDataV3(&in, options);
+    return importDataV4(&in, options);
 }
 
 bool MainWindow::exportAllData(const QString &fileName)
@@ -35,20 +35,26 @@
 #include <QTimer>
 #include <QModelIndex>
 
+#include <memory>
+
 class Action;
 class ActionHandler;
 class ClipboardBrowser;
 class ClipboardBrowserPlaceholder;
 class CommandAction;
 class CommandDialog;
+class ClientSocket;
 class ConfigurationManager;
 class ItemFactory;
 class NotificationDaemon;
+class QRegExp;
 class Theme;
 class TrayMenu;
 struct Command;
 struct MainWindowOptions;
 
+using ClientSocketPtr = std::shared_ptr<ClientSocket>;
+
 Q_DECLARE_METATYPE(QPersistentModelIndex)
 Q_DECLARE_METATYPE(QList<QPersistentModelIndex>)
 
@@ -187,6 +193,16 @@ public:
      */
     int findTabIndex(const QString &name);
 
+    /**
+     * Find items matching @a re in all tabs.
+     *
+     * Tabs which are not loaded are searched using saved search index
+     * if it's up-to-date, otherwise the tab is loaded.
+     *
+     * @return pairs of tab name and item row
+     */
+    QList< QPair<QString, int> > findItemsInTabs(const QRegExp &re);
+
     /**
      * Tries to find tab with exact or similar name (ignores
      * key hints '&') or creates new one.
@@ -497,6 +513,9 @@ signals:
 
     void configurationChanged();
 
+    /** Request executing script from an action in server process. */
+    void requestScriptStart(const ClientSocketPtr &socket);
+
 protected:
     void keyPressEvent(QKeyEvent *event) override;
     void keyReleaseEvent(QKeyEvent *event) override;
@@ -534,6 +553,7 @@ private slots:
     void tabChanged(int current, int previous);
     void saveTabPositions();
     void doSaveTabPositions();
+    void dropPreloadedTabs();
     void tabsMoved(const QString &oldPrefix, const QString &newPrefix);
     void tabMenuRequested(QPoint pos, int tab);
     void tabMenuRequested(QPoint pos, const QString &groupPath);
@@ -599,6 +619,9 @@ private:
 
     int findTabIndexExactMatch(const QString &name);
 
+    /** Start reading items of tabs which are not loaded yet in background. */
+    void preloadTabs();
+
     void clearTitle() { updateTitle(QVariantMap()); }
 
     /** Create menu bar and tray menu with items. Called once. */
@@ -647,10 +670,14 @@ private:
 
     QAction *addItemAction(int id, QObject *receiver, const char *slot);
 
-    QList<Command> commandsForMenu(const QVariantMap &data, const QString &tabName);
+    /// Returns commands for menu and their indexes in configuration (to cache match results).
+    QList<Command> commandsForMenu(const QVariantMap &data, const QString &tabName, QList<int> *commandIndexes);
     void addCommandsToItemMenu(ClipboardBrowser *c);
     void addCommandsToTrayMenu(const QVariantMap &clipboardData);
 
+    /** Forget cached results of menu match commands. */
+    void clearMenuCommandResults();
+
     bool isItemMenuDefaultActionValid() const;
 
     void updateToolBar();
@@ -683,8 +710,9 @@ private:
     QWidget *toggleMenu(TrayMenu *menu);
 
     bool exportData(const QString &fileName, const QStringList &tabs, bool exportConfiguration, bool exportCommands);
-    bool exportDataV3(QDataStream *out, const QStringList &tabs, bool exportConfiguration, bool exportCommands);
-    bool importDataV3(QDataStream *in, ImportOptions options);
+    bool exportDataV4(QDataStream *out, const QStringList &tabs, bool exportConfiguration, bool exportCommands);
+    /// Imports data exported in version 3 or 4.
+    bool importDataV4(QDataStream *in, ImportOptions options);
 
     const Theme &theme() const;
 
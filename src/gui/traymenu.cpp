@@ -22,6 +22,7 @@
 #include "common/contenttype.h"
 #include "common/common.h"
 #include "common/display.h"
+#include "common/mimetypes.h"
 #include "gui/icons.h"
 #include "gui/iconfactory.h"
 #include "platform/platformnativeinterface.h"
@@ -83,7 +84,8 @@ void TrayMenu::addClipboardItemAction(const QModelIndex &index, bool showImages,
     if ( m_clipboardItemActionCount == 0 && m_searchText.isEmpty() )
         setSearchMenuItem( m_viMode ? tr("Press '/' to search") : tr("Type to search") );
 
-    const QVariantMap data = index.data(contentType::data).toMap();
+    // Item data are read only if needed since formats can be big.
+    const QStringList formats = index.data(contentType::formats).toStringList();
     QAction *act = addAction(QString());
 
     act->setData(index.data(contentType::hash));
@@ -101,15 +103,24 @@ void TrayMenu::addClipboardItemAction(const QModelIndex &index, bool showImages,
 
     m_clipboardItemActionCount++;
 
-    const QString label = textLabelForData( data, act->font(), format, true );
+    QString label;
+    if ( formats.contains(mimeText) && !formats.contains(mimeHidden) && !formats.contains(mimeItemNotes) ) {
+        // Cached preview is used instead of processing whole item text.
+        const int lineCount = index.data(contentType::textLineCount).toInt();
+        const QString preview = index.data(contentType::previewText).toString();
+        label = textLabelForText(preview, lineCount, act->font(), format, true);
+    } else {
+        const QVariantMap data = index.data(contentType::data).toMap();
+        label = textLabelForData(data, act->font(), format, true);
+    }
     act->setText(label);
 
     // Menu item icon from image.
     if (showImages) {
-        const QStringList formats = data.keys();
         const int imageIndex = formats.indexOf( QRegExp("^image/.*") );
         if (imageIndex != -1) {
             const auto &mime = formats[imageIndex];
+            const QVariantMap data = index.data(contentType::data).toMap();
             QPixmap pix;
             pix.loadFromData( data.value(mime).toByteArray(), mime.toLatin1().data() );
             const int iconSize = smallIconSize();
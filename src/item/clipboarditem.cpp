@@ -22,6 +22,8 @@
 #include "common/contenttype.h"
 #include "common/mimetypes.h"
 #include "common/textdata.h"
+#include "item/itemsearchindex.h"
+#include "item/mappeditemdata.h"
 #include "item/serialize.h"
 
 #include <QBrush>
@@ -32,6 +34,11 @@
 
 namespace {
 
+enum CachedTextFlag {
+    CachedText = 1,
+    CachedPreviewText = 2
+};
+
 void clearDataExceptInternal(QVariantMap *data)
 {
     for ( const auto &format : data->keys() ) {
@@ -45,6 +52,8 @@ void clearDataExceptInternal(QVariantMap *data)
 ClipboardItem::ClipboardItem()
     : m_data()
     , m_hash(0)
+    , m_textLineCount(0)
+    , m_cachedTexts(0)
 {
 }
 
@@ -55,6 +64,8 @@ bool ClipboardItem::operator ==(const ClipboardItem &item) const
 
 void ClipboardItem::setText(const QString &text)
 {
+    loadMappedData();
+
     for ( const auto &format : m_data.keys() ) {
         if ( format.startsWith("text/") )
             m_data.remove(format);
@@ -62,21 +73,34 @@ void ClipboardItem::setText(const QString &text)
 
     setTextData(&m_data, text);
 
-    invalidateDataHash();
+    invalidateCache();
 }
 
 bool ClipboardItem::setData(const QVariantMap &data)
 {
-    if (m_data == data)
+    if (allData() == data)
         return false;
 
     m_data = data;
-    invalidateDataHash();
+    m_mappedData = nullptr;
+    invalidateCache();
     return true;
 }
 
+void ClipboardItem::setMappedData(
+        const QVariantMap &data, const std::shared_ptr<const MappedItemData> &mappedData,
+        unsigned int dataHash)
+{
+    m_data = data;
+    m_mappedData = mappedData;
+    invalidateCache();
+    m_hash = dataHash;
+}
+
 bool ClipboardItem::updateData(const QVariantMap &data)
 {
+    loadMappedData();
+
     const int oldSize = m_data.size();
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &format = it.key();
@@ -100,19 +124,22 @@ bool ClipboardItem::updateData(const QVariantMap &data)
         }
     }
 
-    invalidateDataHash();
+    invalidateCache();
 
     return changed;
 }
 
 void ClipboardItem::removeData(const QString &mimeType)
 {
+    loadMappedData();
     m_data.remove(mimeType);
-    invalidateDataHash();
+    invalidateCache();
 }
 
 bool ClipboardItem::removeData(const QStringList &mimeTypeList)
 {
+    loadMappedData();
+
     bool removed = false;
 
     for (const auto &mimeType : mimeTypeList) {
@@ -123,15 +150,16 @@ bool ClipboardItem::removeData(const QStringList &mimeTypeList)
     }
 
     if (removed)
-        invalidateDataHash();
+        invalidateCache();
 
     return removed;
 }
 
 void ClipboardItem::setData(const QString &mimeType, const QByteArray &data)
 {
+    loadMappedData();
     m_data.insert(mimeType, data);
-    invalidateDataHash();
+    invalidateCache();
 }
 
 QVariant ClipboardItem::data(int role) const
@@ -139,44 +167,165 @@ QVariant ClipboardItem::data(int role) const
     switch(role) {
     case Qt::DisplayRole:
     case Qt::EditRole:
-        if ( m_data.contains(mimeText) )
-            return getTextData(m_data);
-        if ( m_data.contains(mimeUriList) )
-            return getTextData(m_data, mimeUriList);
+        if ( hasText() )
+            return text();
         break;
 
     case contentType::data:
-        return m_data; // copy-on-write, so this should be fast
+        return allData();
     case contentType::hash:
         return dataHash();
     case contentType::hasText:
-        return m_data.contains(mimeText) || m_data.contains(mimeUriList);
+        return hasText();
     case contentType::hasHtml:
-        return m_data.contains(mimeHtml);
+        return hasFormat(mimeHtml);
     case contentType::text:
-        return getTextData(m_data);
+        return text();
+    case contentType::previewText:
+        cachePreviewText();
+        return m_previewText;
+    case contentType::textLineCount:
+        cachePreviewText();
+        return m_textLineCount;
     case contentType::html:
-        return getTextData(m_data, mimeHtml);
+        return getTextData( data(mimeHtml) );
     case contentType::notes:
         return getTextData(m_data, mimeItemNotes);
     case contentType::color:
-        return getTextData(m_data, mimeColor);
+        return getTextData( data(mimeColor) );
     case contentType::isHidden:
         return m_data.contains(mimeHidden);
+    case contentType::formats:
+        return formats();
+    case contentType::searchData:
+        return searchData();
     }
 
     return QVariant();
 }
 
+QByteArray ClipboardItem::data(const QString &format) const
+{
+    if ( m_mappedData && m_mappedData->hasFormat(format) )
+        return m_mappedData->data(format);
+
+    return m_data.value(format).toByteArray();
+}
+
 unsigned int ClipboardItem::dataHash() const
 {
     if (m_hash == 0)
-        m_hash = hash(m_data);
+        m_hash = hash( allData() );
 
     return m_hash;
 }
 
-void ClipboardItem::invalidateDataHash()
+QString ClipboardItem::searchText() const
+{
+    return itemSearchText( searchData() );
+}
+
+void ClipboardItem::serialize(QDataStream *stream, const DataCompressionPolicy &policy) const
+{
+    if (m_mappedData)
+        serializeItem( stream, m_data, policy, m_mappedData->compressedData() );
+    else
+        serializeItem( stream, m_data, policy );
+}
+
+void ClipboardItem::invalidateCache()
 {
     m_hash = 0;
+    m_text.clear();
+    m_previewText.clear();
+    m_textLineCount = 0;
+    m_cachedTexts = 0;
+}
+
+QString ClipboardItem::text() const
+{
+    if ( isTextMapped() )
+        return getTextData( data(hasFormat(mimeText) ? QString(mimeText) : QString(mimeUriList)) );
+
+    if ( !(m_cachedTexts & CachedText) ) {
+        m_text = getTextData(m_data);
+        m_cachedTexts |= CachedText;
+    }
+
+    return m_text;
+}
+
+void ClipboardItem::cachePreviewText() const
+{
+    if ( !(m_cachedTexts & CachedPreviewText) ) {
+        const QString text = this->text();
+        m_previewText = textPreview(text);
+        m_textLineCount = text.count('\n') + 1;
+        m_cachedTexts |= CachedPreviewText;
+    }
+}
+
+bool ClipboardItem::hasText() const
+{
+    return hasFormat(mimeText) || hasFormat(mimeUriList);
+}
+
+bool ClipboardItem::isTextMapped() const
+{
+    return m_mappedData
+            && (m_mappedData->hasFormat(mimeText) || m_mappedData->hasFormat(mimeUriList));
+}
+
+QVariantMap ClipboardItem::allData() const
+{
+    if (!m_mappedData)
+        return m_data;
+
+    QVariantMap data = m_mappedData->data();
+    for (auto it = m_data.constBegin(); it != m_data.constEnd(); ++it)
+        data.insert( it.key(), it.value() );
+
+    return data;
+}
+
+QVariantMap ClipboardItem::searchData() const
+{
+    if ( !isTextMapped() )
+        return m_data;
+
+    QVariantMap data = m_data;
+    for ( const auto &format : {mimeText, mimeUriList} ) {
+        if ( m_mappedData->hasFormat(format) )
+            data.insert( format, m_mappedData->data(format) );
+    }
+
+    return data;
+}
+
+QStringList ClipboardItem::formats() const
+{
+    if (!m_mappedData)
+        return m_data.keys();
+
+    QStringList formats = m_mappedData->formats();
+    for (auto it = m_data.constBegin(); it != m_data.constEnd(); ++it) {
+        if ( !m_mappedData->hasFormat(it.key()) )
+            formats.append( it.key() );
+    }
+    formats.sort();
+
+    return formats;
+}
+
+bool ClipboardItem::hasFormat(const QString &format) const
+{
+    return m_data.contains(format) || (m_mappedData && m_mappedData->hasFormat(format));
+}
+
+void ClipboardItem::loadMappedData()
+{
+    if (m_mappedData) {
+        m_data = allData();
+        m_mappedData = nullptr;
+    }
 }
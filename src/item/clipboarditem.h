@@ -20,10 +20,15 @@
 #ifndef CLIPBOARDITEM_H
 #define CLIPBOARDITEM_H
 
+#include <QString>
 #include <QVariant>
 
+#include <memory>
+
+class DataCompressionPolicy;
+class MappedItemData;
 class QByteArray;
-class QString;
+class QDataStream;
 
 /**
  * Class for clipboard items in ClipboardModel.
@@ -53,6 +58,15 @@ public:
      */
     bool setData(const QVariantMap &data);
 
+    /**
+     * Set formats from map and formats which are read from mapped tab file only when needed.
+     * @a dataHash is hash of all formats.
+     */
+    void setMappedData(
+            const QVariantMap &data,
+            const std::shared_ptr<const MappedItemData> &mappedData,
+            unsigned int dataHash);
+
     /**
      * Update current data.
      * Clears non-internal data if passed data map contains non-internal data.
@@ -70,16 +84,60 @@ public:
     QVariant data(int role) const;
 
     /** Return data for format. */
-    QByteArray data(const QString &format) const { return m_data.value(format).toByteArray(); }
+    QByteArray data(const QString &format) const;
 
     /** Return hash for item's data. */
     unsigned int dataHash() const;
 
+    /** Return text for search index (see itemSearchText()). */
+    QString searchText() const;
+
+    /**
+     * Serialize item for tab file (see serializeItem()).
+     *
+     * Formats in mapped tab file are copied without decompressing, other
+     * formats are compressed according to @a policy.
+     */
+    void serialize(QDataStream *stream, const DataCompressionPolicy &policy) const;
+
 private:
-    void invalidateDataHash();
+    /** Invalidate data hash and cached texts. */
+    void invalidateCache();
+
+    /** Return text (cached unless the text is only in mapped tab file). */
+    QString text() const;
+
+    /** Cache text preview and line count. */
+    void cachePreviewText() const;
+
+    bool hasText() const;
+
+    /** Return true if text is read from mapped tab file when needed. */
+    bool isTextMapped() const;
+
+    /** Return all formats including the ones in mapped tab file. */
+    QVariantMap allData() const;
+
+    /** Return formats in memory and text formats from mapped tab file. */
+    QVariantMap searchData() const;
+
+    /** Return all formats including the ones in mapped tab file. */
+    QStringList formats() const;
+
+    bool hasFormat(const QString &format) const;
+
+    /** Read formats from mapped tab file to memory (before data are modified). */
+    void loadMappedData();
 
     QVariantMap m_data;
+    std::shared_ptr<const MappedItemData> m_mappedData;
     mutable unsigned int m_hash;
+
+    /// Cached texts (only valid if corresponding flag in m_cachedTexts is set).
+    mutable QString m_text;
+    mutable QString m_previewText;
+    mutable int m_textLineCount;
+    mutable int m_cachedTexts;
 };
 
 #endif // CLIPBOARDITEM_H
@@ -23,6 +23,7 @@
 #include "common/mimetypes.h"
 
 #include <QStringList>
+#include <QThreadPool>
 
 #include <algorithm>
 #include <functional>
@@ -54,6 +55,26 @@ int topMostRow(const QList<QPersistentModelIndex> &indexList)
 
 } // namespace
 
+void ClipboardItemList::move(int from, int to)
+{
+    // Removing and inserting the item shifts only items on shorter sides
+    // (e.g. moving item from bottom to top is fast).
+    const int n = size();
+    const int shifted = qMin(from, n - from - 1) + qMin(to, n - to - 1);
+    if ( shifted < qAbs(from - to) ) {
+        ClipboardItem item = std::move(m_items[from]);
+        m_items.erase(m_items.begin() + from);
+        m_items.insert(m_items.begin() + to, std::move(item));
+        return;
+    }
+
+    const auto begin = std::begin(m_items);
+    if (from < to)
+        std::rotate(begin + from, begin + from + 1, begin + to + 1);
+    else if (to < from)
+        std::rotate(begin + to, begin + from, begin + from + 1);
+}
+
 void ClipboardItemList::move(int from, int count, int to)
 {
     if (to < from) {
@@ -99,6 +120,9 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
         return false;
 
     int row = index.row();
+    const uint oldHash = m_clipboardList[row].dataHash();
+    const QString oldSearchText =
+            isSearchIndexUsed() ? m_clipboardList[row].searchText() : QString();
 
     if (role == Qt::EditRole) {
         m_clipboardList[row].setText(value.toString());
@@ -123,6 +147,13 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
         return false;
     }
 
+    const uint newHash = m_clipboardList[row].dataHash();
+    if (oldHash != newHash) {
+        removeHash(oldHash, oldSearchText);
+        addHash(m_clipboardList[row]);
+        updateRowIndex(row);
+    }
+
     emit dataChanged(index, index);
 
     return true;
@@ -132,10 +163,16 @@ void ClipboardModel::insertItem(const QVariantMap &data, int row)
 {
     ClipboardItem item;
     item.setData(data);
+    insertItem(item, row);
+}
 
+void ClipboardModel::insertItem(const ClipboardItem &item, int row)
+{
     beginInsertRows(QModelIndex(), row, row);
 
     m_clipboardList.insert(row, item);
+    addHash(item);
+    updateRowIndexAfterInsert(row, 1);
 
     endInsertRows();
 }
@@ -147,8 +184,12 @@ bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
 
     beginInsertRows(QModelIndex(), position, position + rows - 1);
 
-    for (int row = 0; row < rows; ++row)
-        m_clipboardList.insert(position, ClipboardItem());
+    for (int row = 0; row < rows; ++row) {
+        const ClipboardItem item;
+        m_clipboardList.insert(position, item);
+        addHash(item);
+    }
+    updateRowIndexAfterInsert(position, rows);
 
     endInsertRows();
 
@@ -164,7 +205,10 @@ bool ClipboardModel::removeRows(int position, int rows, const QModelIndex&)
 
     beginRemoveRows(QModelIndex(), position, last);
 
+    for (int row = position; row <= last; ++row)
+        removeHash(m_clipboardList[row]);
     m_clipboardList.remove(position, last - position + 1);
+    updateRowIndexAfterRemove(position, last - position + 1);
 
     endRemoveRows();
 
@@ -187,6 +231,10 @@ bool ClipboardModel::moveRows(
 
     beginMoveRows(sourceParent, sourceRow, last, destinationParent, destinationRow);
     m_clipboardList.move(sourceRow, rows, destinationRow);
+    if (destinationRow < sourceRow)
+        updateRowIndex(destinationRow, last);
+    else
+        updateRowIndex(sourceRow, destinationRow - 1);
     endMoveRows();
 
     return true;
@@ -224,6 +272,7 @@ bool ClipboardModel::move(int pos, int newpos)
         return false;
 
     m_clipboardList.move(sourceRow, targetRow);
+    updateRowIndexAfterMove(sourceRow, targetRow);
 
     endMoveRows();
 
@@ -290,6 +339,7 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *c
             if (targetRow != sourceRow) {
                 beginMoveRows(QModelIndex(), sourceRow, sourceRow, QModelIndex(), targetRow);
                 m_clipboardList.move(sourceRow, targetRow);
+                updateRowIndexAfterMove(sourceRow, targetRow);
                 endMoveRows();
 
                 // If the moved item was removed or moved further (as reaction on moving the item),
@@ -305,10 +355,163 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *c
 
 int ClipboardModel::findItem(uint itemHash) const
 {
-    for (int i = 0; i < m_clipboardList.size(); ++i) {
-        if ( m_clipboardList[i].dataHash() == itemHash )
-            return i;
+    if ( !m_hashCount.contains(itemHash) )
+        return -1;
+
+    const auto it = m_rowIndex.constFind(itemHash);
+    if ( it != m_rowIndex.constEnd() )
+        return static_cast<int>(it.value() - m_firstRowKey);
+
+    // Look up top-most row of duplicate items.
+    for (int row = 0; row < m_clipboardList.size(); ++row) {
+        if ( m_clipboardList[row].dataHash() == itemHash ) {
+            m_rowIndex.insert(itemHash, m_firstRowKey + row);
+            return row;
+        }
     }
 
     return -1;
 }
+
+QVector<ClipboardItem> ClipboardModel::items() const
+{
+    QVector<ClipboardItem> items;
+    items.reserve( rowCount() );
+    for (int row = 0; row < rowCount(); ++row)
+        items.append( m_clipboardList[row] );
+    return items;
+}
+
+void ClipboardModel::buildSearchIndex()
+{
+    if ( isSearchIndexUsed() )
+        return;
+
+    m_searchIndexTask = new ItemSearchIndexTask( items() );
+    connect( m_searchIndexTask, SIGNAL(finished()),
+             this, SLOT(onSearchIndexBuilt()) );
+    connect( m_searchIndexTask, SIGNAL(finished()),
+             m_searchIndexTask, SLOT(deleteLater()) );
+    QThreadPool::globalInstance()->start(m_searchIndexTask);
+}
+
+bool ClipboardModel::searchCandidates(const QRegExp &re, QSet<uint> *itemHashes)
+{
+    // All items are matched until the index is built.
+    if (!m_searchIndexValid) {
+        buildSearchIndex();
+        return false;
+    }
+
+    return m_searchIndex.candidates(re, itemHashes);
+}
+
+void ClipboardModel::onSearchIndexBuilt()
+{
+    if ( sender() != m_searchIndexTask )
+        return;
+
+    m_searchIndex = m_searchIndexTask->index();
+    m_searchIndexTask = nullptr;
+
+    for (const auto &change : m_searchIndexChanges) {
+        if (change.added)
+            m_searchIndex.addItem(change.itemHash, change.searchText);
+        else
+            m_searchIndex.removeItem(change.itemHash, change.searchText);
+    }
+    m_searchIndexChanges.clear();
+
+    m_searchIndexValid = true;
+}
+
+void ClipboardModel::updateSearchIndex(uint itemHash, const QString &searchText, bool added)
+{
+    if (m_searchIndexTask)
+        m_searchIndexChanges.append( SearchIndexChange{itemHash, searchText, added} );
+    else if (added)
+        m_searchIndex.addItem(itemHash, searchText);
+    else
+        m_searchIndex.removeItem(itemHash, searchText);
+}
+
+void ClipboardModel::addHash(const ClipboardItem &item)
+{
+    const uint itemHash = item.dataHash();
+    if ( ++m_hashCount[itemHash] == 1 && isSearchIndexUsed() )
+        updateSearchIndex( itemHash, item.searchText(), true );
+}
+
+void ClipboardModel::removeHash(const ClipboardItem &item)
+{
+    removeHash( item.dataHash(), isSearchIndexUsed() ? item.searchText() : QString() );
+}
+
+void ClipboardModel::removeHash(uint itemHash, const QString &searchText)
+{
+    // Row of other item with same hash is looked up again if needed.
+    m_rowIndex.remove(itemHash);
+
+    const auto it = m_hashCount.find(itemHash);
+    Q_ASSERT( it != m_hashCount.end() );
+    if ( it != m_hashCount.end() && --it.value() <= 0 ) {
+        m_hashCount.erase(it);
+        if ( isSearchIndexUsed() )
+            updateSearchIndex(itemHash, searchText, false);
+    }
+}
+
+void ClipboardModel::updateRowIndex(int row)
+{
+    const uint itemHash = m_clipboardList[row].dataHash();
+    if ( m_hashCount.value(itemHash) == 1 )
+        m_rowIndex.insert(itemHash, m_firstRowKey + row);
+    else
+        m_rowIndex.remove(itemHash);
+}
+
+void ClipboardModel::updateRowIndex(int first, int last)
+{
+    for (int row = first; row <= last; ++row)
+        updateRowIndex(row);
+}
+
+void ClipboardModel::updateRowIndexAfterInsert(int position, int count)
+{
+    // Either rows above or rows below inserted ones change position keys.
+    const int rowsBelow = rowCount() - position - count;
+    if (position < rowsBelow) {
+        m_firstRowKey -= count;
+        updateRowIndex(0, position + count - 1);
+    } else {
+        updateRowIndex(position, rowCount() - 1);
+    }
+}
+
+void ClipboardModel::updateRowIndexAfterRemove(int position, int count)
+{
+    const int rowsBelow = rowCount() - position;
+    if (position < rowsBelow) {
+        m_firstRowKey += count;
+        updateRowIndex(0, position - 1);
+    } else {
+        updateRowIndex(position, rowCount() - 1);
+    }
+}
+
+void ClipboardModel::updateRowIndexAfterMove(int from, int to)
+{
+    // Rows between source and target row shift by one. If there are more
+    // of these, shift position keys so only the other rows need update.
+    const int first = qMin(from, to);
+    const int last = qMax(from, to);
+    const int rowsBetween = last - first;
+    if ( rowsBetween <= rowCount() - rowsBetween ) {
+        updateRowIndex(first, last);
+    } else {
+        m_firstRowKey += (from < to) ? 1 : -1;
+        updateRowIndex(0, first - 1);
+        updateRowIndex(to);
+        updateRowIndex(last + 1, rowCount() - 1);
+    }
+}
@@ -21,14 +21,21 @@
 #define CLIPBOARDMODEL_H
 
 #include "item/clipboarditem.h"
+#include "item/itemsearchindex.h"
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
+#include <QVector>
+
+#include <deque>
 
 /**
  * Container with clipboard items.
  *
- * Item prepending is optimized.
+ * Item prepending and removing items from the end is optimized (constant
+ * time) and items are never reallocated. Moving an item shifts only items
+ * between source and target row or items on the shorter sides of these rows.
  */
 class ClipboardItemList {
 public:
@@ -44,46 +51,37 @@ public:
 
     void insert(int row, const ClipboardItem &item)
     {
-        m_items.insert(row, item);
+        if (row == 0)
+            m_items.push_front(item);
+        else if (row == size())
+            m_items.push_back(item);
+        else
+            m_items.insert(m_items.begin() + row, item);
     }
 
     void remove(int row, int count)
     {
-        const QList<ClipboardItem>::iterator from = m_items.begin() + row;
-        const QList<ClipboardItem>::iterator to = from + count;
+        const auto from = m_items.begin() + row;
+        const auto to = from + count;
         m_items.erase(from, to);
     }
 
     int size() const
     {
-        return m_items.size();
+        return static_cast<int>( m_items.size() );
     }
 
-    void move(int from, int to)
-    {
-        const ClipboardItem item = m_items[from];
-        m_items.removeAt(from);
-        m_items.insert(to, item);
-    }
+    void move(int from, int to);
 
     void move(int from, int count, int to);
 
-    void reserve(int maxItems)
-    {
-        m_items.reserve(maxItems);
-    }
-
     void resize(int size)
     {
-        if (size < this->size())
-            remove(size, this->size());
-
-        while (size > this->size())
-            m_items.append(ClipboardItem());
+        m_items.resize( static_cast<std::size_t>(size) );
     }
 
 private:
-    QList<ClipboardItem> m_items;
+    std::deque<ClipboardItem> m_items;
 };
 
 /**
@@ -130,6 +128,9 @@ public:
     /** insert new item to model. */
     void insertItem(const QVariantMap &data, int row);
 
+    /** insert new item to model. */
+    void insertItem(const ClipboardItem &item, int row);
+
     /**
      * Move an item.
      * @return True only if item was successfully moved.
@@ -158,10 +159,46 @@ public:
 
     /**
      * Find item with given @a hash.
-     * @return Row number with found item or -1 if no item was found.
+     *
+     * Uses index of item hashes which is updated only for rows which change
+     * position so look-ups don't need to iterate all items (except for
+     * duplicate items).
+     *
+     * @return Top-most row number with found item or -1 if no item was found.
      */
     int findItem(uint itemHash) const;
 
+    /**
+     * Starts building trigram index of item texts (see ItemSearchIndex)
+     * in background unless it's already built or being built.
+     *
+     * Once built, the index is updated with items.
+     */
+    void buildSearchIndex();
+
+    /**
+     * Find hashes of items which can match search expression.
+     *
+     * Starts building the search index if needed (see buildSearchIndex()).
+     *
+     * @return false if any item can match or the index is not built yet
+     */
+    bool searchCandidates(const QRegExp &re, QSet<uint> *itemHashes);
+
+    /**
+     * Return copies of all items.
+     *
+     * Copies share data with items in model so they are cheap to create
+     * and can be used in other threads.
+     */
+    QVector<ClipboardItem> items() const;
+
+    /** Serialize item for tab file (see ClipboardItem::serialize()). */
+    void serializeItem(int row, QDataStream *stream, const DataCompressionPolicy &policy) const
+    {
+        m_clipboardList[row].serialize(stream, policy);
+    }
+
     /**
      * Return row index for given @a row.
      * @return Value of @a row if such index is in model.
@@ -178,8 +215,51 @@ public slots:
     void moveRow(int from, int to) { moveRows(QModelIndex(), from, 1, QModelIndex(), to); }
 #endif
 
+private slots:
+    void onSearchIndexBuilt();
+
 private:
+    /// Change of unique items made while search index is being built.
+    struct SearchIndexChange {
+        uint itemHash;
+        QString searchText;
+        bool added;
+    };
+
+    bool isSearchIndexUsed() const { return m_searchIndexValid || m_searchIndexTask; }
+    void updateSearchIndex(uint itemHash, const QString &searchText, bool added);
+
+    void addHash(const ClipboardItem &item);
+    void removeHash(const ClipboardItem &item);
+    void removeHash(uint itemHash, const QString &searchText);
+    void updateRowIndex(int row);
+    void updateRowIndex(int first, int last);
+    void updateRowIndexAfterInsert(int position, int count);
+    void updateRowIndexAfterRemove(int position, int count);
+    void updateRowIndexAfterMove(int from, int to);
+
     ClipboardItemList m_clipboardList;
+
+    /// Number of items with given hash (always up-to-date).
+    QHash<uint, int> m_hashCount;
+
+    /**
+     * Position key of top-most row for given hash (row is key minus
+     * m_firstRowKey).
+     *
+     * Rows of duplicate items are added only after look-up.
+     */
+    mutable QHash<uint, qint64> m_rowIndex;
+
+    /// Position key of first row (changes when shorter side of rows is shifted).
+    qint64 m_firstRowKey = 0;
+
+    /// Index of item texts (built in background, then updated with hash counts).
+    ItemSearchIndex m_searchIndex;
+    bool m_searchIndexValid = false;
+    ItemSearchIndexTask *m_searchIndexTask = nullptr;
+    /// Changes to apply after the index is built.
+    QVector<SearchIndexChange> m_searchIndexChanges;
 };
 
 #endif // CLIPBOARDMODEL_H
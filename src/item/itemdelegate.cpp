@@ -20,16 +20,21 @@
 #include "itemdelegate.h"
 
 #include "common/client_server.h"
+#include "common/common.h"
 #include "common/contenttype.h"
+#include "common/log.h"
 #include "common/mimetypes.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/iconfactory.h"
 #include "item/itemfactory.h"
 #include "item/itemwidget.h"
 #include "item/itemeditorwidget.h"
+#include "item/painteditem.h"
 
 #include <QEvent>
 #include <QPainter>
+#include <QPixmapCache>
+#include <QThreadPool>
 
 #include <algorithm>
 
@@ -37,12 +42,6 @@ namespace {
 
 const char propertySelectedItem[] = "CopyQ_selected";
 
-inline void reset(ItemWidget **ptr, ItemWidget *value = nullptr)
-{
-    delete *ptr;
-    *ptr = value != nullptr ? value : nullptr;
-}
-
 } // namespace
 
 ItemDelegate::ItemDelegate(ClipboardBrowser *view, const ClipboardBrowserSharedPtr &sharedData, QWidget *parent)
@@ -53,25 +52,42 @@ ItemDelegate::ItemDelegate(ClipboardBrowser *view, const ClipboardBrowserSharedP
     , m_re()
     , m_maxSize(2048, 2048 * 8)
     , m_idealWidth(0)
-    , m_cache()
+    , m_heightTask(nullptr)
 {
+    m_heightCache.setLayoutKey(m_sharedData->itemLayoutKey);
+    initSingleShotTimer( &m_timerEstimateHeights, 200, this, SLOT(startHeightTask()) );
 }
 
-ItemDelegate::~ItemDelegate() = default;
+ItemDelegate::~ItemDelegate()
+{
+    cancelHeightTask();
+    invalidateCache();
+}
 
 QSize ItemDelegate::sizeHint(const QModelIndex &index) const
 {
-    int row = index.row();
-    if ( row < m_cache.size() ) {
-        const ItemWidget *w = m_cache[row];
-        if (w != nullptr) {
-            QWidget *ww = w->widget();
-            const auto margins = m_sharedData->theme.margins();
-            const auto rowNumberSize = m_sharedData->theme.rowNumberSize();
-            return QSize( ww->width() + 2 * margins.width() + rowNumberSize.width(),
-                          qMax(ww->height() + 2 * margins.height(), rowNumberSize.height()) );
-        }
+    QSize size;
+
+    const auto it = m_items.constFind( index.row() );
+    if ( it != m_items.constEnd() ) {
+        if (it->widget != nullptr)
+            size = it->widget->widget()->size();
+        else
+            size = it->paintedItem->size();
+    } else {
+        const uint itemHash = index.data(contentType::hash).toUInt();
+        const int height = m_heightCache.height(itemHash, m_idealWidth);
+        if (height != -1)
+            size = QSize(0, height);
     }
+
+    if ( size.isValid() ) {
+        const auto margins = m_sharedData->theme.margins();
+        const auto rowNumberSize = m_sharedData->theme.rowNumberSize();
+        return QSize( size.width() + 2 * margins.width() + rowNumberSize.width(),
+                      qMax(size.height() + 2 * margins.height(), rowNumberSize.height()) );
+    }
+
     return QSize(0, 512);
 }
 
@@ -85,18 +101,16 @@ bool ItemDelegate::eventFilter(QObject *obj, QEvent *event)
 {
     // resize event for items
     if ( event->type() == QEvent::Resize ) {
-        int row = 0;
-        for (; row < m_cache.size(); ++row) {
-            auto w = m_cache[row];
-            if (w && w->widget() == obj)
-                break;
+        const auto it = m_widgetRows.constFind(obj);
+        Q_ASSERT( it != m_widgetRows.constEnd() );
+
+        if ( it != m_widgetRows.constEnd() ) {
+            const auto index = m_view->model()->index(it.value(), 0);
+            if ( index.isValid() ) {
+                setMeasuredHeight( index, static_cast<QWidget*>(obj)->height() );
+                emit sizeHintChanged(index);
+            }
         }
-
-        Q_ASSERT( row < m_cache.size() );
-
-        const auto index = m_view->model()->index(row, 0);
-        if ( index.isValid() )
-            emit sizeHintChanged(index);
     }
 
     return QItemDelegate::eventFilter(obj, event);
@@ -104,43 +118,83 @@ bool ItemDelegate::eventFilter(QObject *obj, QEvent *event)
 
 void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
 {
+    if ( m_items.isEmpty() )
+        return;
+
     for ( int row = a.row(); row <= b.row(); ++row ) {
-        auto item = &m_cache[row];
-        if (*item) {
-            reset(item);
-            cache( m_view->index(row) );
+        if ( m_items.contains(row) ) {
+            invalidateCache(row);
+            cacheItem( m_view->index(row) );
         }
     }
 }
 
 void ItemDelegate::rowsRemoved(const QModelIndex &, int start, int end)
 {
-    for( int i = end; i >= start; --i ) {
-        delete m_cache.takeAt(i);
+    if ( m_items.isEmpty() )
+        return;
+
+    const int count = end - start + 1;
+    QHash<int, CachedItem> items;
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        const int row = it.key();
+        if (row < start) {
+            items.insert(row, it.value());
+        } else if (row > end) {
+            items.insert(row - count, it.value());
+        } else {
+            delete it->widget;
+            delete it->paintedItem;
+        }
     }
+
+    setCachedItems(items);
 }
 
 void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd,
                              const QModelIndex &, int destinationRow)
 {
-    int dest = sourceStart < destinationRow ? destinationRow-1 : destinationRow;
-    for( int i = sourceStart; i <= sourceEnd; ++i ) {
-        m_cache.move(i,dest);
-        ++dest;
+    if ( m_items.isEmpty() )
+        return;
+
+    // Destination row is position before the move.
+    const int count = sourceEnd - sourceStart + 1;
+    QHash<int, CachedItem> items;
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        int row = it.key();
+        if (sourceStart <= row && row <= sourceEnd) {
+            row += sourceStart < destinationRow
+                    ? destinationRow - count - sourceStart
+                    : destinationRow - sourceStart;
+        } else if (sourceEnd < row && row < destinationRow) {
+            row -= count;
+        } else if (destinationRow <= row && row < sourceStart) {
+            row += count;
+        }
+        items.insert(row, it.value());
     }
+
+    setCachedItems(items);
 }
 
 void ItemDelegate::rowsInserted(const QModelIndex &, int start, int end)
 {
-    for( int i = start; i <= end; ++i )
-        m_cache.insert(i, nullptr);
+    if ( m_items.isEmpty() )
+        return;
+
+    const int count = end - start + 1;
+    QHash<int, CachedItem> items;
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        const int row = it.key();
+        items.insert(row < start ? row : row + count, it.value());
+    }
+
+    setCachedItems(items);
 }
 
 ItemWidget *ItemDelegate::cache(const QModelIndex &index)
 {
-    int n = index.row();
-
-    ItemWidget *w = m_cache[n];
+    ItemWidget *w = cacheOrNull( index.row() );
     if (w == nullptr) {
         QWidget *parent = m_view->viewport();
         const bool antialiasing = m_sharedData->theme.isAntialiasingEnabled();
@@ -153,14 +207,26 @@ ItemWidget *ItemDelegate::cache(const QModelIndex &index)
     return w;
 }
 
+void ItemDelegate::cacheItem(const QModelIndex &index)
+{
+    if ( hasCache(index) )
+        return;
+
+    if ( canPaintItem(index) )
+        setPaintedItem(index);
+    else
+        cache(index);
+}
+
 ItemWidget *ItemDelegate::cacheOrNull(int row) const
 {
-    return m_cache[row];
+    const auto it = m_items.constFind(row);
+    return it == m_items.constEnd() ? nullptr : it->widget;
 }
 
 bool ItemDelegate::hasCache(const QModelIndex &index) const
 {
-    return m_cache[index.row()] != nullptr;
+    return m_items.contains( index.row() );
 }
 
 void ItemDelegate::setItemSizes(QSize size, int idealWidth)
@@ -171,15 +237,35 @@ void ItemDelegate::setItemSizes(QSize size, int idealWidth)
     m_maxSize.setWidth(size.width() - margin);
     m_idealWidth = idealWidth - margin;
 
-    for(auto w : m_cache) {
-        if (w != nullptr)
-            w->updateSize(m_maxSize, m_idealWidth);
+    m_heightCache.setLayoutKey(m_sharedData->itemLayoutKey);
+    estimateItemHeights();
+
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        if (it->widget != nullptr)
+            it->widget->updateSize(m_maxSize, m_idealWidth);
+    }
+
+    // Lay out painted items again without re-creating them.
+    const QSize maxSize(m_idealWidth, m_maxSize.height());
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        PaintedItem *paintedItem = it->paintedItem;
+        if (paintedItem == nullptr)
+            continue;
+
+        const QSize oldSize = paintedItem->size();
+        paintedItem->setMaxSize(maxSize, m_sharedData->textWrap);
+        requestPixmap(paintedItem);
+
+        const auto index = m_view->index( it.key() );
+        setMeasuredHeight( index, paintedItem->size().height() );
+        if ( oldSize != paintedItem->size() )
+            emit sizeHintChanged(index);
     }
 }
 
 bool ItemDelegate::otherItemLoader(const QModelIndex &index, bool next)
 {
-    ItemWidget *w = m_cache[index.row()];
+    ItemWidget *w = cacheOrNull( index.row() );
     if (w != nullptr) {
         const bool antialiasing = m_sharedData->theme.isAntialiasingEnabled();
         auto w2 = m_sharedData->itemFactory->otherItemLoader(index, w, next, antialiasing);
@@ -195,8 +281,7 @@ bool ItemDelegate::otherItemLoader(const QModelIndex &index, bool next)
 ItemEditorWidget *ItemDelegate::createCustomEditor(QWidget *parent, const QModelIndex &index,
                                                    bool editNotes)
 {
-    cache(index);
-    auto editor = new ItemEditorWidget(m_cache[index.row()], index, editNotes, parent);
+    auto editor = new ItemEditorWidget(cache(index), index, editNotes, parent);
     editor->setEditorPalette( m_sharedData->theme.editorPalette() );
     editor->setEditorFont( m_sharedData->theme.editorFont() );
     editor->setSaveOnReturnKey(m_saveOnReturnKey);
@@ -225,9 +310,15 @@ void ItemDelegate::setItemWidgetCurrent(const QModelIndex &index, bool isCurrent
         for ( auto childWidget : ww->findChildren<QWidget*>() )
             childWidget->setPalette(palette);
     } else {
-        w = m_cache[index.row()];
+        w = cacheOrNull( index.row() );
         if (!w)
             return;
+
+        // Replace widget with painted item if current item changes.
+        if ( canPaintItem(index) && !m_view->isInternalEditorOpen() ) {
+            setPaintedItem(index);
+            return;
+        }
     }
 
     w->setCurrent(isCurrent);
@@ -236,7 +327,7 @@ void ItemDelegate::setItemWidgetCurrent(const QModelIndex &index, bool isCurrent
 
 void ItemDelegate::setItemWidgetSelected(const QModelIndex &index, bool isSelected)
 {
-    auto w = m_cache[index.row()];
+    auto w = cacheOrNull( index.row() );
     if (!w)
         return;
 
@@ -244,16 +335,63 @@ void ItemDelegate::setItemWidgetSelected(const QModelIndex &index, bool isSelect
     setWidgetSelected(ww, isSelected);
 }
 
+PaintedItem *ItemDelegate::paintedItemOrNull(int row) const
+{
+    const auto it = m_items.constFind(row);
+    return it == m_items.constEnd() ? nullptr : it->paintedItem;
+}
+
+void ItemDelegate::setCachedItem(int row, ItemWidget *w, PaintedItem *paintedItem)
+{
+    const auto it = m_items.find(row);
+    if ( it != m_items.end() ) {
+        if (it->widget != w) {
+            m_widgetRows.remove( it->widget ? it->widget->widget() : nullptr );
+            delete it->widget;
+        }
+        if (it->paintedItem != paintedItem)
+            delete it->paintedItem;
+    }
+
+    if (w == nullptr && paintedItem == nullptr) {
+        m_items.remove(row);
+        return;
+    }
+
+    CachedItem &item = m_items[row];
+    item.widget = w;
+    item.paintedItem = paintedItem;
+
+    if (w != nullptr)
+        m_widgetRows[w->widget()] = row;
+}
+
+void ItemDelegate::setCachedItems(const QHash<int, CachedItem> &items)
+{
+    m_items = items;
+
+    m_widgetRows.clear();
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        if (it->widget != nullptr)
+            m_widgetRows.insert( it->widget->widget(), it.key() );
+    }
+}
+
 void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
 {
-    reset(&m_cache[index.row()], w);
+    setCachedItem(index.row(), w, nullptr);
     if (w == nullptr)
         return;
 
     QWidget *ww = w->widget();
 
+    // Don't use setItemWidgetCurrent() for other items since it can replace
+    // the new widget with painted item.
     const bool isCurrent = m_view->currentIndex() == index;
-    setItemWidgetCurrent(index, isCurrent);
+    if (isCurrent)
+        setItemWidgetCurrent(index, true);
+    else
+        w->setCurrent(false);
 
     const bool isSelected = m_view->selectionModel()->isSelected(index);
     setWidgetSelected(ww, isSelected);
@@ -263,12 +401,213 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     w->updateSize(m_maxSize, m_idealWidth);
     ww->hide();
 
+    setMeasuredHeight( index, ww->height() );
+
     ww->installEventFilter(this);
 
     // TODO: Check if sizeHint() really changes.
     emit sizeHintChanged(index);
 }
 
+bool ItemDelegate::canPaintItem(const QModelIndex &index) const
+{
+    return m_sharedData->paintItems
+            && !m_sharedData->showSimpleItems
+            && m_view->currentIndex() != index
+            && PaintedItem::canPaint(index, m_sharedData->paintedItemSettings);
+}
+
+void ItemDelegate::setPaintedItem(const QModelIndex &index)
+{
+    const QSize maxSize(m_idealWidth, m_maxSize.height());
+    auto paintedItem = new PaintedItem(
+                index, m_view->font(), maxSize, m_sharedData->textWrap, m_sharedData->paintedItemSettings);
+    setCachedItem(index.row(), nullptr, paintedItem);
+    requestPixmap(paintedItem);
+    setMeasuredHeight( index, paintedItem->size().height() );
+
+    emit sizeHintChanged(index);
+}
+
+void ItemDelegate::requestPixmap(PaintedItem *paintedItem)
+{
+    if ( !paintedItem->needsPixmap() )
+        return;
+
+    const QString imageKey = paintedItem->imageKey();
+
+    QPixmap pixmap;
+    if ( QPixmapCache::find(imageKey, &pixmap) ) {
+        paintedItem->setPixmap(pixmap);
+        return;
+    }
+
+    if ( m_pendingImages.contains(imageKey) )
+        return;
+
+    m_pendingImages.insert(imageKey);
+
+    auto task = new PaintedImageTask( imageKey, paintedItem->imageData(), paintedItem->imageMaxSize() );
+    connect( task, SIGNAL(imageDecoded(QString,QImage)),
+             this, SLOT(onImageDecoded(QString,QImage)) );
+    connect( task, SIGNAL(finished()),
+             task, SLOT(deleteLater()) );
+
+    QThreadPool::globalInstance()->start(task);
+}
+
+void ItemDelegate::onImageDecoded(const QString &imageKey, const QImage &image)
+{
+    m_pendingImages.remove(imageKey);
+
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    QPixmapCache::insert(imageKey, pixmap);
+
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        PaintedItem *paintedItem = it->paintedItem;
+        if ( paintedItem == nullptr || !paintedItem->needsPixmap() || paintedItem->imageKey() != imageKey )
+            continue;
+
+        const QSize oldSize = paintedItem->size();
+        paintedItem->setPixmap(pixmap);
+
+        const auto index = m_view->index( it.key() );
+        if ( oldSize != paintedItem->size() ) {
+            setMeasuredHeight( index, paintedItem->size().height() );
+            emit sizeHintChanged(index);
+        }
+        m_view->update(index);
+    }
+}
+
+void ItemDelegate::setMeasuredHeight(const QModelIndex &index, int height)
+{
+    // Current item can be rendered differently.
+    if ( m_view->currentIndex() == index )
+        return;
+
+    const uint itemHash = index.data(contentType::hash).toUInt();
+    m_heightCache.setMeasuredHeight(itemHash, m_idealWidth, height);
+}
+
+void ItemDelegate::estimateItemHeights()
+{
+    cancelHeightTask();
+    m_timerEstimateHeights.start();
+}
+
+void ItemDelegate::startHeightTask()
+{
+    cancelHeightTask();
+
+    // Estimated heights match only items which would be painted,
+    // widgets can have different size.
+    if ( m_idealWidth <= 0 || !m_sharedData->paintItems || m_sharedData->showSimpleItems )
+        return;
+
+    const PaintedItemSettings &settings = m_sharedData->paintedItemSettings;
+    const int rowCount = m_view->length();
+    ItemHeightRequestList items;
+    for (int row = 0; row < rowCount; ++row) {
+        if ( m_items.contains(row) )
+            continue;
+
+        const QModelIndex index = m_view->index(row);
+        const uint itemHash = index.data(contentType::hash).toUInt();
+        if ( m_heightCache.contains(itemHash, m_idealWidth) )
+            continue;
+
+        const QStringList formats = index.data(contentType::formats).toStringList();
+        if ( !PaintedItem::canPaint(formats, settings) )
+            continue;
+
+        ItemHeightRequest item;
+        item.itemHash = itemHash;
+        item.isHtml = false;
+        const QString imageFormat = PaintedItem::paintedImageFormat(formats);
+        if ( !imageFormat.isEmpty() ) {
+            // Image items don't have any other data except for few plain formats.
+            item.image = index.data(contentType::data).toMap().value(imageFormat).toByteArray();
+        } else if ( settings.useRichText && formats.contains(mimeHtml) ) {
+            item.text = index.data(contentType::html).toString();
+            item.isHtml = true;
+        } else {
+            item.text = index.data(contentType::text).toString();
+        }
+        items.append(item);
+    }
+
+    if ( items.isEmpty() ) {
+        updateEstimatedHeights();
+        return;
+    }
+
+    COPYQ_LOG( QString("Estimating heights of %1 items").arg(items.size()) );
+
+    const QSize maxSize(m_idealWidth, m_maxSize.height());
+    m_heightTask = new ItemHeightTask(items, m_view->font(), maxSize, m_sharedData->textWrap, settings);
+
+    connect( m_heightTask, SIGNAL(heightsEstimated(QVector<uint>,QVector<int>)),
+             this, SLOT(onHeightsEstimated(QVector<uint>,QVector<int>)) );
+    connect( m_heightTask, SIGNAL(finished()),
+             this, SLOT(onHeightTaskFinished()) );
+    connect( m_heightTask, SIGNAL(finished()),
+             m_heightTask, SLOT(deleteLater()) );
+
+    QThreadPool::globalInstance()->start(m_heightTask);
+}
+
+void ItemDelegate::onHeightsEstimated(const QVector<uint> &itemHashes, const QVector<int> &heights)
+{
+    if ( sender() != m_heightTask )
+        return;
+
+    for (int i = 0; i < itemHashes.size(); ++i)
+        m_heightCache.setEstimatedHeight( itemHashes[i], m_idealWidth, heights[i] );
+
+    // Items are laid out again only after whole batch is estimated.
+    m_estimatedHeightsChanged = true;
+}
+
+void ItemDelegate::onHeightTaskFinished()
+{
+    if ( sender() == m_heightTask ) {
+        m_heightTask = nullptr;
+        updateEstimatedHeights();
+    }
+}
+
+void ItemDelegate::updateEstimatedHeights()
+{
+    if (!m_estimatedHeightsChanged)
+        return;
+
+    m_estimatedHeightsChanged = false;
+
+    // Any size hint change causes the view to lay out all items again.
+    const QModelIndex index = m_view->index(0);
+    if ( index.isValid() )
+        emit sizeHintChanged(index);
+}
+
+void ItemDelegate::cancelHeightTask()
+{
+    if (m_heightTask) {
+        // Task deletes itself when finished.
+        m_heightTask->cancel();
+        m_heightTask = nullptr;
+    }
+}
+
+void ItemDelegate::paintItem(
+        QPainter *painter, const QStyleOptionViewItem &option,
+        const QPoint &position, const PaintedItem &item) const
+{
+    const bool isSelected = option.state & QStyle::State_Selected;
+    item.paint( painter, position, option.palette, isSelected,
+                m_re, m_sharedData->theme.searchPalette() );
+}
+
 void ItemDelegate::setWidgetSelected(QWidget *ww, bool selected)
 {
     if ( ww->property(propertySelectedItem).toBool() == selected )
@@ -285,13 +624,34 @@ void ItemDelegate::setWidgetSelected(QWidget *ww, bool selected)
 
 void ItemDelegate::invalidateCache()
 {
-    for(auto &w : m_cache)
-        reset(&w);
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        delete it->widget;
+        delete it->paintedItem;
+    }
+
+    m_items.clear();
+    m_widgetRows.clear();
 }
 
 void ItemDelegate::invalidateCache(int row)
 {
-    reset(&m_cache[row]);
+    setCachedItem(row, nullptr, nullptr);
+}
+
+void ItemDelegate::invalidateCacheFromRow(int row)
+{
+    for ( const int cachedRow : m_items.keys() ) {
+        if (cachedRow >= row)
+            invalidateCache(cachedRow);
+    }
+}
+
+void ItemDelegate::hideWidgetsOutside(int firstRow, int lastRow)
+{
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        if ( it->widget != nullptr && (it.key() < firstRow || it.key() > lastRow) )
+            it->widget->widget()->hide();
+    }
 }
 
 void ItemDelegate::setSearch(const QRegExp &re)
@@ -311,12 +671,15 @@ void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
     style->drawControl(QStyle::CE_ItemViewItem, &option, painter, m_view);
 
     const int row = index.row();
-    const auto w = m_cache[row];
-    if (w == nullptr) {
-        m_view->itemWidget(index);
+    const auto it = m_items.constFind(row);
+    if ( it == m_items.constEnd() ) {
+        m_view->cacheItem(index);
         return;
     }
 
+    const auto w = it->widget;
+    const auto paintedItem = it->paintedItem;
+
     // Colorize item.
     const QString colorExpr = index.data(contentType::color).toString();
     if (!colorExpr.isEmpty()) {
@@ -344,11 +707,17 @@ void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
         painter->restore();
     }
 
+    const auto rowNumberSize = m_sharedData->theme.rowNumberSize();
+    const auto offset = rect.topLeft() + QPoint(rowNumberSize.width() + margins.width(), margins.height());
+
+    if (w == nullptr) {
+        paintItem(painter, option, offset, *paintedItem);
+        return;
+    }
+
     highlightMatches(w);
 
     auto ww = w->widget();
-    const auto rowNumberSize = m_sharedData->theme.rowNumberSize();
-    const auto offset = rect.topLeft() + QPoint(rowNumberSize.width() + margins.width(), margins.height());
     ww->move(offset);
     if ( ww->isHidden() ) {
         ww->show();
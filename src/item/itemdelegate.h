@@ -21,15 +21,20 @@
 #define ITEMDELEGATE_H
 
 #include "gui/clipboardbrowsershared.h"
+#include "item/itemheightcache.h"
 
+#include <QHash>
 #include <QItemDelegate>
 #include <QRegExp>
+#include <QSet>
+#include <QTimer>
 
 class Item;
 class ItemEditorWidget;
 class ItemFactory;
 class ItemWidget;
 class ClipboardBrowser;
+class PaintedItem;
 
 /**
  * Delegate for items in ClipboardBrowser.
@@ -37,10 +42,16 @@ class ClipboardBrowser;
  * Creates editor on demand and draws contents of all items.
  *
  * To achieve better performance the first call to get sizeHint() value for
- * an item returns some default value (so it doesn't have to render all items).
+ * an item returns height from ItemHeightCache or some default value (so it
+ * doesn't have to render all items). Heights are remembered for rendered items
+ * and estimated in background for other simple items.
  *
  * Before calling paint() for an index item on given index must be cached
- * using cache().
+ * using cache() or cacheItem().
+ *
+ * If enabled (ClipboardBrowserShared::paintItems), simple items are laid out and
+ * painted directly without creating widgets (see PaintedItem). Widgets are
+ * created only for current item, editor and items which cannot be painted.
  */
 class ItemDelegate : public QItemDelegate
 {
@@ -64,6 +75,12 @@ class ItemDelegate : public QItemDelegate
         /** Remove cached item. */
         void invalidateCache(int row);
 
+        /** Remove cached items in rows starting at @a row. */
+        void invalidateCacheFromRow(int row);
+
+        /** Hide item widgets in rows before @a firstRow and after @a lastRow. */
+        void hideWidgetsOutside(int firstRow, int lastRow);
+
         /** Set regular expression for highlighting. */
         void setSearch(const QRegExp &re);
 
@@ -73,15 +90,28 @@ class ItemDelegate : public QItemDelegate
         /** Return cached item, create it if it doesn't exist. */
         ItemWidget *cache(const QModelIndex &index);
 
+        /**
+         * Prepare item for rendering.
+         *
+         * Lays out item for painting if possible, otherwise creates widget.
+         */
+        void cacheItem(const QModelIndex &index);
+
         /** Return cached item or nullptr. */
         ItemWidget *cacheOrNull(int row) const;
 
-        /** Return true only if item at index is already in cache. */
+        /** Return true only if item at index is already in cache (widget or painted). */
         bool hasCache(const QModelIndex &index) const;
 
         /** Set maximum size for all items. */
         void setItemSizes(QSize size, int idealWidth);
 
+        /** Remembered and estimated heights of items. */
+        ItemHeightCache *heightCache() { return &m_heightCache; }
+
+        /** Estimate heights of items which are not rendered yet (in background). */
+        void estimateItemHeights();
+
         /** Save edited item on return or ctrl+return. */
         void setSaveOnEnterKey(bool enable) { m_saveOnReturnKey = enable; }
 
@@ -120,13 +150,52 @@ class ItemDelegate : public QItemDelegate
         void rowsMoved(const QModelIndex &parent, int sourceStart, int sourceEnd,
                        const QModelIndex &destination, int destinationRow);
 
+    private slots:
+        void startHeightTask();
+        void onHeightsEstimated(const QVector<uint> &itemHashes, const QVector<int> &heights);
+        void onHeightTaskFinished();
+        void onImageDecoded(const QString &imageKey, const QImage &image);
+
     protected:
         void paint(QPainter *painter, const QStyleOptionViewItem &option,
                    const QModelIndex &index) const override;
 
     private:
+        struct CachedItem {
+            ItemWidget *widget;
+            PaintedItem *paintedItem;
+        };
+
+        PaintedItem *paintedItemOrNull(int row) const;
+
+        /// Replaces cached widget and painted item in @a row (deletes old ones).
+        void setCachedItem(int row, ItemWidget *w, PaintedItem *paintedItem);
+
+        /// Sets all cached items (after rows change).
+        void setCachedItems(const QHash<int, CachedItem> &items);
+
         void setIndexWidget(const QModelIndex &index, ItemWidget *w);
 
+        /// Returns true if item should be painted without widget.
+        bool canPaintItem(const QModelIndex &index) const;
+
+        /// Lays out item for painting.
+        void setPaintedItem(const QModelIndex &index);
+
+        /// Sets cached pixmap for painted image or starts decoding it.
+        void requestPixmap(PaintedItem *paintedItem);
+
+        void paintItem(QPainter *painter, const QStyleOptionViewItem &option,
+                       const QPoint &position, const PaintedItem &item) const;
+
+        /// Remembers height of rendered item contents.
+        void setMeasuredHeight(const QModelIndex &index, int height);
+
+        void cancelHeightTask();
+
+        /// Lays out items again if any estimated heights changed.
+        void updateEstimatedHeights();
+
         void setWidgetCurrent(QWidget *ww, bool isCurrent);
 
         /// Updates style for selected/unselected widgets.
@@ -139,7 +208,24 @@ class ItemDelegate : public QItemDelegate
         QSize m_maxSize;
         int m_idealWidth;
 
-        QList<ItemWidget*> m_cache;
+        /**
+         * Cached items by row.
+         *
+         * Only rendered rows are stored so row changes take time proportional
+         * to number of rendered items. Item has either widget or painted item.
+         */
+        QHash<int, CachedItem> m_items;
+
+        /// Rows of item widgets (for resize events).
+        QHash<const QObject*, int> m_widgetRows;
+
+        ItemHeightCache m_heightCache;
+        ItemHeightTask *m_heightTask;
+        QTimer m_timerEstimateHeights;
+        bool m_estimatedHeightsChanged = false;
+
+        /// Keys of images which are being decoded (see PaintedImageTask).
+        QSet<QString> m_pendingImages;
 };
 
 #endif // ITEMDELEGATE_H
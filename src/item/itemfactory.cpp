@@ -25,13 +25,17 @@
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/textdata.h"
+#include "item/clipboardmodel.h"
+#include "item/itemfilter.h"
 #include "item/itemstore.h"
 #include "item/itemwidget.h"
+#include "item/mappeditemdata.h"
 #include "item/serialize.h"
 #include "platform/platformnativeinterface.h"
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QFile>
 #include <QIODevice>
 #include <QLabel>
 #include <QMetaObject>
@@ -164,18 +168,35 @@ private:
     QString m_imageFormat;
 };
 
+using DataCompressionPolicyPtr = std::shared_ptr<const DataCompressionPolicy>;
+
 class DummySaver : public ItemSaverInterface
 {
 public:
+    explicit DummySaver(const DataCompressionPolicyPtr &policy)
+        : m_policy(policy)
+    {
+    }
+
     bool saveItems(const QString & /* tabName */, const QAbstractItemModel &model, QIODevice *file) override
     {
-        return serializeData(model, file);
+        return saveMappedItems(model, file, *m_policy);
     }
+
+    bool canJournalItems() const override { return true; }
+
+private:
+    DataCompressionPolicyPtr m_policy;
 };
 
 class DummyLoader : public ItemLoaderInterface
 {
 public:
+    explicit DummyLoader(const DataCompressionPolicyPtr &policy)
+        : m_policy(policy)
+    {
+    }
+
     QString id() const override { return QString(); }
     QString name() const override { return QString(); }
     QString author() const override { return QString(); }
@@ -193,25 +214,36 @@ public:
     ItemSaverPtr loadItems(const QString &, QAbstractItemModel *model, QIODevice *file, int maxItems) override
     {
         if ( file->size() > 0 ) {
+            auto clipboardModel = qobject_cast<ClipboardModel*>(model);
+            auto tabFile = qobject_cast<QFile*>(file);
+            if ( clipboardModel && tabFile
+                 && loadMappedItems(clipboardModel, tabFile->fileName(), maxItems) )
+            {
+                return std::make_shared<DummySaver>(m_policy);
+            }
+
             if ( !deserializeData(model, file, maxItems) ) {
                 model->removeRows(0, model->rowCount());
                 return nullptr;
             }
         }
 
-        return std::make_shared<DummySaver>();
+        return std::make_shared<DummySaver>(m_policy);
     }
 
     ItemSaverPtr initializeTab(const QString &, QAbstractItemModel *, int) override
     {
-        return std::make_shared<DummySaver>();
+        return std::make_shared<DummySaver>(m_policy);
     }
 
-    bool matches(const QModelIndex &index, const QRegExp &re) const override
+    QString searchableText(const QVariantMap &data) const override
     {
-        const QString text = index.data(contentType::text).toString();
-        return re.indexIn(text) != -1;
+        return getTextData(data);
     }
+
+private:
+    /// Shared with ItemFactory which updates it when settings change.
+    DataCompressionPolicyPtr m_policy;
 };
 
 ItemSaverPtr transformSaver(
@@ -268,7 +300,8 @@ ItemSaverPtr saveWithOther(
 ItemFactory::ItemFactory(QObject *parent)
     : QObject(parent)
     , m_loaders()
-    , m_dummyLoader(std::make_shared<DummyLoader>())
+    , m_dataCompressionPolicy(std::make_shared<DataCompressionPolicy>())
+    , m_dummyLoader(std::make_shared<DummyLoader>(m_dataCompressionPolicy))
     , m_disabledLoaders()
     , m_loaderChildren()
 {
@@ -357,6 +390,11 @@ void ItemFactory::setPluginPriority(const QStringList &pluginNames)
     std::sort( m_loaders.begin(), m_loaders.end(), PluginSorter(pluginNames) );
 }
 
+void ItemFactory::setDataCompressionPolicy(const QString &policy)
+{
+    *m_dataCompressionPolicy = DataCompressionPolicy::fromString(policy);
+}
+
 void ItemFactory::setLoaderEnabled(const ItemLoaderPtr &loader, bool enabled)
 {
     if ( isLoaderEnabled(loader) != enabled ) {
@@ -406,21 +444,22 @@ ItemSaverPtr ItemFactory::initializeTab(const QString &tabName, QAbstractItemMod
 
 bool ItemFactory::matches(const QModelIndex &index, const QRegExp &re) const
 {
-    // Match formats if the filter expression contains single '/'.
-    if (re.pattern().count('/') == 1) {
-        const QVariantMap data = index.data(contentType::data).toMap();
-        for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-            if ( re.exactMatch(it.key()) )
-                return true;
-        }
-    }
+    return matches( index, TextMatcher(re) );
+}
 
-    for ( const auto &loader : enabledLoaders() ) {
-        if ( isLoaderEnabled(loader) && loader->matches(index, re) )
-            return true;
-    }
+bool ItemFactory::matches(const QModelIndex &index, const TextMatcher &matcher) const
+{
+    // Match formats if the filter expression contains single '/'.
+    const bool withFormats = filterMatchesFormats( matcher.regExp() );
+    return filterMatches( filterData(index, withFormats), matcher );
+}
 
-    return false;
+ItemFilterData ItemFactory::filterData(const QModelIndex &index, bool withFormats) const
+{
+    const QStringList formats = withFormats
+            ? index.data(contentType::formats).toStringList() : QStringList();
+    return itemFilterData(
+                index.data(contentType::searchData).toMap(), formats, enabledLoaders() );
 }
 
 QList<ItemScriptable*> ItemFactory::scriptableObjects(QObject *parent) const
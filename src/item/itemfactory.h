@@ -20,6 +20,7 @@
 #ifndef ITEMFACTORY_H
 #define ITEMFACTORY_H
 
+#include "item/itemfilter.h"
 #include "item/itemwidget.h"
 
 #include <QMap>
@@ -29,6 +30,7 @@
 
 #include <memory>
 
+class DataCompressionPolicy;
 class ItemLoaderInterface;
 class ItemWidget;
 class QAbstractItemModel;
@@ -38,8 +40,6 @@ class QWidget;
 struct Command;
 struct CommandMenu;
 
-using ItemLoaderList = QVector<ItemLoaderPtr>;
-
 /**
  * Loads item plugins (loaders) and instantiates ItemWidget objects using appropriate
  * ItemLoaderInterface::create().
@@ -104,6 +104,12 @@ public:
      */
     void setLoaderEnabled(const ItemLoaderPtr &loader, bool enabled);
 
+    /**
+     * Set codecs for compressing data in tab files saved without plugins
+     * (see DataCompressionPolicy::fromString()).
+     */
+    void setDataCompressionPolicy(const QString &policy);
+
     /**
      * Return true if @a loader is enabled.
      */
@@ -127,10 +133,28 @@ public:
     ItemSaverPtr initializeTab(const QString &tabName, QAbstractItemModel *model, int maxItems);
 
     /**
-     * Return true only if any plugin (ItemLoaderInterface::matches()) returns true;
+     * Return true if expression matches any searchable text from plugins
+     * (or item format if expression matches formats).
      */
     bool matches(const QModelIndex &index, const QRegExp &re) const;
 
+    /**
+     * Same as above but faster if called for many items with same expression.
+     *
+     * Items are matched same way as when filtering in another thread
+     * (see filterData() and filterMatches()).
+     */
+    bool matches(const QModelIndex &index, const TextMatcher &matcher) const;
+
+    /**
+     * Return item texts to match with search expression.
+     * @see itemFilterData()
+     */
+    ItemFilterData filterData(const QModelIndex &index, bool withFormats) const;
+
+    /** Return enabled plugins with dummy item loader. */
+    ItemLoaderList enabledLoaders() const;
+
     QList<ItemScriptable *> scriptableObjects(QObject *parent) const;
 
     /**
@@ -151,15 +175,13 @@ private slots:
 private:
     bool loadPlugins();
 
-    /** Return enabled plugins with dummy item loader. */
-    ItemLoaderList enabledLoaders() const;
-
     /** Calls ItemLoaderInterface::transform() for all plugins in reverse order. */
     ItemWidget *transformItem(ItemWidget *item, const QModelIndex &index);
 
     void addLoader(const ItemLoaderPtr &loader);
 
     ItemLoaderList m_loaders;
+    std::shared_ptr<DataCompressionPolicy> m_dataCompressionPolicy;
     ItemLoaderPtr m_dummyLoader;
     ItemLoaderList m_disabledLoaders;
     QMap<QObject *, ItemLoaderPtr> m_loaderChildren;
@@ -0,0 +1,286 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemfilter.h"
+
+#include "common/contenttype.h"
+#include "common/textsearch.h"
+#include "item/clipboarditem.h"
+
+namespace {
+
+const int firstChunkSize = 100;
+const int chunkSize = 2000;
+
+/**
+ * Returns literal words in expression (separated by ".*").
+ *
+ * Expressions from search bar contain escaped words separated by ".*"
+ * unless regular expressions are enabled.
+ *
+ * @return false if expression contains other special characters
+ */
+bool literalWords(const QRegExp &re, QStringList *words)
+{
+    const QString pattern = re.pattern();
+
+    if (re.patternSyntax() == QRegExp::FixedString) {
+        words->append(pattern);
+        return true;
+    }
+
+    if (re.patternSyntax() != QRegExp::RegExp && re.patternSyntax() != QRegExp::RegExp2)
+        return false;
+
+    QString word;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == '\\') {
+            ++i;
+            if ( i == pattern.size() || pattern[i].isLetterOrNumber() )
+                return false;
+            word.append(pattern[i]);
+        } else if ( c == '.' && i + 1 < pattern.size() && pattern[i + 1] == '*' ) {
+            ++i;
+            words->append(word);
+            word.clear();
+        } else if ( QString("^$.[]|()?*+{}").contains(c) ) {
+            return false;
+        } else {
+            word.append(c);
+        }
+    }
+
+    words->append(word);
+
+    return true;
+}
+
+/**
+ * Returns true only if any text matched by @a re is also matched by @a previousRe.
+ */
+bool refines(const QRegExp &re, const QRegExp &previousRe)
+{
+    if ( re.caseSensitivity() != previousRe.caseSensitivity()
+         || filterMatchesFormats(re) || filterMatchesFormats(previousRe) )
+    {
+        return false;
+    }
+
+    QStringList words;
+    QStringList previousWords;
+    if ( !literalWords(re, &words) || !literalWords(previousRe, &previousWords) )
+        return false;
+
+    // Each previous word must be in a word at the same position.
+    if ( words.size() < previousWords.size() )
+        return false;
+
+    for (int i = 0; i < previousWords.size(); ++i) {
+        if ( !words[i].contains(previousWords[i], re.caseSensitivity()) )
+            return false;
+    }
+
+    return true;
+}
+
+bool isSameExpression(const QRegExp &re1, const QRegExp &re2)
+{
+    return re1.pattern() == re2.pattern()
+            && re1.caseSensitivity() == re2.caseSensitivity()
+            && re1.patternSyntax() == re2.patternSyntax();
+}
+
+} // namespace
+
+bool filterMatchesFormats(const QRegExp &re)
+{
+    return re.pattern().count('/') == 1;
+}
+
+TextMatcher::TextMatcher(const QRegExp &re)
+    : m_re(re)
+{
+    m_isLiteral = literalWords(re, &m_words);
+    if (m_isLiteral) {
+        m_words.removeAll(QString());
+        return;
+    }
+
+#if QT_VERSION >= 0x050000
+    if ( re.patternSyntax() == QRegExp::RegExp || re.patternSyntax() == QRegExp::RegExp2 ) {
+        // Keep behavior of QRegExp ("." matches new line, "$" matches only at end,
+        // "\w" and "\d" match non-ASCII letters and digits).
+        auto options = QRegularExpression::DotMatchesEverythingOption
+                | QRegularExpression::DollarEndOnlyOption
+                | QRegularExpression::UseUnicodePropertiesOption;
+        if (re.caseSensitivity() == Qt::CaseInsensitive)
+            options |= QRegularExpression::CaseInsensitiveOption;
+
+        m_regularExpression = QRegularExpression(re.pattern(), options);
+        m_useRegularExpression = m_regularExpression.isValid();
+#   if QT_VERSION >= 0x050400
+        if (m_useRegularExpression)
+            m_regularExpression.optimize();
+#   endif
+    }
+#endif
+}
+
+bool TextMatcher::matches(const QString &text) const
+{
+    if (m_isLiteral) {
+        int from = 0;
+        for (const auto &word : m_words) {
+            const int i = indexOfLiteral(text, word, from, m_re.caseSensitivity());
+            if (i == -1)
+                return false;
+            from = i + word.size();
+        }
+        return true;
+    }
+
+#if QT_VERSION >= 0x050000
+    if (m_useRegularExpression)
+        return m_regularExpression.match(text).hasMatch();
+#endif
+
+    return m_re.indexIn(text) != -1;
+}
+
+ItemFilterData itemFilterData(
+        const QVariantMap &searchData, const QStringList &formats, const ItemLoaderList &loaders)
+{
+    ItemFilterData data;
+    data.formats = formats;
+
+    for (const auto &loader : loaders) {
+        const QString text = loader->searchableText(searchData);
+        if ( !text.isNull() )
+            data.texts.append(text);
+    }
+
+    return data;
+}
+
+bool filterMatches(const ItemFilterData &data, const TextMatcher &matcher)
+{
+    for (const auto &format : data.formats) {
+        if ( matcher.matchesFormat(format) )
+            return true;
+    }
+
+    for (const auto &text : data.texts) {
+        if ( matcher.matches(text) )
+            return true;
+    }
+
+    return false;
+}
+
+QBitArray ItemFilterCache::begin(const QRegExp &re, bool *restored)
+{
+    *restored = false;
+
+    while ( !m_results.isEmpty() ) {
+        const Result &result = m_results.last();
+        if ( result.done && isSameExpression(result.re, re) ) {
+            *restored = true;
+            return result.hidden;
+        }
+
+        if ( result.done && refines(re, result.re) )
+            break;
+
+        m_results.removeLast();
+    }
+
+    if ( re.isEmpty() )
+        return QBitArray();
+
+    const QBitArray previousHidden = m_results.isEmpty() ? QBitArray() : m_results.last().hidden;
+    m_results.append( Result{re, QBitArray(), false} );
+    return previousHidden;
+}
+
+void ItemFilterCache::setResult(const QBitArray &hidden)
+{
+    if ( !m_results.isEmpty() && !m_results.last().done ) {
+        m_results.last().hidden = hidden;
+        m_results.last().done = true;
+    }
+}
+
+ItemFilterTask::ItemFilterTask(
+        const ItemFilterItemsPtr &items, const ItemLoaderList &loaders,
+        int firstRow, const TextMatcher &matcher, int filterRow)
+    : m_items(items)
+    , m_loaders(loaders)
+    , m_firstRow(firstRow)
+    , m_matcher(matcher)
+    , m_filterRow(filterRow)
+    , m_cancelled(0)
+{
+    setAutoDelete(false);
+}
+
+void ItemFilterTask::run()
+{
+    const int rowCount = m_items->size();
+    const bool withFormats = filterMatchesFormats( m_matcher.regExp() );
+    int size = firstChunkSize;
+
+    for (int row = m_firstRow; row < rowCount && !isCancelled(); row += size, size = chunkSize) {
+        const int count = qMin(size, rowCount - row);
+        QBitArray hidden(count);
+        for (int i = 0; i < count && !isCancelled(); ++i) {
+            const int itemRow = row + i;
+            if ( itemRow == m_filterRow )
+                continue;
+
+            const bool isCandidate = m_candidates.isEmpty()
+                    || (itemRow < m_candidates.size() && m_candidates.testBit(itemRow));
+            if ( !isCandidate || !matches(m_items->at(itemRow), withFormats) )
+                hidden.setBit(i);
+        }
+
+        if ( !isCancelled() )
+            emit rowsFiltered(row, hidden);
+    }
+
+    emit finished();
+}
+
+void ItemFilterTask::cancel()
+{
+    m_cancelled.fetchAndStoreOrdered(1);
+}
+
+bool ItemFilterTask::matches(const ClipboardItem &item, bool withFormats) const
+{
+    const QStringList formats = withFormats
+            ? item.data(contentType::formats).toStringList() : QStringList();
+    const QVariantMap searchData = item.data(contentType::searchData).toMap();
+    return filterMatches( itemFilterData(searchData, formats, m_loaders), m_matcher );
+}
+
+bool ItemFilterTask::isCancelled()
+{
+    return m_cancelled.fetchAndAddOrdered(0) != 0;
+}
@@ -0,0 +1,197 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMFILTER_H
+#define ITEMFILTER_H
+
+#include "item/itemwidget.h"
+
+#include <QAtomicInt>
+#include <QBitArray>
+#include <QObject>
+#include <QRegExp>
+#if QT_VERSION >= 0x050000
+#   include <QRegularExpression>
+#endif
+#include <QRunnable>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+class ClipboardItem;
+
+/**
+ * Texts of an item to match with search expression.
+ *
+ * @see itemFilterData()
+ */
+struct ItemFilterData {
+    /// Item formats (set only if search expression matches formats).
+    QStringList formats;
+    /// Texts from plugins (see ItemLoaderInterface::searchableText()).
+    QStringList texts;
+};
+
+/**
+ * Matches texts with search expression.
+ *
+ * Literal expressions (e.g. from search bar if regular expressions are not
+ * enabled) are matched with fast substring search (see indexOfLiteral()).
+ * Other expressions are compiled once with QRegularExpression (in Qt 5).
+ */
+class TextMatcher
+{
+public:
+    explicit TextMatcher(const QRegExp &re = QRegExp());
+
+    /// Returns true if expression matches part of @a text.
+    bool matches(const QString &text) const;
+
+    /// Returns true if expression matches whole @a format.
+    bool matchesFormat(const QString &format) const { return m_re.exactMatch(format); }
+
+    const QRegExp &regExp() const { return m_re; }
+
+private:
+    QRegExp m_re;
+    /// Words to find in order if expression is literal.
+    QStringList m_words;
+    bool m_isLiteral = false;
+#if QT_VERSION >= 0x050000
+    QRegularExpression m_regularExpression;
+    bool m_useRegularExpression = false;
+#endif
+};
+
+/// Items to filter (copies share data with items in model).
+using ItemFilterItemsPtr = std::shared_ptr<const QVector<ClipboardItem>>;
+
+/// Returns true if search expression should be matched against item formats.
+bool filterMatchesFormats(const QRegExp &re);
+
+/**
+ * Returns item texts to match with search expression.
+ *
+ * Can be called from any thread.
+ *
+ * @param searchData item formats for search (see contentType::searchData)
+ * @param formats item formats, should be set only if search expression
+ *        matches formats (see filterMatchesFormats())
+ * @param loaders enabled plugins (see ItemLoaderInterface::searchableText())
+ */
+ItemFilterData itemFilterData(
+        const QVariantMap &searchData, const QStringList &formats, const ItemLoaderList &loaders);
+
+/// Returns true if search expression matches item.
+bool filterMatches(const ItemFilterData &data, const TextMatcher &matcher);
+
+/**
+ * Results of previous search expressions so that refined expression
+ * (e.g. user types another character) is matched only with items which
+ * matched previous expression.
+ *
+ * Results are kept in a stack, each expression is refinement of the previous one.
+ */
+class ItemFilterCache
+{
+public:
+    /**
+     * Starts new search with @a re.
+     *
+     * Removes results of expressions which @a re doesn't refine.
+     *
+     * @return hidden rows of previous expression which @a re refines
+     *         (or empty if all rows need to be matched);
+     *         @a restored is set to true if these are results for @a re
+     */
+    QBitArray begin(const QRegExp &re, bool *restored);
+
+    /// Sets hidden rows for current expression once all rows are matched.
+    void setResult(const QBitArray &hidden);
+
+    /// Removes all results (e.g. if items change).
+    void clear() { m_results.clear(); }
+
+private:
+    struct Result {
+        QRegExp re;
+        QBitArray hidden;
+        bool done;
+    };
+
+    QVector<Result> m_results;
+};
+
+/**
+ * Matches items with search expression in chunks (in a thread pool).
+ *
+ * Item texts are collected from plugins in the thread too (see itemFilterData()).
+ *
+ * Results are reported after each chunk, the first chunk is small so that
+ * first visible items can be shown early.
+ *
+ * Object should be deleted only after finished() signal is emitted.
+ */
+class ItemFilterTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Matches items starting at @a firstRow.
+     * Row @a filterRow is never hidden.
+     */
+    ItemFilterTask(
+            const ItemFilterItemsPtr &items, const ItemLoaderList &loaders,
+            int firstRow, const TextMatcher &matcher, int filterRow);
+
+    /**
+     * Hides rows not in @a candidates without matching them
+     * (ignored if @a candidates is empty).
+     */
+    void setCandidates(const QBitArray &candidates) { m_candidates = candidates; }
+
+    void run() override;
+
+    /// Stops matching as soon as possible.
+    void cancel();
+
+signals:
+    /// Reports rows hidden by the filter (rows starting from @a firstRow).
+    void rowsFiltered(int firstRow, const QBitArray &hidden);
+
+    /// Emitted when done or cancelled.
+    void finished();
+
+private:
+    bool matches(const ClipboardItem &item, bool withFormats) const;
+
+    bool isCancelled();
+
+    ItemFilterItemsPtr m_items;
+    ItemLoaderList m_loaders;
+    int m_firstRow;
+    TextMatcher m_matcher;
+    int m_filterRow;
+    QBitArray m_candidates;
+    QAtomicInt m_cancelled;
+};
+
+#endif // ITEMFILTER_H
@@ -0,0 +1,170 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemheightcache.h"
+
+#include "item/painteditem.h"
+
+#include <QDataStream>
+#include <QMetaType>
+
+namespace {
+
+const qint32 heightFileVersion = 1;
+
+const int chunkSize = 500;
+
+/// Heights are shared for widths which differ only slightly.
+const int widthBucketSize = 16;
+
+quint64 heightKey(uint itemHash, int width)
+{
+    return (static_cast<quint64>(width / widthBucketSize) << 32) | itemHash;
+}
+
+} // namespace
+
+void ItemHeightCache::setLayoutKey(uint key)
+{
+    if (m_layoutKey == key)
+        return;
+
+    m_layoutKey = key;
+    m_heights.clear();
+}
+
+int ItemHeightCache::height(uint itemHash, int width) const
+{
+    const auto it = m_heights.constFind( heightKey(itemHash, width) );
+    return it == m_heights.constEnd() ? -1 : it->height;
+}
+
+void ItemHeightCache::setMeasuredHeight(uint itemHash, int width, int height)
+{
+    Height &value = m_heights[ heightKey(itemHash, width) ];
+    value.height = height;
+    value.measured = true;
+}
+
+void ItemHeightCache::setEstimatedHeight(uint itemHash, int width, int height)
+{
+    const quint64 key = heightKey(itemHash, width);
+    if ( !m_heights.contains(key) ) {
+        Height &value = m_heights[key];
+        value.height = height;
+        value.measured = false;
+    }
+}
+
+bool ItemHeightCache::contains(uint itemHash, int width) const
+{
+    return m_heights.contains( heightKey(itemHash, width) );
+}
+
+void ItemHeightCache::save(QDataStream *stream, const QSet<uint> &itemHashes) const
+{
+    QVector< QPair<quint64, qint32> > heights;
+    for (auto it = m_heights.constBegin(); it != m_heights.constEnd(); ++it) {
+        const uint itemHash = static_cast<uint>(it.key());
+        if ( it->measured && itemHashes.contains(itemHash) )
+            heights.append( qMakePair(it.key(), static_cast<qint32>(it->height)) );
+    }
+
+    *stream << heightFileVersion << m_layoutKey << static_cast<qint32>( heights.size() );
+    for (const auto &height : heights)
+        *stream << height.first << height.second;
+}
+
+bool ItemHeightCache::load(QDataStream *stream)
+{
+    qint32 version;
+    uint layoutKey;
+    qint32 count;
+    *stream >> version >> layoutKey >> count;
+    if ( stream->status() != QDataStream::Ok || version != heightFileVersion )
+        return false;
+
+    if (layoutKey != m_layoutKey)
+        return true;
+
+    quint64 key;
+    qint32 height;
+    for (qint32 i = 0; i < count && stream->status() == QDataStream::Ok; ++i) {
+        *stream >> key >> height;
+        Height &value = m_heights[key];
+        value.height = height;
+        value.measured = true;
+    }
+
+    return stream->status() == QDataStream::Ok;
+}
+
+ItemHeightTask::ItemHeightTask(
+        const ItemHeightRequestList &items, const QFont &font, QSize maxSize, bool textWrap,
+        const PaintedItemSettings &settings)
+    : m_items(items)
+    , m_font(font)
+    , m_maxSize(maxSize)
+    , m_textWrap(textWrap)
+    , m_settings(settings)
+    , m_cancelled(0)
+{
+    setAutoDelete(false);
+    qRegisterMetaType< QVector<uint> >("QVector<uint>");
+    qRegisterMetaType< QVector<int> >("QVector<int>");
+}
+
+void ItemHeightTask::run()
+{
+    const int count = m_items.size();
+
+    for (int i = 0; i < count && !isCancelled(); i += chunkSize) {
+        const int end = qMin(i + chunkSize, count);
+        QVector<uint> itemHashes;
+        QVector<int> heights;
+        itemHashes.reserve(end - i);
+        heights.reserve(end - i);
+
+        for (int j = i; j < end && !isCancelled(); ++j) {
+            const auto &item = m_items[j];
+            const QSize size = item.image.isEmpty()
+                    ? PaintedItem::textSizeHint(item.text, item.isHtml, m_font, m_maxSize, m_textWrap, m_settings)
+                    : PaintedItem::imageSizeHint(item.image, m_maxSize, m_settings);
+            if ( size.isValid() ) {
+                itemHashes.append(item.itemHash);
+                heights.append( size.height() );
+            }
+        }
+
+        if ( !isCancelled() && !itemHashes.isEmpty() )
+            emit heightsEstimated(itemHashes, heights);
+    }
+
+    emit finished();
+}
+
+void ItemHeightTask::cancel()
+{
+    m_cancelled.fetchAndStoreOrdered(1);
+}
+
+bool ItemHeightTask::isCancelled()
+{
+    return m_cancelled.fetchAndAddOrdered(0) != 0;
+}
@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMHEIGHTCACHE_H
+#define ITEMHEIGHTCACHE_H
+
+#include "item/painteditem.h"
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFont>
+#include <QHash>
+#include <QObject>
+#include <QRunnable>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class QDataStream;
+
+/**
+ * Heights of item contents for item hash and available width.
+ *
+ * Used as size hints for items which are not rendered yet so that range of
+ * scroll bar is correct without creating item widgets.
+ *
+ * Heights are either measured (from rendered items) or estimated
+ * (see ItemHeightTask). Measured heights can be saved with tab.
+ */
+class ItemHeightCache
+{
+public:
+    /**
+     * Sets key for settings which affect item layout (theme, fonts, plugin settings).
+     *
+     * Removes all heights if the key changes.
+     */
+    void setLayoutKey(uint key);
+
+    /// Returns height or -1 if unknown.
+    int height(uint itemHash, int width) const;
+
+    void setMeasuredHeight(uint itemHash, int width, int height);
+
+    /// Sets estimated height unless it's already known.
+    void setEstimatedHeight(uint itemHash, int width, int height);
+
+    bool contains(uint itemHash, int width) const;
+
+    int count() const { return m_heights.size(); }
+
+    void clear() { m_heights.clear(); }
+
+    /// Writes measured heights of items with given hashes.
+    void save(QDataStream *stream, const QSet<uint> &itemHashes) const;
+
+    /**
+     * Reads measured heights.
+     *
+     * Heights saved with different layout key are ignored.
+     */
+    bool load(QDataStream *stream);
+
+private:
+    struct Height {
+        int height;
+        bool measured;
+    };
+
+    QHash<quint64, Height> m_heights;
+    uint m_layoutKey = 0;
+};
+
+/// Only the data needed to lay out item (see PaintedItem::textSizeHint() and PaintedItem::imageSizeHint()).
+struct ItemHeightRequest {
+    uint itemHash;
+    /// Plain text or HTML (empty for image).
+    QString text;
+    bool isHtml;
+    /// Encoded image (only image header is read).
+    QByteArray image;
+};
+
+using ItemHeightRequestList = QVector<ItemHeightRequest>;
+
+/**
+ * Estimates heights of items in chunks (in a thread pool).
+ *
+ * Items must be simple enough to be laid out without widgets
+ * (see PaintedItem::canPaint()).
+ *
+ * Object should be deleted only after finished() signal is emitted.
+ */
+class ItemHeightTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ItemHeightTask(const ItemHeightRequestList &items,
+                   const QFont &font, QSize maxSize, bool textWrap,
+                   const PaintedItemSettings &settings);
+
+    void run() override;
+
+    /// Stops estimating as soon as possible.
+    void cancel();
+
+signals:
+    /// Reports heights of items with given hashes (both lists have same size).
+    void heightsEstimated(const QVector<uint> &itemHashes, const QVector<int> &heights);
+
+    /// Emitted when done or cancelled.
+    void finished();
+
+private:
+    bool isCancelled();
+
+    ItemHeightRequestList m_items;
+    QFont m_font;
+    QSize m_maxSize;
+    bool m_textWrap;
+    PaintedItemSettings m_settings;
+    QAtomicInt m_cancelled;
+};
+
+#endif // ITEMHEIGHTCACHE_H
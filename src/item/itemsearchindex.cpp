@@ -0,0 +1,252 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemsearchindex.h"
+
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+
+#include <QRegExp>
+#include <QStringList>
+
+namespace {
+
+/// Texts longer than this are not indexed (items are always matched).
+const int maxIndexedTextLength = 100 * 1024;
+
+quint64 trigram(const QChar *text)
+{
+    return (static_cast<quint64>(text[0].unicode()) << 32)
+            | (static_cast<quint64>(text[1].unicode()) << 16)
+            | static_cast<quint64>(text[2].unicode());
+}
+
+QSet<quint64> trigrams(const QString &text)
+{
+    QSet<quint64> result;
+
+    const QString foldedText = text.toCaseFolded();
+    const QChar *data = foldedText.constData();
+    for (int i = 0; i + 3 <= foldedText.size(); ++i)
+        result.insert( trigram(data + i) );
+
+    return result;
+}
+
+bool isIndexed(const QString &text)
+{
+    return text.size() <= maxIndexedTextLength;
+}
+
+/**
+ * Returns literal parts which must be contained in any text matched by
+ * regular expression.
+ *
+ * @return false if the expression is too complex
+ */
+bool requiredLiterals(const QRegExp &re, QStringList *literals)
+{
+    const QString pattern = re.pattern();
+
+    if (re.patternSyntax() == QRegExp::FixedString) {
+        literals->append(pattern);
+        return true;
+    }
+
+    if (re.patternSyntax() != QRegExp::RegExp && re.patternSyntax() != QRegExp::RegExp2)
+        return false;
+
+    QString literal;
+    const auto endLiteral = [&]() {
+        if ( !literal.isEmpty() ) {
+            literals->append(literal);
+            literal.clear();
+        }
+    };
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+
+        if (c == '\\') {
+            ++i;
+            if ( i == pattern.size() )
+                return false;
+
+            const QChar escaped = pattern[i];
+            if ( QString("dDwWsSbB").contains(escaped) ) {
+                // Character classes and word boundaries.
+                endLiteral();
+            } else if ( escaped.isLetterOrNumber() ) {
+                // Back references and escape sequences (e.g. \x41, \0101, \u0041).
+                return false;
+            } else {
+                literal.append(escaped);
+            }
+        } else if (c == '|' || c == '(' || c == ')') {
+            // Alternatives and groups are not supported.
+            return false;
+        } else if (c == '*' || c == '?' || c == '{') {
+            // Preceding character is optional.
+            literal.chop(1);
+            endLiteral();
+            if (c == '{') {
+                i = pattern.indexOf('}', i);
+                if (i == -1)
+                    return false;
+            }
+        } else if (c == '[') {
+            endLiteral();
+            // Skip character class ("]" right after "[" or "[^" is literal).
+            ++i;
+            if ( i < pattern.size() && pattern[i] == '^' )
+                ++i;
+            if ( i < pattern.size() && pattern[i] == ']' )
+                ++i;
+            while ( i < pattern.size() && pattern[i] != ']' ) {
+                if (pattern[i] == '\\')
+                    ++i;
+                ++i;
+            }
+            if ( i >= pattern.size() )
+                return false;
+        } else if (c == '.' || c == '^' || c == '$' || c == '+') {
+            endLiteral();
+        } else {
+            literal.append(c);
+        }
+    }
+
+    endLiteral();
+
+    return true;
+}
+
+} // namespace
+
+QString itemSearchText(const QVariantMap &data)
+{
+    QString text = getTextData(data);
+
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if ( it.key().startsWith(COPYQ_MIME_PREFIX) ) {
+            text.append('\n');
+            text.append( getTextData(it.value().toByteArray()) );
+        }
+    }
+
+    return text;
+}
+
+void ItemSearchIndex::addItem(uint id, const QString &text)
+{
+    if ( !isIndexed(text) ) {
+        m_unindexed.insert(id);
+        return;
+    }
+
+    for ( const auto key : trigrams(text) )
+        m_postings[key].append(id);
+}
+
+void ItemSearchIndex::removeItem(uint id, const QString &text)
+{
+    if ( !isIndexed(text) ) {
+        m_unindexed.remove(id);
+        return;
+    }
+
+    for ( const auto key : trigrams(text) ) {
+        const auto it = m_postings.find(key);
+        if ( it == m_postings.end() )
+            continue;
+
+        auto &ids = it.value();
+        const int i = ids.indexOf(id);
+        if (i != -1) {
+            ids[i] = ids.last();
+            ids.removeLast();
+        }
+
+        if ( ids.isEmpty() )
+            m_postings.erase(it);
+    }
+}
+
+void ItemSearchIndex::clear()
+{
+    m_postings.clear();
+    m_unindexed.clear();
+}
+
+bool ItemSearchIndex::candidates(const QRegExp &re, QSet<uint> *ids) const
+{
+    QStringList literals;
+    if ( !requiredLiterals(re, &literals) )
+        return false;
+
+    // Use the least frequent trigram to get candidates.
+    const QVector<uint> *bestIds = nullptr;
+    bool hasTrigram = false;
+    for (const auto &literal : literals) {
+        for ( const auto key : trigrams(literal) ) {
+            hasTrigram = true;
+            const auto it = m_postings.constFind(key);
+            if ( it == m_postings.constEnd() ) {
+                *ids = m_unindexed;
+                return true;
+            }
+
+            if ( !bestIds || it.value().size() < bestIds->size() )
+                bestIds = &it.value();
+        }
+    }
+
+    if (!hasTrigram)
+        return false;
+
+    *ids = m_unindexed;
+    ids->reserve( ids->size() + bestIds->size() );
+    for (const auto id : *bestIds)
+        ids->insert(id);
+
+    return true;
+}
+
+ItemSearchIndexTask::ItemSearchIndexTask(const QVector<ClipboardItem> &items)
+    : m_items(items)
+{
+    setAutoDelete(false);
+}
+
+void ItemSearchIndexTask::run()
+{
+    QSet<uint> itemHashes;
+    for (const auto &item : m_items) {
+        const uint itemHash = item.dataHash();
+        if ( !itemHashes.contains(itemHash) ) {
+            itemHashes.insert(itemHash);
+            m_index.addItem( itemHash, item.searchText() );
+        }
+    }
+
+    // Drop item data before the index is passed to main thread.
+    m_items.clear();
+
+    emit finished();
+}
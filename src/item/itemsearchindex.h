@@ -0,0 +1,103 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMSEARCHINDEX_H
+#define ITEMSEARCHINDEX_H
+
+#include "item/clipboarditem.h"
+
+#include <QHash>
+#include <QObject>
+#include <QRunnable>
+#include <QSet>
+#include <QVariantMap>
+#include <QVector>
+
+class QRegExp;
+class QString;
+
+/**
+ * Returns text of an item for search index.
+ *
+ * Contains item text and all internal formats (notes, tags etc.) so it
+ * includes all texts matched by plugins (see ItemLoaderInterface::searchableText()).
+ */
+QString itemSearchText(const QVariantMap &data);
+
+/**
+ * Trigram index of item texts.
+ *
+ * Maps case-folded trigrams of item texts (see itemSearchText()) to item IDs
+ * so that only items containing all literal parts of a search expression
+ * need to be matched.
+ *
+ * Each item ID must be added only once.
+ */
+class ItemSearchIndex
+{
+public:
+    void addItem(uint id, const QString &text);
+
+    /// Removes item; @a text must be same as when the item was added.
+    void removeItem(uint id, const QString &text);
+
+    void clear();
+
+    /**
+     * Returns IDs of items that can match the expression.
+     *
+     * @return false if index cannot be used for the expression (any item can match)
+     */
+    bool candidates(const QRegExp &re, QSet<uint> *ids) const;
+
+private:
+    QHash< quint64, QVector<uint> > m_postings;
+    /// Items with too long text which are always matched.
+    QSet<uint> m_unindexed;
+};
+
+/**
+ * Builds search index of items in a thread pool.
+ *
+ * Item hashes are used as IDs.
+ *
+ * Object should be deleted only after finished() signal is emitted.
+ */
+class ItemSearchIndexTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    /// Items are copies which share data with items in model.
+    explicit ItemSearchIndexTask(const QVector<ClipboardItem> &items);
+
+    void run() override;
+
+    /// Returns built index (call only after finished() is emitted).
+    const ItemSearchIndex &index() const { return m_index; }
+
+signals:
+    void finished();
+
+private:
+    QVector<ClipboardItem> m_items;
+    ItemSearchIndex m_index;
+};
+
+#endif // ITEMSEARCHINDEX_H
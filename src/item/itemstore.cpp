@@ -20,16 +20,50 @@
 #include "itemstore.h"
 
 #include "common/config.h"
+#include "common/contenttype.h"
 #include "common/log.h"
 #include "common/textdata.h"
+#include "item/clipboardmodel.h"
 #include "item/itemfactory.h"
+#include "item/itemfilter.h"
+#include "item/itemheightcache.h"
+#include "item/itemsearchindex.h"
+#include "item/mappeditemdata.h"
+#include "item/serialize.h"
 
 #include <QAbstractItemModel>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+
+#include <algorithm>
+#include <memory>
 
 namespace {
 
+const qint32 journalVersion = 1;
+
+const qint32 searchFileVersion = 2;
+
+/// Journal is merged into tab file if it's bigger than tab file and this size.
+const qint64 minJournalSizeToCompact = 1024 * 1024;
+
+/// Size of data at the end of tab file used to check if journal belongs to the file.
+const qint64 tabFileTailSize = 4096;
+
+enum JournalRecordType {
+    JournalInsert = 1,
+    JournalRemove = 2,
+    JournalMove = 3,
+    JournalUpdate = 4
+};
+
 /// @return File name for data file with items.
 QString itemFileName(const QString &id)
 {
@@ -38,6 +72,284 @@ QString itemFileName(const QString &id)
     return getConfigurationFilePath("_tab_") + part + QString(".dat");
 }
 
+/// @return File name for journal with changes not yet saved in data file.
+QString journalFileName(const QString &tabFileName)
+{
+    return tabFileName + ".log";
+}
+
+/// @return File name for texts of items used to search tab without loading it.
+QString searchFileName(const QString &tabFileName)
+{
+    return tabFileName + ".idx";
+}
+
+/// @return File name for heights of rendered items.
+QString heightFileName(const QString &tabFileName)
+{
+    return tabFileName + ".sizes";
+}
+
+/// Moves file next to tab file if it exists.
+void moveTabFile(const QString &oldFileName, const QString &newFileName)
+{
+    if ( QFile::exists(oldFileName) ) {
+        QFile::remove(newFileName);
+        if ( QFile::copy(oldFileName, newFileName) )
+            QFile::remove(oldFileName);
+    }
+}
+
+void initDataStream(QDataStream *stream)
+{
+    stream->setVersion(QDataStream::Qt_4_7);
+}
+
+/**
+ * Identifies content of tab file using its size and checksum of data
+ * at the end of the file.
+ */
+struct TabFileId {
+    qint64 size = -1;
+    quint16 checksum = 0;
+
+    bool operator==(const TabFileId &other) const
+    {
+        return size == other.size && checksum == other.checksum;
+    }
+};
+
+TabFileId tabFileId(const QString &tabFileName)
+{
+    TabFileId id;
+
+    QFile tabFile(tabFileName);
+    if ( !tabFile.open(QIODevice::ReadOnly) )
+        return id;
+
+    id.size = tabFile.size();
+    const qint64 tailSize = qMin(id.size, tabFileTailSize);
+    if ( !tabFile.seek(id.size - tailSize) )
+        return TabFileId();
+
+    const QByteArray tail = tabFile.read(tailSize);
+    id.checksum = qChecksum( tail.constData(), static_cast<uint>(tail.size()) );
+
+    return id;
+}
+
+/**
+ * Identifies saved items (tab file and journal).
+ */
+struct SavedItemsId {
+    TabFileId tabFile;
+    qint64 journalSize = -1;
+
+    bool operator==(const SavedItemsId &other) const
+    {
+        return tabFile == other.tabFile && journalSize == other.journalSize;
+    }
+};
+
+SavedItemsId savedItemsId(const QString &tabFileName)
+{
+    SavedItemsId id;
+    id.tabFile = tabFileId(tabFileName);
+
+    const QFileInfo journalInfo( journalFileName(tabFileName) );
+    id.journalSize = journalInfo.exists() ? journalInfo.size() : 0;
+
+    return id;
+}
+
+bool readSearchFileHeader(QDataStream *stream, SavedItemsId *id)
+{
+    qint32 version;
+    *stream >> version >> id->tabFile.size >> id->tabFile.checksum >> id->journalSize;
+    return stream->status() == QDataStream::Ok && version == searchFileVersion;
+}
+
+/**
+ * Texts of saved items indexed for search.
+ */
+struct SavedItemSearch {
+    qint64 fileSize = -1;
+    QDateTime lastModified;
+    SavedItemsId id;
+    /// Searchable texts from plugins for each item (see ItemFactory::filterData()).
+    QList<QStringList> texts;
+    /// Item IDs are rows.
+    ItemSearchIndex index;
+};
+
+using SavedItemSearchPtr = std::shared_ptr<SavedItemSearch>;
+
+SavedItemSearchPtr loadSavedItemSearch(const QString &fileName)
+{
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return nullptr;
+
+    QDataStream stream(&file);
+    initDataStream(&stream);
+
+    const auto search = std::make_shared<SavedItemSearch>();
+    qint32 count;
+    if ( !readSearchFileHeader(&stream, &search->id) )
+        return nullptr;
+
+    stream >> count;
+    QStringList texts;
+    for (qint32 row = 0; row < count && stream.status() == QDataStream::Ok; ++row) {
+        stream >> texts;
+        search->texts.append(texts);
+        search->index.addItem( static_cast<uint>(row), texts.join("\n") );
+    }
+
+    if ( stream.status() != QDataStream::Ok )
+        return nullptr;
+
+    return search;
+}
+
+/**
+ * Returns search index for saved items in tab.
+ * @return nullptr if search file is missing or outdated
+ */
+SavedItemSearchPtr savedItemSearch(const QString &tabFileName)
+{
+    // Search files are kept in memory for repeated searches.
+    static QHash<QString, SavedItemSearchPtr> cache;
+
+    const QString fileName = searchFileName(tabFileName);
+    const QFileInfo info(fileName);
+    if ( !info.exists() ) {
+        cache.remove(fileName);
+        return nullptr;
+    }
+
+    auto search = cache.value(fileName);
+    if ( !search || search->fileSize != info.size() || search->lastModified != info.lastModified() ) {
+        search = loadSavedItemSearch(fileName);
+        if (!search) {
+            cache.remove(fileName);
+            return nullptr;
+        }
+
+        search->fileSize = info.size();
+        search->lastModified = info.lastModified();
+        cache.insert(fileName, search);
+    }
+
+    if ( !(search->id == savedItemsId(tabFileName)) )
+        return nullptr;
+
+    return search;
+}
+
+bool readJournalHeader(QDataStream *stream, TabFileId *id)
+{
+    qint32 version;
+    *stream >> version >> id->size >> id->checksum;
+    return stream->status() == QDataStream::Ok && version == journalVersion;
+}
+
+void writeJournalHeader(QDataStream *stream, const TabFileId &id)
+{
+    *stream << journalVersion << id.size << id.checksum;
+}
+
+QByteArray journalRecord(JournalRecordType type, int row)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    initDataStream(&stream);
+    stream << static_cast<qint8>(type) << static_cast<qint32>(row);
+    return record;
+}
+
+QByteArray journalRecord(JournalRecordType type, int row, const QVariantMap &data)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    initDataStream(&stream);
+    stream << static_cast<qint8>(type) << static_cast<qint32>(row);
+    serializeData(&stream, data);
+    return record;
+}
+
+QByteArray journalRecord(JournalRecordType type, int row, int count, int destinationRow)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    initDataStream(&stream);
+    stream << static_cast<qint8>(type) << static_cast<qint32>(row)
+           << static_cast<qint32>(count) << static_cast<qint32>(destinationRow);
+    return record;
+}
+
+bool moveRows(QAbstractItemModel *model, int row, int count, int destinationRow)
+{
+#if QT_VERSION < 0x050000
+    // Journal doesn't contain moves of multiple items with Qt 4.
+    return count == 1
+            && QMetaObject::invokeMethod(model, "moveRow", Q_ARG(int, row), Q_ARG(int, destinationRow));
+#else
+    return model->moveRows(QModelIndex(), row, count, QModelIndex(), destinationRow);
+#endif
+}
+
+bool replayJournalRecord(const QByteArray &record, QAbstractItemModel *model)
+{
+    QDataStream stream(record);
+    initDataStream(&stream);
+
+    qint8 type;
+    qint32 row;
+    stream >> type >> row;
+    if ( stream.status() != QDataStream::Ok || row < 0 )
+        return false;
+
+    switch (type) {
+    case JournalInsert: {
+        QVariantMap data;
+        deserializeData(&stream, &data);
+        if ( stream.status() != QDataStream::Ok || row > model->rowCount() )
+            return false;
+        if ( !model->insertRow(row) )
+            return false;
+        model->setData( model->index(row, 0), data, contentType::data );
+        return true;
+    }
+
+    case JournalRemove: {
+        qint32 count;
+        stream >> count;
+        return stream.status() == QDataStream::Ok
+                && model->removeRows(row, count);
+    }
+
+    case JournalMove: {
+        qint32 count;
+        qint32 destinationRow;
+        stream >> count >> destinationRow;
+        return stream.status() == QDataStream::Ok
+                && moveRows(model, row, count, destinationRow);
+    }
+
+    case JournalUpdate: {
+        QVariantMap data;
+        deserializeData(&stream, &data);
+        if ( stream.status() != QDataStream::Ok || row >= model->rowCount() )
+            return false;
+        model->setData( model->index(row, 0), data, contentType::data );
+        return true;
+    }
+    }
+
+    return false;
+}
+
 bool createItemDirectory()
 {
     QDir settingsDir( settingsDirectoryPath() );
@@ -73,6 +385,111 @@ void printLoadItemFileError(const QString &id, const QString &fileName, const QF
     printItemFileError("load", id, fileName, file);
 }
 
+/**
+ * Replays changes from journal.
+ * @return false if tab file needs to be saved again
+ */
+bool replayJournal(
+        const QString &tabName, const QString &tabFileName,
+        QAbstractItemModel &model, const ItemSaverPtr &saver)
+{
+    QFile journalFile( journalFileName(tabFileName) );
+    if ( !journalFile.exists() )
+        return true;
+
+    if ( !saver->canJournalItems() ) {
+        log( QString("Tab \"%1\": Ignoring journal (unsupported tab format)").arg(tabName), LogWarning );
+        return false;
+    }
+
+    if ( !journalFile.open(QIODevice::ReadOnly) ) {
+        printLoadItemFileError(tabName, journalFile.fileName(), journalFile);
+        return false;
+    }
+
+    QDataStream stream(&journalFile);
+    initDataStream(&stream);
+
+    TabFileId id;
+    if ( !readJournalHeader(&stream, &id) || !(id == tabFileId(tabFileName)) ) {
+        log( QString("Tab \"%1\": Ignoring journal (tab file changed)").arg(tabName), LogWarning );
+        return false;
+    }
+
+    int recordCount = 0;
+    QByteArray record;
+    while ( !stream.atEnd() ) {
+        stream >> record;
+        if ( stream.status() != QDataStream::Ok || !replayJournalRecord(record, &model) ) {
+            log( QString("Tab \"%1\": Journal is corrupted after %2 changes")
+                 .arg(tabName).arg(recordCount), LogWarning );
+            return false;
+        }
+        ++recordCount;
+    }
+
+    COPYQ_LOG( QString("Tab \"%1\": %2 changes replayed from journal")
+               .arg(tabName).arg(recordCount) );
+
+    return true;
+}
+
+/**
+ * Appends changes from @a journal to journal file.
+ * @return false if all items need to be saved instead
+ */
+bool appendToJournal(const QString &tabName, const QString &tabFileName, const ItemJournal &journal)
+{
+    const TabFileId id = tabFileId(tabFileName);
+    if (id.size < 0)
+        return false;
+
+    QFile journalFile( journalFileName(tabFileName) );
+    const bool journalExists = journalFile.exists();
+
+    if (journalExists) {
+        const qint64 journalSize = journalFile.size() + journal.records().size();
+        if ( journalSize > qMax(id.size, minJournalSizeToCompact) ) {
+            COPYQ_LOG( QString("Tab \"%1\": Merging journal into tab file").arg(tabName) );
+            return false;
+        }
+
+        if ( !journalFile.open(QIODevice::ReadOnly) )
+            return false;
+
+        QDataStream stream(&journalFile);
+        initDataStream(&stream);
+        TabFileId journalId;
+        if ( !readJournalHeader(&stream, &journalId) || !(journalId == id) )
+            return false;
+
+        journalFile.close();
+    }
+
+    if ( journal.isEmpty() )
+        return true;
+
+    if ( !journalFile.open(QIODevice::WriteOnly | QIODevice::Append) ) {
+        printSaveItemFileError(tabName, journalFile.fileName(), journalFile);
+        return false;
+    }
+
+    if (!journalExists) {
+        QDataStream stream(&journalFile);
+        initDataStream(&stream);
+        writeJournalHeader(&stream, id);
+        if ( stream.status() != QDataStream::Ok )
+            return false;
+    }
+
+    if ( journalFile.write(journal.records()) != journal.records().size() || !journalFile.flush() ) {
+        printSaveItemFileError(tabName, journalFile.fileName(), journalFile);
+        return false;
+    }
+
+    return true;
+}
+
 ItemSaverPtr loadItems(
         const QString &tabName, const QString &tabFileName,
         QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems)
@@ -116,6 +533,81 @@ ItemSaverPtr createTab(
 
 } // namespace
 
+ItemJournal::ItemJournal(const QAbstractItemModel *model, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+{
+    connect( model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+             this, SLOT(onRowsInserted(QModelIndex,int,int)) );
+    connect( model, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+             this, SLOT(onRowsRemoved(QModelIndex,int,int)) );
+    connect( model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+             this, SLOT(onRowsMoved(QModelIndex,int,int,QModelIndex,int)) );
+    connect( model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+             this, SLOT(onDataChanged(QModelIndex,QModelIndex)) );
+    connect( model, SIGNAL(layoutChanged()),
+             this, SLOT(invalidate()) );
+    connect( model, SIGNAL(modelReset()),
+             this, SLOT(invalidate()) );
+}
+
+void ItemJournal::clear()
+{
+    m_records.clear();
+    m_valid = true;
+}
+
+void ItemJournal::onRowsInserted(const QModelIndex &, int start, int end)
+{
+    for (int row = start; row <= end; ++row) {
+        const QVariantMap data = m_model->index(row, 0).data(contentType::data).toMap();
+        appendRecord( journalRecord(JournalInsert, row, data) );
+    }
+}
+
+void ItemJournal::onRowsRemoved(const QModelIndex &, int start, int end)
+{
+    appendRecord( journalRecord(JournalRemove, start, end - start + 1, 0) );
+}
+
+void ItemJournal::onRowsMoved(const QModelIndex &, int start, int end, const QModelIndex &, int destinationRow)
+{
+#if QT_VERSION < 0x050000
+    if (start != end) {
+        invalidate();
+        return;
+    }
+#endif
+
+    appendRecord( journalRecord(JournalMove, start, end - start + 1, destinationRow) );
+}
+
+void ItemJournal::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QVariantMap data = m_model->index(row, 0).data(contentType::data).toMap();
+        appendRecord( journalRecord(JournalUpdate, row, data) );
+    }
+}
+
+void ItemJournal::invalidate()
+{
+    m_records.clear();
+    m_valid = false;
+}
+
+void ItemJournal::appendRecord(const QByteArray &record)
+{
+    if (!m_valid)
+        return;
+
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    initDataStream(&stream);
+    stream << record;
+    m_records.append(bytes);
+}
+
 ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems)
 {
     if ( !createItemDirectory() )
@@ -145,18 +637,40 @@ ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFa
         return nullptr;
     }
 
+    bool saveNeeded = !replayJournal(tabName, tabFileName, model, saver);
+
+    if ( model.rowCount() > maxItems ) {
+        model.removeRows( maxItems, model.rowCount() - maxItems );
+        saveNeeded = true;
+    }
+
+    if ( saveNeeded && !saveItems(tabName, model, saver) )
+        return nullptr;
+
     COPYQ_LOG( QString("Tab \"%1\": %2 items loaded").arg(tabName).arg(model.rowCount()) );
 
     return saver;
 }
 
-bool saveItems(const QString &tabName, const QAbstractItemModel &model, const ItemSaverPtr &saver)
+bool saveItems(const QString &tabName, const QAbstractItemModel &model, const ItemSaverPtr &saver, ItemJournal *journal)
 {
     const QString tabFileName = itemFileName(tabName);
 
     if ( !createItemDirectory() )
         return false;
 
+    // Don't keep plain text of items from encrypted and other special tabs.
+    if ( !saver->canJournalItems() )
+        QFile::remove( searchFileName(tabFileName) );
+
+    if ( journal && journal->isValid() && saver->canJournalItems()
+         && appendToJournal(tabName, tabFileName, *journal) )
+    {
+        COPYQ_LOG( QString("Tab \"%1\": Changes appended to journal").arg(tabName) );
+        journal->clear();
+        return true;
+    }
+
     // Save to temp file.
     QFile tmpFile( tabFileName + ".tmp" );
     if ( !tmpFile.open(QIODevice::WriteOnly) ) {
@@ -189,16 +703,189 @@ bool saveItems(const QString &tabName, const QAbstractItemModel &model, const It
         return false;
     }
 
+    // 4. Remove merged journal (if this fails, journal is ignored next time since tab file changed).
+    QFile::remove( journalFileName(tabFileName) );
+    if (journal)
+        journal->clear();
+
     COPYQ_LOG( QString("Tab \"%1\": Items saved").arg(tabName) );
 
     return true;
 }
 
+void saveItemSearchFile(
+        const QString &tabName, const QAbstractItemModel &model, const ItemSaverPtr &saver,
+        const ItemFactory &itemFactory)
+{
+    const QString tabFileName = itemFileName(tabName);
+    const QString fileName = searchFileName(tabFileName);
+
+    if ( !saver || !saver->canJournalItems() ) {
+        QFile::remove(fileName);
+        return;
+    }
+
+    const SavedItemsId id = savedItemsId(tabFileName);
+    if (id.tabFile.size < 0)
+        return;
+
+    // Skip if search file is up-to-date.
+    {
+        QFile file(fileName);
+        if ( file.open(QIODevice::ReadOnly) ) {
+            QDataStream stream(&file);
+            initDataStream(&stream);
+            SavedItemsId fileId;
+            if ( readSearchFileHeader(&stream, &fileId) && fileId == id )
+                return;
+        }
+    }
+
+    QFile tmpFile(fileName + ".tmp");
+    if ( !tmpFile.open(QIODevice::WriteOnly) ) {
+        printSaveItemFileError(tabName, tmpFile.fileName(), tmpFile);
+        return;
+    }
+
+    QDataStream stream(&tmpFile);
+    initDataStream(&stream);
+    stream << searchFileVersion << id.tabFile.size << id.tabFile.checksum << id.journalSize
+           << static_cast<qint32>( model.rowCount() );
+    for (int row = 0; row < model.rowCount(); ++row)
+        stream << itemFactory.filterData( model.index(row), false ).texts;
+
+    tmpFile.close();
+
+    if ( stream.status() != QDataStream::Ok || tmpFile.error() != QFile::NoError ) {
+        printSaveItemFileError(tabName, tmpFile.fileName(), tmpFile);
+        tmpFile.remove();
+        return;
+    }
+
+    QFile::remove(fileName);
+    if ( !tmpFile.rename(fileName) ) {
+        printSaveItemFileError(tabName, fileName, tmpFile);
+        return;
+    }
+
+    COPYQ_LOG( QString("Tab \"%1\": Search index saved").arg(tabName) );
+}
+
+void saveItemHeights(const QString &tabName, const ClipboardModel &model,
+                     const ItemHeightCache &heights, const ItemSaverPtr &saver)
+{
+    const QString fileName = heightFileName( itemFileName(tabName) );
+
+    if ( !saver || !saver->canJournalItems() ) {
+        QFile::remove(fileName);
+        return;
+    }
+
+    QSet<uint> itemHashes;
+    for (int row = 0; row < model.rowCount(); ++row)
+        itemHashes.insert( model.index(row).data(contentType::hash).toUInt() );
+
+    QFile tmpFile(fileName + ".tmp");
+    if ( !tmpFile.open(QIODevice::WriteOnly) ) {
+        printSaveItemFileError(tabName, tmpFile.fileName(), tmpFile);
+        return;
+    }
+
+    QDataStream stream(&tmpFile);
+    initDataStream(&stream);
+    heights.save(&stream, itemHashes);
+
+    tmpFile.close();
+
+    if ( stream.status() != QDataStream::Ok || tmpFile.error() != QFile::NoError ) {
+        printSaveItemFileError(tabName, tmpFile.fileName(), tmpFile);
+        tmpFile.remove();
+        return;
+    }
+
+    QFile::remove(fileName);
+    if ( !tmpFile.rename(fileName) )
+        printSaveItemFileError(tabName, fileName, tmpFile);
+}
+
+void loadItemHeights(const QString &tabName, ItemHeightCache *heights)
+{
+    QFile file( heightFileName(itemFileName(tabName)) );
+    if ( !file.open(QIODevice::ReadOnly) )
+        return;
+
+    QDataStream stream(&file);
+    initDataStream(&stream);
+    if ( !heights->load(&stream) )
+        COPYQ_LOG( QString("Tab \"%1\": Failed to load item heights").arg(tabName) );
+    else
+        COPYQ_LOG( QString("Tab \"%1\": Loaded heights of %2 items").arg(tabName).arg(heights->count()) );
+}
+
+bool searchSavedItems(const QString &tabName, const QRegExp &re, QList<int> *rows)
+{
+    // Formats of items are not saved.
+    if ( filterMatchesFormats(re) )
+        return false;
+
+    const auto search = savedItemSearch( itemFileName(tabName) );
+    if (!search)
+        return false;
+
+    // Match texts same way as in loaded tab (see ItemFactory::matches()).
+    const TextMatcher matcher(re);
+    ItemFilterData data;
+
+    QSet<uint> candidates;
+    if ( search->index.candidates(re, &candidates) ) {
+        QList<int> candidateRows;
+        candidateRows.reserve( candidates.size() );
+        for (const auto row : candidates)
+            candidateRows.append( static_cast<int>(row) );
+        std::sort( candidateRows.begin(), candidateRows.end() );
+
+        for (const auto row : candidateRows) {
+            data.texts = search->texts[row];
+            if ( filterMatches(data, matcher) )
+                rows->append(row);
+        }
+    } else {
+        for (int row = 0; row < search->texts.size(); ++row) {
+            data.texts = search->texts[row];
+            if ( filterMatches(data, matcher) )
+                rows->append(row);
+        }
+    }
+
+    return true;
+}
+
+void preloadItems(const QStringList &tabNames, int maxItems)
+{
+    QList< QPair<QString, QString> > tabFiles;
+    for (const auto &tabName : tabNames) {
+        const QString tabFileName = itemFileName(tabName);
+        if ( QFile::exists(tabFileName) )
+            tabFiles.append( qMakePair(tabName, tabFileName) );
+    }
+
+    preloadMappedItems(tabFiles, maxItems);
+}
+
+void dropUnusedPreloadedItems()
+{
+    dropPreloadedItems();
+}
+
 void removeItems(const QString &tabName)
 {
     const QString tabFileName = itemFileName(tabName);
+    dropPreloadedItems(tabFileName);
     QFile::remove(tabFileName);
     QFile::remove(tabFileName + ".tmp");
+    QFile::remove( journalFileName(tabFileName) );
+    QFile::remove( searchFileName(tabFileName) );
+    QFile::remove( heightFileName(tabFileName) );
 }
 
 void moveItems(const QString &oldId, const QString &newId)
@@ -206,8 +893,15 @@ void moveItems(const QString &oldId, const QString &newId)
     const QString oldFileName = itemFileName(oldId);
     const QString newFileName = itemFileName(newId);
 
+    dropPreloadedItems(oldFileName);
+    dropPreloadedItems(newFileName);
+
     if ( oldFileName != newFileName && QFile::copy(oldFileName, newFileName) ) {
         QFile::remove(oldFileName);
+
+        moveTabFile( journalFileName(oldFileName), journalFileName(newFileName) );
+        moveTabFile( searchFileName(oldFileName), searchFileName(newFileName) );
+        moveTabFile( heightFileName(oldFileName), heightFileName(newFileName) );
     } else {
         COPYQ_LOG( QString("Failed to move items from \"%1\" (tab \"%2\") to \"%3\" (tab \"%4\")")
                    .arg(oldFileName, oldId,
@@ -21,17 +21,113 @@
 
 #include "item/itemwidget.h"
 
+#include <QByteArray>
+#include <QObject>
+
+class ClipboardModel;
+class ItemHeightCache;
 class QAbstractItemModel;
 class ItemFactory;
+class QModelIndex;
+class QRegExp;
 class QString;
+class QStringList;
+
+/**
+ * Records changes in item model since items were last saved.
+ *
+ * If tab saver supports it (see ItemSaverInterface::canJournalItems()),
+ * only the changes are appended to journal file next to the tab file
+ * instead of saving all items. The journal is replayed when items are
+ * loaded and it's merged into tab file once it grows too big.
+ */
+class ItemJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ItemJournal(const QAbstractItemModel *model, QObject *parent = nullptr);
+
+    /// Returns false if some changes couldn't be recorded (all items need to be saved).
+    bool isValid() const { return m_valid; }
+
+    bool isEmpty() const { return m_records.isEmpty(); }
+
+    /// Returns serialized records of changes.
+    const QByteArray &records() const { return m_records; }
+
+    /// Forgets all recorded changes (call after items are saved or loaded).
+    void clear();
+
+private slots:
+    void onRowsInserted(const QModelIndex &parent, int start, int end);
+    void onRowsRemoved(const QModelIndex &parent, int start, int end);
+    void onRowsMoved(const QModelIndex &, int start, int end, const QModelIndex &, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void invalidate();
 
-/** Load items from configuration file. */
+private:
+    void appendRecord(const QByteArray &record);
+
+    const QAbstractItemModel *m_model;
+    QByteArray m_records;
+    bool m_valid = true;
+};
+
+/** Load items from configuration file and replay journal with unsaved changes. */
 ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model //!< Model for items.
         , ItemFactory *itemFactory, int maxItems);
 
-/** Save items to configuration file. */
+/**
+ * Save items to configuration file.
+ *
+ * If @a journal is valid and saver supports it, only recorded changes are
+ * appended to journal file.
+ */
 bool saveItems(const QString &tabName, const QAbstractItemModel &model //!< Model containing items to save.
-        , const ItemSaverPtr &saver);
+        , const ItemSaverPtr &saver, ItemJournal *journal = nullptr);
+
+/**
+ * Save searchable texts of items (see ItemFactory::filterData()) next to tab
+ * file so that the tab can be searched without loading it (see
+ * searchSavedItems()).
+ *
+ * Should be called after items are saved. Does nothing if the file is
+ * up-to-date with saved items. The file is removed for tabs which are not
+ * saved in default format (e.g. encrypted tabs).
+ */
+void saveItemSearchFile(
+        const QString &tabName, const QAbstractItemModel &model, const ItemSaverPtr &saver,
+        const ItemFactory &itemFactory);
+
+/**
+ * Save measured heights of items next to tab file so that size of items is
+ * known before they are rendered next time the tab is loaded.
+ *
+ * The file is removed for tabs which are not saved in default format.
+ */
+void saveItemHeights(const QString &tabName, const ClipboardModel &model,
+                     const ItemHeightCache &heights, const ItemSaverPtr &saver);
+
+/// Load heights of items saved with saveItemHeights().
+void loadItemHeights(const QString &tabName, ItemHeightCache *heights);
+
+/**
+ * Find rows of items matching @a re in tab which is not loaded.
+ *
+ * @return false if search file is missing or outdated (tab needs to be loaded)
+ */
+bool searchSavedItems(const QString &tabName, const QRegExp &re, QList<int> *rows);
+
+/**
+ * Start reading items of given tabs in parallel in background.
+ *
+ * Reading items later with loadItems() uses the read items.
+ */
+void preloadItems(const QStringList &tabNames, int maxItems);
+
+/** Free items read in background for tabs which were not opened. */
+void dropUnusedPreloadedItems();
 
 /** Remove configuration file for items. */
 void removeItems(const QString &tabName //!< See ClipboardBrowser::getID().
@@ -272,6 +272,16 @@ bool ItemSaverInterface::saveItems(const QString &, const QAbstractItemModel &,
     return false;
 }
 
+bool ItemSaverInterface::canJournalItems() const
+{
+    return false;
+}
+
+bool ItemSaverInterface::isEncrypted() const
+{
+    return false;
+}
+
 bool ItemSaverInterface::canRemoveItems(const QList<QModelIndex> &, QString *)
 {
     return true;
@@ -291,6 +301,11 @@ QVariantMap ItemSaverInterface::copyItem(const QAbstractItemModel &, const QVari
     return itemData;
 }
 
+int ItemSaverInterface::insertionRow(const QAbstractItemModel &, int row) const
+{
+    return row;
+}
+
 ItemWidget *ItemLoaderInterface::create(const QModelIndex &, QWidget *, bool) const
 {
     return nullptr;
@@ -326,9 +341,9 @@ ItemSaverPtr ItemLoaderInterface::transformSaver(const ItemSaverPtr &saver, QAbs
     return saver;
 }
 
-bool ItemLoaderInterface::matches(const QModelIndex &, const QRegExp &) const
+QString ItemLoaderInterface::searchableText(const QVariantMap &) const
 {
-    return false;
+    return QString();
 }
 
 QObject *ItemLoaderInterface::tests(const TestInterfacePtr &) const
@@ -26,6 +26,7 @@
 #include <QStringList>
 #include <QtPlugin>
 #include <QVariantMap>
+#include <QVector>
 
 #include <memory>
 
@@ -41,11 +42,12 @@ struct Command;
 
 class ItemLoaderInterface;
 using ItemLoaderPtr = std::shared_ptr<ItemLoaderInterface>;
+using ItemLoaderList = QVector<ItemLoaderPtr>;
 
 class ItemSaverInterface;
 using ItemSaverPtr = std::shared_ptr<ItemSaverInterface>;
 
-#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/1.0"
+#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/2.0"
 
 #if QT_VERSION < 0x050000
 #   define Q_PLUGIN_METADATA(x)
@@ -231,6 +233,21 @@ public:
      */
     virtual bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file);
 
+    /**
+     * Return true if saveItems() writes data in the default format.
+     *
+     * If true, changes in items can be appended to a journal file instead of
+     * saving all items. The journal is replayed after items are loaded.
+     */
+    virtual bool canJournalItems() const;
+
+    /**
+     * Return true if items are saved encrypted.
+     *
+     * Plugins must not keep data of such items unencrypted on disk (e.g. caches).
+     */
+    virtual bool isEncrypted() const;
+
     /**
      * Called before items are deleted by user.
      * @return true if items can be removed, false to cancel the removal
@@ -253,6 +270,14 @@ public:
      */
     virtual QVariantMap copyItem(const QAbstractItemModel &model, const QVariantMap &itemData);
 
+    /**
+     * Return row for new item which would be otherwise inserted at @a row.
+     *
+     * This allows to skip items that need to stay in place
+     * so they don't need to be moved after each insertion.
+     */
+    virtual int insertionRow(const QAbstractItemModel &model, int row) const;
+
     ItemSaverInterface(const ItemSaverInterface &) = delete;
     ItemSaverInterface &operator=(const ItemSaverInterface &) = delete;
 };
@@ -264,7 +289,7 @@ public:
  * - loads items from file (creates ItemSaverInterface instance),
  * - creates item widgets (creates ItemWidget instance),
  * - adds scripting capabilities (creates ItemScriptable instance),
- * - matches/filters items,
+ * - provides item texts for filtering (see searchableText()),
  * - provides commands for Command dialog,
  * - provides settings widget for Configuration dialog.
  */
@@ -380,10 +405,17 @@ public:
     virtual ItemSaverPtr transformSaver(const ItemSaverPtr &saver, QAbstractItemModel *model);
 
     /**
-     * Return true if regular expression matches items content.
-     * Returns false by default.
+     * Return item text to match with search expression.
+     *
+     * Item @a data contain all formats except big ones kept only in tab
+     * file (text is always included, see contentType::searchData).
+     *
+     * Called from other threads when filtering items so the implementation
+     * must not access models or widgets.
+     *
+     * Returns null string by default.
      */
-    virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
+    virtual QString searchableText(const QVariantMap &data) const;
 
     /**
      * Return object with tests.
@@ -0,0 +1,556 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mappeditemdata.h"
+
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+#include "item/clipboarditem.h"
+#include "item/clipboardmodel.h"
+#include "item/serialize.h"
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QCache>
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QModelIndex>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <limits>
+
+namespace {
+
+/// Bigger formats are kept only in tab file (item keeps only preview of big text).
+const int maxFormatSizeInMemory = 4096;
+
+/// Maximum size of decompressed data read from tab files kept in memory.
+const int maxCachedDataSize = 64 * 1024 * 1024;
+
+/// Marks end of item hash index in tab file (see saveMappedItems()).
+const quint32 itemHashIndexMagic = 0x43514849;
+
+QMutex cacheMutex;
+
+/**
+ * Items read from tab file in background.
+ */
+struct PreloadedItems {
+    QString tabName;
+    qint64 fileSize;
+    QDateTime lastModified;
+    int maxItems;
+
+    QMutex mutex;
+    QWaitCondition finishedCondition;
+    bool finished = false;
+    bool ok = false;
+    QList<ClipboardItem> items;
+};
+
+using PreloadedItemsPtr = std::shared_ptr<PreloadedItems>;
+
+/**
+ * Measures wall time of reading all tab files in background.
+ */
+struct PreloadBatch {
+    QElapsedTimer elapsed;
+    QAtomicInt remaining;
+};
+
+using PreloadBatchPtr = std::shared_ptr<PreloadBatch>;
+
+QMutex preloadMutex;
+
+/// Items read in background by tab file name.
+QHash<QString, PreloadedItemsPtr> &preloadedTabs()
+{
+    static QHash<QString, PreloadedItemsPtr> tabs;
+    return tabs;
+}
+
+/// Separate pool so reading tabs doesn't delay filtering items in global pool.
+QThreadPool *preloadThreadPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+
+class PreloadItemsTask : public QRunnable
+{
+public:
+    PreloadItemsTask(
+            const QString &tabFileName, const PreloadedItemsPtr &preloaded,
+            const PreloadBatchPtr &batch)
+        : m_tabFileName(tabFileName)
+        , m_preloaded(preloaded)
+        , m_batch(batch)
+    {
+    }
+
+    void run() override
+    {
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        QList<ClipboardItem> items;
+        const bool ok = readMappedItems(m_tabFileName, m_preloaded->maxItems, &items);
+
+        COPYQ_LOG( QString("Tab \"%1\": %2 items decoded in background in %3 ms")
+                   .arg(m_preloaded->tabName)
+                   .arg(ok ? items.size() : 0)
+                   .arg(elapsed.elapsed()) );
+
+        {
+            QMutexLocker lock(&m_preloaded->mutex);
+            m_preloaded->ok = ok;
+            m_preloaded->items = items;
+            m_preloaded->finished = true;
+            m_preloaded->finishedCondition.wakeAll();
+        }
+
+        if ( !m_batch->remaining.deref() ) {
+            COPYQ_LOG( QString("All tabs decoded in background in %1 ms")
+                       .arg(m_batch->elapsed.elapsed()) );
+        }
+    }
+
+private:
+    QString m_tabFileName;
+    PreloadedItemsPtr m_preloaded;
+    PreloadBatchPtr m_batch;
+};
+
+/**
+ * Takes items read in background.
+ * @return false if items were not preloaded or the tab file changed since
+ */
+bool takePreloadedItems(const QString &tabFileName, int maxItems, QList<ClipboardItem> *items)
+{
+    PreloadedItemsPtr preloaded;
+    {
+        QMutexLocker lock(&preloadMutex);
+        preloaded = preloadedTabs().take(tabFileName);
+    }
+
+    if (!preloaded)
+        return false;
+
+    QMutexLocker lock(&preloaded->mutex);
+    while (!preloaded->finished)
+        preloaded->finishedCondition.wait(&preloaded->mutex);
+
+    const QFileInfo info(tabFileName);
+    if ( !preloaded->ok
+         || preloaded->maxItems != maxItems
+         || preloaded->fileSize != info.size()
+         || preloaded->lastModified != info.lastModified() )
+    {
+        return false;
+    }
+
+    *items = preloaded->items;
+    return true;
+}
+
+/// Key for cached data is mapped file ID and offset of format data in the file.
+using DataCacheKey = QPair<quint64, qint64>;
+
+QCache<DataCacheKey, QByteArray> &dataCache()
+{
+    static QCache<DataCacheKey, QByteArray> cache(maxCachedDataSize);
+    return cache;
+}
+
+quint64 lastMappedFileId = 0;
+
+bool keepInMemory(const QString &format, quint32 size)
+{
+    return size <= static_cast<quint32>(maxFormatSizeInMemory)
+            || format.startsWith(COPYQ_MIME_PREFIX);
+}
+
+QByteArray readFormat(const uchar *data, const MappedFormat &format)
+{
+    return decompressData(
+                reinterpret_cast<const char*>(data + format.offset), format.size, format.codec );
+}
+
+/**
+ * Reads hashes of items stored after the last item in tab file.
+ *
+ * Tab files saved by older versions don't have the index.
+ *
+ * @return offset of the index in file or -1 if there is no index
+ */
+qint64 readItemHashIndex(const MappedTabFilePtr &file, qint32 itemCount, QVector<quint32> *itemHashes)
+{
+    const qint64 indexSize = 4 * static_cast<qint64>(itemCount) + 8;
+    const qint64 offset = file->size() - indexSize;
+    // Index follows item count and items.
+    if (offset < 4)
+        return -1;
+
+    const QByteArray bytes = QByteArray::fromRawData(
+                reinterpret_cast<const char*>(file->data() + offset), static_cast<int>(indexSize) );
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    QVector<quint32> hashes(itemCount);
+    for (auto &itemHash : hashes)
+        stream >> itemHash;
+
+    qint32 count;
+    quint32 magic;
+    stream >> count >> magic;
+    if ( stream.status() != QDataStream::Ok || count != itemCount || magic != itemHashIndexMagic )
+        return -1;
+
+    *itemHashes = hashes;
+    return offset;
+}
+
+/**
+ * Reads item and position of its formats in tab file.
+ *
+ * If @a itemHash is null, all item data are read to calculate the hash.
+ *
+ * @return false if the item is in older format or cannot be read
+ */
+bool readMappedItem(
+        QDataStream *stream, const MappedTabFilePtr &file, const quint32 *itemHash,
+        ClipboardItem *item)
+{
+    qint32 version;
+    *stream >> version;
+    if ( stream->status() != QDataStream::Ok || (version != -2 && version != -3) )
+        return false;
+
+    const bool hasItemHash = itemHash != nullptr;
+
+    qint32 formatCount;
+    *stream >> formatCount;
+
+    QVariantMap data;
+    QVariantMap dataToHash;
+    QMap<QString, MappedFormat> mappedFormats;
+
+    QString mime;
+    DataCodec codec;
+    quint32 size;
+    for (qint32 i = 0; i < formatCount; ++i) {
+        *stream >> mime;
+        if (version == -2) {
+            bool compressed;
+            *stream >> compressed;
+            codec = compressed ? DataCodec::Zlib : DataCodec::None;
+        } else {
+            quint8 codecId;
+            *stream >> codecId;
+            codec = static_cast<DataCodec>(codecId);
+            if ( !isDataCodecAvailable(codec) )
+                return false;
+        }
+        *stream >> size;
+        if ( stream->status() != QDataStream::Ok )
+            return false;
+
+        const bool compressed = codec != DataCodec::None;
+
+        // Null byte array.
+        if (size == 0xffffffff)
+            size = 0;
+
+        const qint64 offset = stream->device()->pos();
+        if ( size > static_cast<quint64>(file->size() - offset) )
+            return false;
+
+        mime = decompressMime(mime);
+        const MappedFormat format = {offset, static_cast<int>(size), codec};
+
+        if ( keepInMemory(mime, size) ) {
+            const QByteArray bytes = readFormat(file->data(), format);
+            if ( compressed && bytes.isEmpty() )
+                return false;
+            data.insert(mime, bytes);
+            if (!hasItemHash)
+                dataToHash.insert(mime, bytes);
+        } else {
+            mappedFormats.insert(mime, format);
+            if (!hasItemHash) {
+                // Uncompressed data are hashed without copying.
+                const QByteArray bytes = compressed
+                        ? readFormat(file->data(), format)
+                        : QByteArray::fromRawData(
+                              reinterpret_cast<const char*>(file->data() + offset), format.size );
+                if ( compressed && bytes.isEmpty() )
+                    return false;
+                dataToHash.insert(mime, bytes);
+            }
+        }
+
+        if ( stream->skipRawData(format.size) != format.size )
+            return false;
+    }
+
+    if ( stream->status() != QDataStream::Ok )
+        return false;
+
+    if ( mappedFormats.isEmpty() ) {
+        item->setData(data);
+    } else {
+        const auto mappedData = std::make_shared<MappedItemData>(file, mappedFormats);
+        item->setMappedData( data, mappedData, hasItemHash ? *itemHash : hash(dataToHash) );
+    }
+
+    return true;
+}
+
+} // namespace
+
+MappedTabFile::MappedTabFile(const QString &fileName)
+    : m_file(fileName)
+{
+    {
+        QMutexLocker lock(&cacheMutex);
+        m_id = ++lastMappedFileId;
+    }
+
+    if ( !m_file.open(QIODevice::ReadOnly) )
+        return;
+
+    m_size = m_file.size();
+    if (m_size > 0)
+        m_data = m_file.map(0, m_size);
+}
+
+MappedTabFile::~MappedTabFile()
+{
+    QMutexLocker lock(&cacheMutex);
+    auto &cache = dataCache();
+    for ( const auto &key : cache.keys() ) {
+        if (key.first == m_id)
+            cache.remove(key);
+    }
+}
+
+MappedItemData::MappedItemData(const MappedTabFilePtr &file, const QMap<QString, MappedFormat> &formats)
+    : m_file(file)
+    , m_formats(formats)
+{
+}
+
+QByteArray MappedItemData::data(const QString &format) const
+{
+    const auto it = m_formats.constFind(format);
+    if ( it == m_formats.constEnd() )
+        return QByteArray();
+
+    const MappedFormat &mappedFormat = it.value();
+    if (mappedFormat.codec == DataCodec::None)
+        return readFormat(m_file->data(), mappedFormat);
+
+    const DataCacheKey key(m_file->id(), mappedFormat.offset);
+    {
+        QMutexLocker lock(&cacheMutex);
+        const QByteArray *cachedData = dataCache().object(key);
+        if (cachedData)
+            return *cachedData;
+    }
+
+    const QByteArray bytes = readFormat(m_file->data(), mappedFormat);
+
+    QMutexLocker lock(&cacheMutex);
+    dataCache().insert( key, new QByteArray(bytes), qMax(1, bytes.size()) );
+    return bytes;
+}
+
+QVariantMap MappedItemData::data() const
+{
+    QVariantMap data;
+    for (auto it = m_formats.constBegin(); it != m_formats.constEnd(); ++it)
+        data.insert( it.key(), this->data(it.key()) );
+    return data;
+}
+
+CompressedDataMap MappedItemData::compressedData() const
+{
+    CompressedDataMap data;
+    for (auto it = m_formats.constBegin(); it != m_formats.constEnd(); ++it) {
+        const MappedFormat &format = it.value();
+        const auto bytes = QByteArray::fromRawData(
+                    reinterpret_cast<const char*>(m_file->data() + format.offset), format.size );
+        data.insert( it.key(), CompressedData{format.codec, bytes} );
+    }
+    return data;
+}
+
+bool loadMappedItems(ClipboardModel *model, const QString &tabFileName, int maxItems)
+{
+    const int rowCount = model->rowCount();
+
+    QList<ClipboardItem> items;
+    if ( takePreloadedItems(tabFileName, maxItems - rowCount, &items) ) {
+        COPYQ_LOG( QString("Using items decoded in background from %1").arg(tabFileName) );
+    } else if ( !readMappedItems(tabFileName, maxItems - rowCount, &items) ) {
+        return false;
+    }
+
+    for (const auto &item : items)
+        model->insertItem( item, model->rowCount() );
+
+    return true;
+}
+
+bool readMappedItems(const QString &tabFileName, int maxItems, QList<ClipboardItem> *items)
+{
+#ifdef Q_OS_WIN
+    // Tab file cannot be replaced while it's mapped.
+    Q_UNUSED(tabFileName);
+    Q_UNUSED(maxItems);
+    Q_UNUSED(items);
+    return false;
+#else
+    const auto file = std::make_shared<MappedTabFile>(tabFileName);
+    if ( !file->isMapped() || file->size() > std::numeric_limits<int>::max() )
+        return false;
+
+    const QByteArray bytes = QByteArray::fromRawData(
+                reinterpret_cast<const char*>(file->data()), static_cast<int>(file->size()) );
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    qint32 length;
+    stream >> length;
+    if ( stream.status() != QDataStream::Ok || length < 0 )
+        return false;
+
+    // Without index, big formats of items need to be read to calculate hashes.
+    QVector<quint32> itemHashes;
+    const qint64 itemHashIndexOffset = readItemHashIndex(file, length, &itemHashes);
+    const bool hasItemHashIndex = itemHashIndexOffset != -1;
+
+    // Limit the loaded number of items to model's maximum.
+    const qint32 itemCount = qMin(length, maxItems);
+
+    QList<ClipboardItem> newItems;
+    newItems.reserve(itemCount);
+
+    for (qint32 i = 0; i < itemCount; ++i) {
+        ClipboardItem item;
+        const quint32 *itemHash = hasItemHashIndex ? itemHashes.constData() + i : nullptr;
+        if ( !readMappedItem(&stream, file, itemHash, &item) )
+            return false;
+        newItems.append(item);
+    }
+
+    // Index must follow the last item.
+    if ( hasItemHashIndex && itemCount == length
+         && stream.device()->pos() != itemHashIndexOffset )
+    {
+        return false;
+    }
+
+    *items = newItems;
+    return true;
+#endif
+}
+
+bool saveMappedItems(const QAbstractItemModel &model, QIODevice *file, const DataCompressionPolicy &policy)
+{
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    const qint32 length = model.rowCount();
+    stream << length;
+
+    const auto clipboardModel = qobject_cast<const ClipboardModel*>(&model);
+
+    QVector<quint32> itemHashes;
+    itemHashes.reserve(length);
+
+    for (qint32 row = 0; row < length && stream.status() == QDataStream::Ok; ++row) {
+        const QModelIndex index = model.index(row, 0);
+        if (clipboardModel)
+            clipboardModel->serializeItem(row, &stream, policy);
+        else
+            serializeItem( &stream, index.data(contentType::data).toMap(), policy );
+        itemHashes.append( index.data(contentType::hash).toUInt() );
+    }
+
+    // Older versions stop reading after the last item and ignore the index.
+    for (const auto itemHash : itemHashes)
+        stream << itemHash;
+    stream << length << itemHashIndexMagic;
+
+    return stream.status() == QDataStream::Ok;
+}
+
+void preloadMappedItems(const QList< QPair<QString, QString> > &tabFiles, int maxItems)
+{
+    const auto batch = std::make_shared<PreloadBatch>();
+    batch->elapsed.start();
+    batch->remaining.fetchAndStoreOrdered( tabFiles.size() );
+
+    for (const auto &tabFile : tabFiles) {
+        const QString &tabFileName = tabFile.second;
+        const QFileInfo info(tabFileName);
+
+        const auto preloaded = std::make_shared<PreloadedItems>();
+        preloaded->tabName = tabFile.first;
+        preloaded->fileSize = info.size();
+        preloaded->lastModified = info.lastModified();
+        preloaded->maxItems = maxItems;
+
+        {
+            QMutexLocker lock(&preloadMutex);
+            preloadedTabs().insert(tabFileName, preloaded);
+        }
+
+        preloadThreadPool()->start( new PreloadItemsTask(tabFileName, preloaded, batch) );
+    }
+}
+
+void dropPreloadedItems(const QString &tabFileName)
+{
+    QMutexLocker lock(&preloadMutex);
+    preloadedTabs().remove(tabFileName);
+}
+
+void dropPreloadedItems()
+{
+    QMutexLocker lock(&preloadMutex);
+    if ( !preloadedTabs().isEmpty() ) {
+        COPYQ_LOG( QString("Dropping items decoded in background for %1 unopened tabs")
+                   .arg(preloadedTabs().size()) );
+        preloadedTabs().clear();
+    }
+}
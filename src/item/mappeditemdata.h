@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAPPEDITEMDATA_H
+#define MAPPEDITEMDATA_H
+
+#include "item/serialize.h"
+
+#include <QFile>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+#include <memory>
+
+class ClipboardItem;
+class ClipboardModel;
+class QAbstractItemModel;
+class QIODevice;
+
+/**
+ * Tab file mapped to memory.
+ */
+class MappedTabFile
+{
+public:
+    explicit MappedTabFile(const QString &fileName);
+
+    ~MappedTabFile();
+
+    bool isMapped() const { return m_data != nullptr; }
+
+    const uchar *data() const { return m_data; }
+
+    qint64 size() const { return m_size; }
+
+    /// Unique identifier (not reused by files mapped later).
+    quint64 id() const { return m_id; }
+
+    MappedTabFile(const MappedTabFile &) = delete;
+    MappedTabFile &operator=(const MappedTabFile &) = delete;
+
+private:
+    QFile m_file;
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    quint64 m_id;
+};
+
+using MappedTabFilePtr = std::shared_ptr<MappedTabFile>;
+
+/**
+ * Position of format data in mapped tab file.
+ */
+struct MappedFormat {
+    qint64 offset;
+    int size;
+    DataCodec codec;
+};
+
+/**
+ * Formats of an item which are kept only in mapped tab file.
+ *
+ * Data of a format are read from file only when the format is requested.
+ * Uncompressed data are left to the system to page in and out of memory.
+ * Decompressed data are kept in a cache shared by all items which has
+ * limited size so the least recently used data are dropped from memory.
+ */
+class MappedItemData
+{
+public:
+    MappedItemData(const MappedTabFilePtr &file, const QMap<QString, MappedFormat> &formats);
+
+    bool hasFormat(const QString &format) const { return m_formats.contains(format); }
+
+    QStringList formats() const { return m_formats.keys(); }
+
+    /// Returns data for a format.
+    QByteArray data(const QString &format) const;
+
+    /// Returns data for all formats.
+    QVariantMap data() const;
+
+    /**
+     * Returns data for all formats as stored in file (without decompressing).
+     *
+     * Returned byte arrays are valid only while this object exists.
+     */
+    CompressedDataMap compressedData() const;
+
+    MappedItemData(const MappedItemData &) = delete;
+    MappedItemData &operator=(const MappedItemData &) = delete;
+
+private:
+    MappedTabFilePtr m_file;
+    QMap<QString, MappedFormat> m_formats;
+};
+
+using MappedItemDataPtr = std::shared_ptr<const MappedItemData>;
+
+/**
+ * Loads items saved in default format (see saveMappedItems()) from tab file.
+ *
+ * Data of big formats are not loaded to memory, the file is mapped to memory
+ * instead and items read data only when needed.
+ *
+ * Tab files saved by older versions don't contain index of item hashes so
+ * big formats need to be read once to calculate them.
+ *
+ * @return false if file cannot be mapped or it's in an older format
+ *         (items should be loaded with deserializeData())
+ */
+bool loadMappedItems(ClipboardModel *model, const QString &tabFileName, int maxItems);
+
+/**
+ * Saves items in default format (see serializeItem()).
+ *
+ * Items are followed by index of item hashes which older versions ignore.
+ *
+ * Formats which items have only in mapped tab file are copied without
+ * decompressing them.
+ */
+bool saveMappedItems(const QAbstractItemModel &model, QIODevice *file, const DataCompressionPolicy &policy);
+
+/**
+ * Reads items from tab file without inserting them to a model.
+ *
+ * Can be called from any thread.
+ *
+ * @see loadMappedItems()
+ */
+bool readMappedItems(const QString &tabFileName, int maxItems, QList<ClipboardItem> *items);
+
+/**
+ * Starts reading items from multiple tab files in parallel in background.
+ *
+ * Items are later passed to model in loadMappedItems() (called from main
+ * thread) which waits for reading to finish if needed.
+ *
+ * @a tabFiles contains pairs of tab name and tab file name.
+ */
+void preloadMappedItems(const QList< QPair<QString, QString> > &tabFiles, int maxItems);
+
+/**
+ * Drops items read in background for given tab file (tab was removed or renamed).
+ *
+ * Reading which is still in progress finishes but the items are discarded.
+ */
+void dropPreloadedItems(const QString &tabFileName);
+
+/** Drops items read in background for all tabs not opened yet. */
+void dropPreloadedItems();
+
+#endif // MAPPEDITEMDATA_H
@@ -0,0 +1,441 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "painteditem.h"
+
+#include "common/contenttype.h"
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QBuffer>
+#include <QFont>
+#include <QImageReader>
+#include <QModelIndex>
+#include <QPainter>
+#include <QPalette>
+#include <QRegExp>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <qmath.h>
+
+namespace {
+
+// Limit number of characters and lines for performance reasons.
+const int maxTextLength = 100 * 1024;
+const int maxTextLines = 1000;
+
+const char mimeRichText[] = "text/richtext";
+
+const char *const imageFormats[] = {
+    "image/png",
+    "image/bmp",
+    "image/jpeg",
+    "image/gif"
+};
+
+/// Formats which don't change appearance of items.
+bool isPlainFormat(const QString &format)
+{
+    return !format.startsWith(COPYQ_MIME_PREFIX)
+            || format == mimeWindowTitle
+            || format == mimeOwner
+            || format == mimeClipboardMode
+            || format == mimeColor
+            || format == mimeOutputTab;
+}
+
+QString imageFormat(const QVariantMap &data)
+{
+    for (const auto format : imageFormats) {
+        if ( data.contains(format) )
+            return format;
+    }
+
+    return QString();
+}
+
+QString textToPaint(QString text, int maxLines)
+{
+    // Some applications insert \0 teminator at the end of text data.
+    if ( text.endsWith(QChar(0)) )
+        text.chop(1);
+
+    text = text.left(maxTextLength);
+
+    const int lines = maxLines > 0 ? qMin(maxLines, maxTextLines) : maxTextLines;
+    int lineEnd = -1;
+    for (int i = 0; i < lines; ++i) {
+        lineEnd = text.indexOf('\n', lineEnd + 1);
+        if (lineEnd == -1)
+            return text;
+    }
+
+    // Elided text is marked with ellipsis as in ItemText.
+    if (lines == maxLines)
+        return text.left(lineEnd) + QString::fromUtf8(" \xe2\x80\xa6");
+
+    return text.left(lineEnd);
+}
+
+/// Removes lines after @a maxLines same way as ItemText.
+void elideHtml(QTextDocument *document, int maxLines)
+{
+    if (maxLines <= 0)
+        return;
+
+    const QTextBlock block = document->findBlockByLineNumber(maxLines);
+    if ( !block.isValid() )
+        return;
+
+    QTextCursor tc(document);
+    tc.setPosition(block.position() - 1);
+    tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+    tc.removeSelectedText();
+    tc.insertHtml( " &nbsp;"
+                   "<span style='background:rgba(0,0,0,30);border-radius:4px'>"
+                   "&nbsp;&hellip;&nbsp;"
+                   "</span>");
+}
+
+QSize maxTextSize(QSize maxSize, const PaintedItemSettings &settings)
+{
+    if (settings.maxHeight > 0)
+        maxSize.setHeight( qMin(maxSize.height(), settings.maxHeight) );
+    return maxSize;
+}
+
+QSize maxImageSize(QSize maxSize, const PaintedItemSettings &settings)
+{
+    const QSize &limit = settings.maxImageSize;
+    return QSize(
+                limit.width() > 0 ? qMin(maxSize.width(), limit.width()) : maxSize.width(),
+                limit.height() > 0 ? qMin(maxSize.height(), limit.height()) : maxSize.height() );
+}
+
+QSize boundedSize(QSizeF size, QSize maxSize)
+{
+    return QSize(
+                qMin(maxSize.width(), qCeil(size.width())),
+                qMin(maxSize.height(), qCeil(size.height())) );
+}
+
+QSize layoutText(QTextLayout *layout, QSize maxSize, bool textWrap)
+{
+    QTextOption option;
+    option.setWrapMode(textWrap ? QTextOption::WrapAtWordBoundaryOrAnywhere : QTextOption::NoWrap);
+    layout->setTextOption(option);
+
+    qreal height = 0;
+    qreal width = 0;
+    layout->beginLayout();
+    while ( height < maxSize.height() ) {
+        QTextLine line = layout->createLine();
+        if ( !line.isValid() )
+            break;
+
+        line.setLineWidth( maxSize.width() );
+        line.setPosition( QPointF(0, height) );
+        height += line.height();
+        width = qMax( width, line.naturalTextWidth() );
+    }
+    layout->endLayout();
+
+    return boundedSize( QSizeF(width, height), maxSize );
+}
+
+QSize layoutHtml(QTextDocument *document, const QString &html, const QFont &font, QSize maxSize, int maxLines)
+{
+    document->setDefaultFont(font);
+    document->setDocumentMargin(0);
+    document->setHtml( html.left(maxTextLength) );
+    elideHtml(document, maxLines);
+    document->setTextWidth( maxSize.width() );
+
+    return boundedSize( QSizeF(document->idealWidth(), document->size().height()), maxSize );
+}
+
+QSize scaledImageSize(QSize size, QSize maxSize)
+{
+    if ( size.width() > maxSize.width() || size.height() > maxSize.height() )
+        return size.scaled(maxSize, Qt::KeepAspectRatio);
+    return size;
+}
+
+} // namespace
+
+bool PaintedItem::canPaint(const QModelIndex &index, const PaintedItemSettings &settings)
+{
+    if ( index.data(contentType::isHidden).toBool() )
+        return false;
+
+    return canPaint( index.data(contentType::formats).toStringList(), settings );
+}
+
+bool PaintedItem::canPaint(const QStringList &formats, const PaintedItemSettings &settings)
+{
+    for (const auto &format : formats) {
+        if ( !isPlainFormat(format) || format == mimeRichText )
+            return false;
+    }
+
+    // Items with both image and text can be rendered differently by plugins.
+    const bool hasText = formats.contains(mimeText) || formats.contains(mimeHtml);
+    const bool hasImage = !paintedImageFormat(formats).isEmpty();
+    if (hasText == hasImage)
+        return false;
+
+    if (hasImage)
+        return settings.paintImages;
+
+    // Without rich text, only plain text is shown.
+    return settings.paintText && (settings.useRichText || formats.contains(mimeText));
+}
+
+QString PaintedItem::paintedImageFormat(const QStringList &formats)
+{
+    for (const auto format : imageFormats) {
+        if ( formats.contains(format) )
+            return format;
+    }
+
+    return QString();
+}
+
+QSize PaintedItem::textSizeHint(
+        const QString &text, bool isHtml, const QFont &font, QSize maxSize, bool textWrap,
+        const PaintedItemSettings &settings)
+{
+    if (isHtml) {
+        QTextDocument document;
+        return layoutHtml( &document, text, font, maxTextSize(maxSize, settings), settings.maxLines );
+    }
+
+    QTextLayout layout( textToPaint(text, settings.maxLines), font );
+    return layoutText( &layout, maxTextSize(maxSize, settings), textWrap );
+}
+
+QSize PaintedItem::imageSizeHint(const QByteArray &image, QSize maxSize, const PaintedItemSettings &settings)
+{
+    QByteArray bytes = image;
+    QBuffer buffer(&bytes);
+    QImageReader reader(&buffer);
+    return scaledImageSize( reader.size(), maxImageSize(maxSize, settings) );
+}
+
+PaintedItem::PaintedItem(
+        const QModelIndex &index, const QFont &font, QSize maxSize, bool textWrap,
+        const PaintedItemSettings &settings)
+    : m_itemHash( index.data(contentType::hash).toUInt() )
+    , m_maxSize(maxSize)
+    , m_settings(settings)
+{
+    const QVariantMap data = index.data(contentType::data).toMap();
+
+    const QString format = imageFormat(data);
+    if ( !format.isEmpty() ) {
+        // Read only image header here, image is decoded later.
+        m_imageData = data.value(format).toByteArray();
+        QBuffer buffer(&m_imageData);
+        QImageReader reader(&buffer);
+        m_imageSize = reader.size();
+        m_size = m_imageSize.isValid() ? scaledImageSize(m_imageSize, imageMaxSize()) : QSize(0, 0);
+    } else if ( settings.useRichText && data.contains(mimeHtml) ) {
+        m_document.reset( new QTextDocument() );
+        m_size = layoutHtml( m_document.get(), getTextData(data, mimeHtml), font,
+                             maxTextSize(maxSize, settings), settings.maxLines );
+    } else {
+        m_text = textToPaint( getTextData(data), settings.maxLines );
+        m_textLayout.reset( new QTextLayout(m_text, font) );
+        m_textLayout->setCacheEnabled(true);
+        m_size = layoutText( m_textLayout.get(), maxTextSize(maxSize, settings), textWrap );
+    }
+}
+
+PaintedItem::~PaintedItem() = default;
+
+void PaintedItem::setMaxSize(QSize maxSize, bool textWrap)
+{
+    m_maxSize = maxSize;
+
+    if (m_textLayout) {
+        m_size = layoutText( m_textLayout.get(), maxTextSize(maxSize, m_settings), textWrap );
+    } else if (m_document) {
+        m_document->setTextWidth( maxSize.width() );
+        m_size = boundedSize( QSizeF(m_document->idealWidth(), m_document->size().height()),
+                              maxTextSize(maxSize, m_settings) );
+    } else if ( m_imageSize.isValid() ) {
+        const QSize size = scaledImageSize( m_imageSize, imageMaxSize() );
+        if (size != m_size) {
+            m_size = size;
+            m_pixmapValid = false;
+        }
+    }
+}
+
+bool PaintedItem::needsPixmap() const
+{
+    return !m_imageData.isEmpty() && !m_pixmapValid;
+}
+
+QSize PaintedItem::imageMaxSize() const
+{
+    return maxImageSize(m_maxSize, m_settings);
+}
+
+QString PaintedItem::imageKey() const
+{
+    // If image size is unknown, image is scaled to fit maximum size.
+    const QSize size = m_imageSize.isValid() ? m_size : imageMaxSize();
+    return QString("CopyQ_painted_%1_%2x%3")
+            .arg(m_itemHash)
+            .arg(size.width())
+            .arg(size.height());
+}
+
+void PaintedItem::setPixmap(const QPixmap &pixmap)
+{
+    m_pixmap = pixmap;
+    m_pixmapValid = true;
+
+    if ( !m_imageSize.isValid() && !pixmap.isNull() ) {
+        m_imageSize = pixmap.size();
+        m_size = pixmap.size();
+    }
+}
+
+void PaintedItem::paint(
+        QPainter *painter, const QPoint &position, const QPalette &palette, bool isSelected,
+        const QRegExp &re, const QPalette &searchPalette) const
+{
+    const QPalette::ColorRole textRole = isSelected ? QPalette::HighlightedText : QPalette::Text;
+
+    if (m_textLayout) {
+        painter->save();
+        painter->setPen( palette.color(textRole) );
+        painter->setClipRect( QRect(position, m_size) );
+        m_textLayout->draw( painter, position, highlightedRanges(re, searchPalette) );
+        painter->restore();
+    } else if (m_document) {
+        QAbstractTextDocumentLayout::PaintContext context;
+        context.palette = palette;
+        context.palette.setColor( QPalette::Text, palette.color(textRole) );
+        context.clip = QRectF( QPointF(0, 0), QSizeF(m_size) );
+        context.selections = highlightedSelections(re, searchPalette);
+
+        painter->save();
+        painter->translate(position);
+        painter->setClipRect(context.clip);
+        m_document->documentLayout()->draw(painter, context);
+        painter->restore();
+    } else if ( !m_pixmap.isNull() ) {
+        // Pixmap for previous size is scaled until new one is decoded.
+        painter->drawPixmap( QRect(position, m_size), m_pixmap );
+    }
+}
+
+bool PaintedItem::updateHighlight(const QRegExp &re, const QPalette &searchPalette) const
+{
+    const QColor base = searchPalette.base().color();
+    const QColor text = searchPalette.text().color();
+    if ( re == m_highlightRe && base == m_highlightBase && text == m_highlightText )
+        return false;
+
+    m_highlightRe = re;
+    m_highlightBase = base;
+    m_highlightText = text;
+    m_highlightRanges.clear();
+    m_highlightSelections.clear();
+    return true;
+}
+
+const QVector<QTextLayout::FormatRange> &PaintedItem::highlightedRanges(
+        const QRegExp &re, const QPalette &searchPalette) const
+{
+    if ( !updateHighlight(re, searchPalette) || re.isEmpty() )
+        return m_highlightRanges;
+
+    for ( int i = re.indexIn(m_text); i != -1 && re.matchedLength() > 0;
+          i = re.indexIn(m_text, i + re.matchedLength()) )
+    {
+        QTextLayout::FormatRange range;
+        range.start = i;
+        range.length = re.matchedLength();
+        range.format.setBackground(m_highlightBase);
+        range.format.setForeground(m_highlightText);
+        m_highlightRanges.append(range);
+    }
+
+    return m_highlightRanges;
+}
+
+const QVector<QAbstractTextDocumentLayout::Selection> &PaintedItem::highlightedSelections(
+        const QRegExp &re, const QPalette &searchPalette) const
+{
+    if ( !updateHighlight(re, searchPalette) || re.isEmpty() )
+        return m_highlightSelections;
+
+    QAbstractTextDocumentLayout::Selection selection;
+    selection.format.setBackground(m_highlightBase);
+    selection.format.setForeground(m_highlightText);
+
+    QTextCursor cursor = m_document->find(re);
+    while ( !cursor.isNull() ) {
+        if ( cursor.hasSelection() ) {
+            selection.cursor = cursor;
+            m_highlightSelections.append(selection);
+        } else if ( !cursor.movePosition(QTextCursor::NextCharacter) ) {
+            break;
+        }
+        cursor = m_document->find(re, cursor);
+    }
+
+    return m_highlightSelections;
+}
+
+PaintedImageTask::PaintedImageTask(const QString &imageKey, const QByteArray &imageData, QSize maxSize)
+    : m_imageKey(imageKey)
+    , m_imageData(imageData)
+    , m_maxSize(maxSize)
+{
+    setAutoDelete(false);
+}
+
+void PaintedImageTask::run()
+{
+    QBuffer buffer(&m_imageData);
+    QImageReader reader(&buffer);
+
+    // Decode directly to smaller size if possible.
+    const QSize imageSize = reader.size();
+    if ( imageSize.isValid() )
+        reader.setScaledSize( scaledImageSize(imageSize, m_maxSize) );
+
+    QImage image = reader.read();
+    if ( !imageSize.isValid() && !image.isNull() ) {
+        const QSize size = scaledImageSize(image.size(), m_maxSize);
+        if ( size != image.size() )
+            image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    emit imageDecoded(m_imageKey, image);
+    emit finished();
+}
@@ -0,0 +1,193 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PAINTEDITEM_H
+#define PAINTEDITEM_H
+
+#include <QAbstractTextDocumentLayout>
+#include <QByteArray>
+#include <QColor>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QRegExp>
+#include <QRunnable>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QTextLayout>
+#include <QVector>
+
+#include <memory>
+
+class QFont;
+class QModelIndex;
+class QPainter;
+class QPalette;
+class QPoint;
+class QTextDocument;
+
+/**
+ * Options of item plugins which painted items follow to look same as widgets.
+ *
+ * Options for text are from "itemtext" plugin and for images from "itemimage"
+ * plugin; if a plugin is disabled, items it would render are not painted.
+ */
+struct PaintedItemSettings {
+    bool paintText = true;
+    bool useRichText = true;
+    /// Maximum number of lines (0 for no limit).
+    int maxLines = 0;
+    /// Maximum height of text (0 for no limit).
+    int maxHeight = 0;
+
+    bool paintImages = true;
+    /// Maximum image size (0 for no limit in a dimension).
+    QSize maxImageSize = QSize(320, 240);
+};
+
+/**
+ * Item laid out and painted directly by ItemDelegate without creating widget.
+ *
+ * Only plain text, HTML and image items without any special formats
+ * (notes, tags etc.) can be painted (see canPaint()), other items need
+ * widgets created by plugins.
+ *
+ * Images are not decoded in constructor. Item only reads image size and
+ * the pixmap needs to be decoded with PaintedImageTask and set with
+ * setPixmap() (see needsPixmap() and imageKey()).
+ */
+class PaintedItem
+{
+public:
+    /// Returns true if item can be painted without widget.
+    static bool canPaint(const QModelIndex &index, const PaintedItemSettings &settings);
+    static bool canPaint(const QStringList &formats, const PaintedItemSettings &settings);
+
+    /// Returns image format which is painted or empty string for text items.
+    static QString paintedImageFormat(const QStringList &formats);
+
+    /**
+     * Returns size of painted text or HTML without creating item.
+     *
+     * Can be called from any thread.
+     */
+    static QSize textSizeHint(
+            const QString &text, bool isHtml, const QFont &font, QSize maxSize, bool textWrap,
+            const PaintedItemSettings &settings);
+
+    /**
+     * Returns size of painted image without decoding it.
+     *
+     * Can be called from any thread.
+     */
+    static QSize imageSizeHint(const QByteArray &image, QSize maxSize, const PaintedItemSettings &settings);
+
+    PaintedItem(const QModelIndex &index, const QFont &font, QSize maxSize, bool textWrap,
+                const PaintedItemSettings &settings);
+
+    ~PaintedItem();
+
+    /// Size of item contents.
+    QSize size() const { return m_size; }
+
+    /**
+     * Lays out item again for different maximum size.
+     *
+     * Text is not parsed again and pixmap is kept (and scaled when painted)
+     * until new one is set.
+     */
+    void setMaxSize(QSize maxSize, bool textWrap);
+
+    /// Returns true if item is image which was not decoded for current size yet.
+    bool needsPixmap() const;
+
+    /// Key for decoded image in QPixmapCache (unique for item and size).
+    QString imageKey() const;
+
+    /// Encoded image data (to decode with PaintedImageTask).
+    const QByteArray &imageData() const { return m_imageData; }
+
+    /// Maximum size of decoded image (to decode with PaintedImageTask).
+    QSize imageMaxSize() const;
+
+    void setPixmap(const QPixmap &pixmap);
+
+    /// Paints item at @a position highlighting matches of @a re.
+    void paint(QPainter *painter, const QPoint &position, const QPalette &palette, bool isSelected,
+               const QRegExp &re, const QPalette &searchPalette) const;
+
+private:
+    bool updateHighlight(const QRegExp &re, const QPalette &searchPalette) const;
+
+    const QVector<QTextLayout::FormatRange> &highlightedRanges(
+            const QRegExp &re, const QPalette &searchPalette) const;
+
+    const QVector<QAbstractTextDocumentLayout::Selection> &highlightedSelections(
+            const QRegExp &re, const QPalette &searchPalette) const;
+
+    QString m_text;
+    std::unique_ptr<QTextLayout> m_textLayout;
+    std::unique_ptr<QTextDocument> m_document;
+    QPixmap m_pixmap;
+    QSize m_size;
+
+    uint m_itemHash = 0;
+    QSize m_maxSize;
+    PaintedItemSettings m_settings;
+    QByteArray m_imageData;
+    QSize m_imageSize;
+    bool m_pixmapValid = false;
+
+    // Highlighted matches from last paint() (search changes less often than items are painted).
+    mutable QRegExp m_highlightRe;
+    mutable QColor m_highlightBase;
+    mutable QColor m_highlightText;
+    mutable QVector<QTextLayout::FormatRange> m_highlightRanges;
+    mutable QVector<QAbstractTextDocumentLayout::Selection> m_highlightSelections;
+};
+
+/**
+ * Decodes and scales image for PaintedItem (in a thread pool).
+ *
+ * Object should be deleted only after finished() signal is emitted.
+ */
+class PaintedImageTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    PaintedImageTask(const QString &imageKey, const QByteArray &imageData, QSize maxSize);
+
+    void run() override;
+
+signals:
+    /// Reports decoded image (null if decoding failed).
+    void imageDecoded(const QString &imageKey, const QImage &image);
+
+    /// Emitted when done.
+    void finished();
+
+private:
+    QString m_imageKey;
+    QByteArray m_imageData;
+    QSize m_maxSize;
+};
+
+#endif // PAINTEDITEM_H
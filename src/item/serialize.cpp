@@ -33,9 +33,20 @@
 #include <QStringList>
 
 #include <cstring>
+#include <limits>
+
+#ifdef HAS_ZSTD
+#   include <zstd.h>
+#endif
 
 namespace {
 
+/// Fast compression level (zstd level 3 is default).
+const int zstdCompressionLevel = 1;
+
+/// Data smaller than this are never compressed.
+const int minCompressSize = 256;
+
 template <typename Fn>
 bool mimeIdApply(Fn fn)
 {
@@ -55,29 +66,6 @@ bool mimeIdApply(Fn fn)
         || fn(11, "video/");
 }
 
-QString decompressMime(const QString &mime)
-{
-    bool ok;
-    const int id = mime.mid(0, 1).toInt(&ok, 16);
-    Q_ASSERT(ok);
-
-    QString decompressedMimePrefix;
-    const bool found = mimeIdApply(
-        [id, &decompressedMimePrefix](int mimeId, const char *mimePrefix) {
-            if (id == mimeId) {
-                decompressedMimePrefix = mimePrefix;
-                return true;
-            }
-            return false;
-        });
-
-    if (found)
-        return decompressedMimePrefix + mime.mid(1);
-
-    Q_ASSERT( mime.startsWith("0") );
-    return mime.mid(1);
-}
-
 QString compressMime(const QString &mime)
 {
     QString compressedMime;
@@ -99,10 +87,63 @@ QString compressMime(const QString &mime)
 
 bool shouldCompress(const QByteArray &bytes, const QString &mime)
 {
-    return bytes.size() > 256
+    return bytes.size() > minCompressSize
             && ( !mime.startsWith("image/") || mime.contains("bmp") || mime.contains("xml") || mime.contains("svg") );
 }
 
+/// Returns compressed data or null byte array on error.
+QByteArray compressData(const QByteArray &bytes, DataCodec codec)
+{
+    switch (codec) {
+    case DataCodec::None:
+        return bytes;
+
+    case DataCodec::Zlib:
+        return qCompress(bytes);
+
+    case DataCodec::Zstd:
+#ifdef HAS_ZSTD
+    {
+        QByteArray compressed;
+        compressed.resize( static_cast<int>(ZSTD_compressBound(bytes.size())) );
+        const size_t size = ZSTD_compress(
+                    compressed.data(), compressed.size(),
+                    bytes.constData(), bytes.size(), zstdCompressionLevel);
+        if ( ZSTD_isError(size) ) {
+            log( QString("Failed to compress data: %1").arg(ZSTD_getErrorName(size)), LogError );
+            return QByteArray();
+        }
+        compressed.resize( static_cast<int>(size) );
+        return compressed;
+    }
+#else
+        break;
+#endif
+    }
+
+    return QByteArray();
+}
+
+bool readFormatData(QDataStream *out, DataCodec codec, QByteArray *bytes)
+{
+    if (codec == DataCodec::None)
+        return true;
+
+    if ( !isDataCodecAvailable(codec) ) {
+        log( QString("Unsupported compression codec %1").arg(static_cast<int>(codec)), LogError );
+        out->setStatus(QDataStream::ReadCorruptData);
+        return false;
+    }
+
+    *bytes = decompressData(bytes->constData(), bytes->size(), codec);
+    if ( bytes->isEmpty() ) {
+        out->setStatus(QDataStream::ReadCorruptData);
+        return false;
+    }
+
+    return true;
+}
+
 bool deserializeDataV2(QDataStream *out, QVariantMap *data)
 {
     qint32 size;
@@ -127,8 +168,250 @@ bool deserializeDataV2(QDataStream *out, QVariantMap *data)
     return out->status() == QDataStream::Ok;
 }
 
+bool deserializeDataV3(QDataStream *out, QVariantMap *data)
+{
+    qint32 size;
+    *out >> size;
+
+    QString mime;
+    QByteArray tmpBytes;
+    quint8 codec;
+    for (qint32 i = 0; i < size && out->status() == QDataStream::Ok; ++i) {
+        *out >> mime >> codec >> tmpBytes;
+        if ( out->status() != QDataStream::Ok )
+            break;
+
+        if ( !readFormatData(out, static_cast<DataCodec>(codec), &tmpBytes) )
+            break;
+
+        mime = decompressMime(mime);
+        data->insert(mime, tmpBytes);
+    }
+
+    return out->status() == QDataStream::Ok;
+}
+
+bool skipBytes(QDataStream *stream)
+{
+    quint32 size;
+    *stream >> size;
+
+    // Null byte array.
+    if (size == 0xffffffff)
+        return stream->status() == QDataStream::Ok;
+
+    if ( stream->skipRawData(static_cast<int>(size)) != static_cast<int>(size) )
+        stream->setStatus(QDataStream::ReadPastEnd);
+
+    return stream->status() == QDataStream::Ok;
+}
+
+/// Skips serialized item data without decompressing.
+bool skipSerializedData(QDataStream *stream)
+{
+    qint32 length;
+    *stream >> length;
+
+    if (length == -2 || length == -3) {
+        qint32 size;
+        *stream >> size;
+
+        QString mime;
+        bool compress;
+        quint8 codec;
+        for (qint32 i = 0; i < size && stream->status() == QDataStream::Ok; ++i) {
+            *stream >> mime;
+            if (length == -2)
+                *stream >> compress;
+            else
+                *stream >> codec;
+            skipBytes(stream);
+        }
+    } else if (length < 0) {
+        stream->setStatus(QDataStream::ReadCorruptData);
+    } else {
+        QString mime;
+        for (qint32 i = 0; i < length && stream->status() == QDataStream::Ok; ++i) {
+            *stream >> mime;
+            skipBytes(stream);
+        }
+    }
+
+    return stream->status() == QDataStream::Ok;
+}
+
 } // namespace
 
+QString decompressMime(const QString &mime)
+{
+    bool ok;
+    const int id = mime.mid(0, 1).toInt(&ok, 16);
+    Q_ASSERT(ok);
+
+    QString decompressedMimePrefix;
+    const bool found = mimeIdApply(
+        [id, &decompressedMimePrefix](int mimeId, const char *mimePrefix) {
+            if (id == mimeId) {
+                decompressedMimePrefix = mimePrefix;
+                return true;
+            }
+            return false;
+        });
+
+    if (found)
+        return decompressedMimePrefix + mime.mid(1);
+
+    Q_ASSERT( mime.startsWith("0") );
+    return mime.mid(1);
+}
+
+bool isDataCodecAvailable(DataCodec codec)
+{
+    switch (codec) {
+    case DataCodec::None:
+    case DataCodec::Zlib:
+        return true;
+    case DataCodec::Zstd:
+#ifdef HAS_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+QByteArray decompressData(const char *data, int size, DataCodec codec)
+{
+    switch (codec) {
+    case DataCodec::None:
+        return QByteArray(data, size);
+
+    case DataCodec::Zlib:
+        return qUncompress(reinterpret_cast<const uchar*>(data), size);
+
+    case DataCodec::Zstd:
+#ifdef HAS_ZSTD
+    {
+        const auto contentSize = ZSTD_getFrameContentSize(data, static_cast<size_t>(size));
+        if ( contentSize == ZSTD_CONTENTSIZE_ERROR
+             || contentSize == ZSTD_CONTENTSIZE_UNKNOWN
+             || contentSize > static_cast<quint64>(std::numeric_limits<int>::max()) )
+        {
+            return QByteArray();
+        }
+
+        QByteArray bytes;
+        bytes.resize( static_cast<int>(contentSize) );
+        const size_t decompressedSize = ZSTD_decompress(
+                    bytes.data(), bytes.size(), data, static_cast<size_t>(size));
+        if ( ZSTD_isError(decompressedSize) || decompressedSize != contentSize )
+            return QByteArray();
+
+        return bytes;
+    }
+#else
+        break;
+#endif
+    }
+
+    return QByteArray();
+}
+
+DataCompressionPolicy DataCompressionPolicy::fromString(const QString &policy)
+{
+    DataCompressionPolicy newPolicy;
+
+    for ( const auto &ruleText : policy.split(',', QString::SkipEmptyParts) ) {
+        const int i = ruleText.indexOf('=');
+        const QString codecName = ruleText.mid(i + 1).trimmed().toLower();
+
+        DataCodec codec;
+        if (codecName == "none") {
+            codec = DataCodec::None;
+        } else if (codecName == "zlib") {
+            codec = DataCodec::Zlib;
+        } else if (codecName == "zstd") {
+            codec = DataCodec::Zstd;
+            if ( !isDataCodecAvailable(codec) ) {
+                log( QString("Compression codec \"%1\" is unavailable, using \"zlib\"").arg(codecName), LogWarning );
+                codec = DataCodec::Zlib;
+            }
+        } else {
+            log( QString("Unknown compression codec \"%1\"").arg(codecName), LogWarning );
+            continue;
+        }
+
+        if (i == -1)
+            newPolicy.m_defaultCodec = codec;
+        else
+            newPolicy.m_rules.append({ruleText.left(i).trimmed(), codec});
+    }
+
+    return newPolicy;
+}
+
+DataCodec DataCompressionPolicy::codecForFormat(const QByteArray &bytes, const QString &mime) const
+{
+    if (bytes.size() <= minCompressSize)
+        return DataCodec::None;
+
+    const Rule *bestRule = nullptr;
+    for (const auto &rule : m_rules) {
+        if ( mime.startsWith(rule.mimePrefix)
+             && (!bestRule || bestRule->mimePrefix.size() < rule.mimePrefix.size()) )
+        {
+            bestRule = &rule;
+        }
+    }
+
+    if (bestRule)
+        return bestRule->codec;
+
+    return shouldCompress(bytes, mime) ? m_defaultCodec : DataCodec::None;
+}
+
+void serializeItem(
+        QDataStream *stream, const QVariantMap &data,
+        const DataCompressionPolicy &policy,
+        const CompressedDataMap &compressedData)
+{
+    CompressedDataMap formats = compressedData;
+
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const QByteArray bytes = it.value().toByteArray();
+
+        auto codec = policy.codecForFormat( bytes, it.key() );
+        QByteArray compressedBytes = compressData(bytes, codec);
+        if ( compressedBytes.isNull() ) {
+            codec = DataCodec::None;
+            compressedBytes = bytes;
+        }
+
+        formats.insert( it.key(), CompressedData{codec, compressedBytes} );
+    }
+
+    // Use older format if possible so data can be read by older versions.
+    bool useV2 = true;
+    for (const auto &format : formats)
+        useV2 = useV2 && (format.codec == DataCodec::None || format.codec == DataCodec::Zlib);
+
+    *stream << static_cast<qint32>(useV2 ? -2 : -3);
+
+    const qint32 size = formats.size();
+    *stream << size;
+
+    for (auto it = formats.constBegin(); it != formats.constEnd(); ++it) {
+        *stream << compressMime(it.key());
+        if (useV2)
+            *stream << (it.value().codec == DataCodec::Zlib);
+        else
+            *stream << static_cast<quint8>(it.value().codec);
+        *stream << it.value().bytes;
+    }
+}
+
 void serializeData(QDataStream *stream, const QVariantMap &data)
 {
     *stream << static_cast<qint32>(-2);
@@ -139,7 +422,7 @@ void serializeData(QDataStream *stream, const QVariantMap &data)
     QByteArray bytes;
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &mime = it.key();
-        bytes = data[mime].toByteArray();
+        bytes = it.value().toByteArray();
         bool compress = shouldCompress(bytes, mime);
         *stream << compressMime(mime) << compress << ( compress ? qCompress(bytes) : bytes );
     }
@@ -159,6 +442,11 @@ void deserializeData(QDataStream *stream, QVariantMap *data)
             return;
         }
 
+        if (length == -3) {
+            deserializeDataV3(stream, data);
+            return;
+        }
+
         if (length < 0) {
             stream->setStatus(QDataStream::ReadCorruptData);
             return;
@@ -239,6 +527,38 @@ bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItem
     return stream->status() == QDataStream::Ok;
 }
 
+bool appendDeserializedData(QAbstractItemModel *model, QDataStream *stream, int maxItems)
+{
+    qint32 length;
+    *stream >> length;
+
+    if ( stream->status() != QDataStream::Ok )
+        return false;
+
+    if (length < 0) {
+        stream->setStatus(QDataStream::ReadCorruptData);
+        return false;
+    }
+
+    const int firstRow = model ? model->rowCount() : 0;
+    const int count = model ? qMax(0, qMin(length, maxItems - firstRow)) : 0;
+
+    if ( count != 0 && !model->insertRows(firstRow, count) )
+        return false;
+
+    for(qint32 i = 0; i < length && stream->status() == QDataStream::Ok; ++i) {
+        if (i < count) {
+            QVariantMap data;
+            deserializeData(stream, &data);
+            model->setData( model->index(firstRow + i, 0), data, contentType::data );
+        } else {
+            skipSerializedData(stream);
+        }
+    }
+
+    return stream->status() == QDataStream::Ok;
+}
+
 bool serializeData(const QAbstractItemModel &model, QIODevice *file)
 {
     QDataStream stream(file);
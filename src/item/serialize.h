@@ -20,13 +20,93 @@
 #ifndef SERIALIZE_H
 #define SERIALIZE_H
 
+#include <QByteArray>
+#include <QList>
+#include <QMap>
 #include <QVariantMap>
 
 class QAbstractItemModel;
-class QByteArray;
 class QDataStream;
 class QIODevice;
 
+/// Compression codec of format data in serialized items.
+enum class DataCodec : quint8 {
+    None = 0,
+    Zlib = 1,
+    /// Available only if built with zstd library (HAS_ZSTD).
+    Zstd = 2
+};
+
+/// Returns MIME type from compressed form used in serialized data.
+QString decompressMime(const QString &mime);
+
+/// Returns false if codec is unknown or unavailable in this build.
+bool isDataCodecAvailable(DataCodec codec);
+
+/// Returns uncompressed data or null byte array on error.
+QByteArray decompressData(const char *data, int size, DataCodec codec);
+
+/**
+ * Codecs used for serializing formats in tab files.
+ *
+ * Default policy compresses formats with zlib if it's useful.
+ */
+class DataCompressionPolicy {
+public:
+    /**
+     * Creates policy from comma-separated list of "MIME=CODEC" rules.
+     *
+     * MIME is prefix of format and CODEC is "none", "zlib" or "zstd". Longest
+     * matching prefix is used. Rule without "MIME=" part applies to all
+     * formats. Unavailable codecs fall back to zlib. Unmatched formats are
+     * compressed with default codec if it's useful.
+     *
+     * Example: "zstd,image/png=none"
+     */
+    static DataCompressionPolicy fromString(const QString &policy);
+
+    /// Returns codec for serializing format data.
+    DataCodec codecForFormat(const QByteArray &bytes, const QString &mime) const;
+
+private:
+    struct Rule {
+        QString mimePrefix;
+        DataCodec codec;
+    };
+
+    /// Codec for formats without matching rule which should be compressed.
+    DataCodec m_defaultCodec = DataCodec::Zlib;
+    QList<Rule> m_rules;
+};
+
+/// Format data already compressed with a codec.
+struct CompressedData {
+    DataCodec codec;
+    QByteArray bytes;
+};
+
+using CompressedDataMap = QMap<QString, CompressedData>;
+
+/**
+ * Serializes item for tab file.
+ *
+ * Formats in @a data are compressed according to @a policy, formats in
+ * @a compressedData are stored as they are.
+ *
+ * Item is stored in format readable by older versions unless a format is
+ * compressed with codec unsupported by them.
+ */
+void serializeItem(
+        QDataStream *stream, const QVariantMap &data,
+        const DataCompressionPolicy &policy,
+        const CompressedDataMap &compressedData = CompressedDataMap());
+
+/**
+ * Serializes item data in format readable by older versions.
+ *
+ * Formats are compressed with zlib if it's useful. Data compression policy
+ * applies only to tab files (see serializeItem()).
+ */
 void serializeData(QDataStream *stream, const QVariantMap &data);
 void deserializeData(QDataStream *stream, QVariantMap *data);
 QByteArray serializeData(const QVariantMap &data);
@@ -34,6 +114,16 @@ bool deserializeData(QVariantMap *data, const QByteArray &bytes);
 
 bool serializeData(const QAbstractItemModel &model, QDataStream *stream);
 bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItems);
+
+/**
+ * Reads all items serialized with serializeData() and appends them to model.
+ *
+ * Items over @a maxItems limit (or all items if @a model is null) are skipped
+ * without decompressing their data so that the stream ends after the last item.
+ * Only single item is kept in memory at a time.
+ */
+bool appendDeserializedData(QAbstractItemModel *model, QDataStream *stream, int maxItems);
+
 bool serializeData(const QAbstractItemModel &model, QIODevice *file);
 bool deserializeData(QAbstractItemModel *model, QIODevice *file, int maxItems);
 
@@ -33,6 +33,7 @@
 #include <QScriptEngine>
 
 #ifdef HAS_TESTS
+#  include "tests/benchmarks.h"
 #  include "tests/tests.h"
 #endif // HAS_TESTS
 
@@ -124,6 +125,12 @@ bool needsTests(const QString &arg)
     return arg == "--tests" ||
            arg == "tests";
 }
+
+bool needsBenchmarks(const QString &arg)
+{
+    return arg == "--benchmarks" ||
+           arg == "benchmarks";
+}
 #endif
 
 bool containsOnlyValidCharacters(const QString &sessionName)
@@ -196,6 +203,9 @@ int startApplication(int argc, char **argv)
             // Skip the "tests" argument and pass the rest to tests.
             return runTests(argc - skipArguments - 1, argv + skipArguments + 1);
         }
+
+        if ( needsBenchmarks(arg) )
+            return runBenchmarks(argc - skipArguments - 1, argv + skipArguments + 1);
 #endif
     }
 
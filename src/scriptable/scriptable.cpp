@@ -379,9 +379,15 @@ QByteArray readReply(QNetworkReply *reply, const Scriptable &scriptable)
     while ( !reply->isFinished() ) {
         if ( !scriptable.isConnected() )
             return QByteArray();
-        waitFor(100);
-        if ( reply->waitForReadyRead(100) )
-            data.append(reply->readAll());
+
+        // Sleep until more data arrive, reply finishes or it's time to check connection.
+        QEventLoop loop;
+        QObject::connect( reply, SIGNAL(readyRead()), &loop, SLOT(quit()) );
+        QObject::connect( reply, SIGNAL(finished()), &loop, SLOT(quit()) );
+        QTimer::singleShot( 100, &loop, SLOT(quit()) );
+        loop.exec();
+
+        data.append(reply->readAll());
     }
     data.append(reply->readAll());
 
@@ -611,6 +617,22 @@ void Scriptable::throwError(const QString &errorMessage)
     currentContext->throwError( fromString(errorMessage + '\n') );
 }
 
+void Scriptable::reset()
+{
+    m_engine->clearExceptions();
+
+    if (m_proxy)
+        m_proxy->reset();
+
+    m_inputSeparator = "\n";
+    m_input = QScriptValue();
+    m_data.clear();
+    m_actionName.clear();
+    m_connected = true;
+    m_skipArguments = 0;
+    m_executeStdoutCallback = QScriptValue();
+}
+
 void Scriptable::sendMessageToClient(const QByteArray &message, int exitCode)
 {
     emit sendMessage(message, exitCode);
@@ -867,6 +889,18 @@ QScriptValue Scriptable::tab()
     return QScriptValue();
 }
 
+QScriptValue Scriptable::searchAllTabs()
+{
+    m_skipArguments = 1;
+
+    const QScriptValue value = argument(0);
+    const QRegExp re = value.isRegExp()
+            ? value.toRegExp()
+            : QRegExp( toString(value, this), Qt::CaseInsensitive );
+
+    return toScriptValue( m_proxy->searchAllTabs(re), this );
+}
+
 void Scriptable::removeTab()
 {
     m_skipArguments = 1;
@@ -1385,7 +1419,7 @@ QScriptValue Scriptable::input()
     if ( !getByteArray(m_input, this) ) {
         sendMessageToClient(QByteArray(), CommandReadInput);
         while ( m_connected && !getByteArray(m_input, this) )
-            QApplication::processEvents();
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
     }
 
     return m_input;
@@ -1519,7 +1553,7 @@ void Scriptable::keys()
 
         // Make sure all keys are send (shortcuts are postponed because they can be blocked by modal windows).
         while ( !m_proxy->keysSent() ) {
-            QCoreApplication::processEvents();
+            waitFor(5);
             if (!m_connected) {
                 throwError("Disconnected");
                 return;
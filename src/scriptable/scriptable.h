@@ -112,6 +112,9 @@ public:
 
     bool isConnected() const { return m_connected; }
 
+    /// Reset state from previous client so the object can be reused.
+    void reset();
+
     const QVariantMap &data() const { return m_data; }
 
     QScriptValue getMimeText() const { return mimeText; }
@@ -165,6 +168,7 @@ public slots:
     void paste();
 
     QScriptValue tab();
+    QScriptValue searchAllTabs();
     void removeTab();
     void removetab() { removeTab(); }
     void renameTab();
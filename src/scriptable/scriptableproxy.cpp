@@ -34,6 +34,7 @@
 #include "gui/mainwindow.h"
 #include "gui/tabicons.h"
 #include "gui/windowgeometryguard.h"
+#include "item/itemfactory.h"
 #include "item/serialize.h"
 #include "platform/platformnativeinterface.h"
 #include "platform/platformwindow.h"
@@ -445,6 +446,23 @@ ScriptableProxy::ScriptableProxy(MainWindow *mainWindow)
     moveToThread(m_wnd->thread());
 }
 
+void ScriptableProxy::reset()
+{
+    m_tabName.clear();
+    m_actionData.clear();
+}
+
+QList<ItemScriptable*> ScriptableProxy::createScriptableObjects(ItemFactory *itemFactory, QThread *thread)
+{
+    INVOKE(createScriptableObjects(itemFactory, thread));
+
+    const auto scriptables = itemFactory->scriptableObjects(nullptr);
+    for (auto scriptable : scriptables)
+        scriptable->moveToThread(thread);
+
+    return scriptables;
+}
+
 QVariantMap ScriptableProxy::getActionData(int id)
 {
     INVOKE(getActionData(id));
@@ -711,6 +729,21 @@ QStringList ScriptableProxy::tabs()
     return m_wnd->tabs();
 }
 
+QList<QVariantMap> ScriptableProxy::searchAllTabs(const QRegExp &re)
+{
+    INVOKE(searchAllTabs(re));
+
+    QList<QVariantMap> result;
+    for ( const auto &item : m_wnd->findItemsInTabs(re) ) {
+        QVariantMap found;
+        found["tab"] = item.first;
+        found["row"] = item.second;
+        result.append(found);
+    }
+
+    return result;
+}
+
 bool ScriptableProxy::toggleVisible()
 {
     INVOKE(toggleVisible());
@@ -30,10 +30,13 @@
 
 #include <memory>
 
+class ItemFactory;
+class ItemScriptable;
 class MainWindow;
 class QPersistentModelIndex;
 class QPixmap;
 class QPoint;
+class QThread;
 
 struct Command;
 
@@ -59,6 +62,12 @@ public:
 
     bool isValueUnset();
 
+    /// Forget current tab and action data so the proxy can be used by another script.
+    void reset();
+
+    /// Create plugin objects for scripts and move them to @a thread.
+    QList<ItemScriptable*> createScriptableObjects(ItemFactory *itemFactory, QThread *thread);
+
     QVariantMap getActionData(int id);
     void setActionData(int id, const QVariantMap &data);
 
@@ -112,6 +121,7 @@ public:
     bool toggleMenu(const QString &tabName, int maxItemCount, QPoint position);
     bool toggleMenu();
     int findTabIndex(const QString &arg1);
+    QList<QVariantMap> searchAllTabs(const QRegExp &re);
 
     void openActionDialog(const QVariantMap &arg1);
 
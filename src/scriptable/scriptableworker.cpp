@@ -27,12 +27,243 @@
 #include "item/itemwidget.h"
 #include "../qt/bytearrayclass.h"
 
+#include <QAbstractEventDispatcher>
 #include <QApplication>
+#include <QHash>
 #include <QObject>
 #include <QScriptEngine>
+#include <QScriptValueIterator>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+#include <QThreadStorage>
 
 Q_DECLARE_METATYPE(QByteArray*)
 
+namespace {
+
+/**
+ * Script engine with scriptable objects for a client thread.
+ */
+class ScriptableEngine final
+{
+public:
+    ScriptableEngine(MainWindow *mainWindow, ItemFactory *itemFactory, int generation)
+        : m_generation(generation)
+        , m_proxy(mainWindow)
+        , m_scriptable(&m_engine, &m_proxy)
+    {
+        COPYQ_LOG("Initializing script engine");
+
+        m_plugins = m_proxy.createScriptableObjects(itemFactory, QThread::currentThread());
+
+        auto plugins = m_engine.newObject();
+        m_engine.globalObject().setProperty("plugins", plugins);
+
+        for (auto scriptableObject : m_plugins) {
+            scriptableObject->setScriptable(&m_scriptable);
+            const auto obj = m_engine.newQObject(scriptableObject);
+            const auto name = scriptableObject->objectName();
+            plugins.setProperty(name, obj);
+        }
+
+        QScriptValueIterator it( m_engine.globalObject() );
+        while (it.hasNext()) {
+            it.next();
+            m_globals.insert( it.name(), GlobalProperty{it.value(), it.flags()} );
+        }
+
+        QSet<qint64> visited;
+        snapshotSharedObject(m_engine.globalObject(), 0, &visited);
+    }
+
+    ~ScriptableEngine()
+    {
+        qDeleteAll(m_plugins);
+    }
+
+    int generation() const { return m_generation; }
+
+    ScriptableProxy *proxy() { return &m_proxy; }
+
+    Scriptable *scriptable() { return &m_scriptable; }
+
+    const QList<ItemScriptable*> &plugins() const { return m_plugins; }
+
+    /**
+     * Restore state after script finishes.
+     *
+     * Returns false if the script modified built-in objects, their prototypes
+     * or plugin objects and the engine cannot be reused.
+     */
+    bool reset()
+    {
+        auto globalObject = m_engine.globalObject();
+
+        // Remove globals defined by last script and restore overridden ones.
+        QStringList newGlobals;
+        QScriptValueIterator it(globalObject);
+        while (it.hasNext()) {
+            it.next();
+            if ( !m_globals.contains(it.name()) )
+                newGlobals.append( it.name() );
+        }
+
+        for (const auto &name : newGlobals)
+            globalObject.setProperty(name, QScriptValue());
+
+        for (auto it2 = m_globals.constBegin(); it2 != m_globals.constEnd(); ++it2) {
+            const auto &property = it2.value();
+            if ( !globalObject.property(it2.key()).strictlyEquals(property.value) )
+                globalObject.setProperty(it2.key(), property.value, property.flags);
+        }
+
+        m_scriptable.reset();
+
+        if ( sharedObjectsChanged() )
+            return false;
+
+        m_engine.collectGarbage();
+        return true;
+    }
+
+    ScriptableEngine(const ScriptableEngine &) = delete;
+    ScriptableEngine &operator=(const ScriptableEngine &) = delete;
+
+private:
+    struct GlobalProperty {
+        QScriptValue value;
+        QScriptValue::PropertyFlags flags;
+    };
+
+    using Properties = QHash<QString, GlobalProperty>;
+
+    struct SharedObject {
+        QScriptValue object;
+        Properties properties;
+    };
+
+    static bool isSkippedProperty(const QScriptValueIterator &it)
+    {
+        // Members of wrapped QObjects are backed by C++ code.
+        return it.flags().testFlag(QScriptValue::QObjectMember);
+    }
+
+    static Properties ownProperties(const QScriptValue &object)
+    {
+        Properties properties;
+        QScriptValueIterator it(object);
+        while (it.hasNext()) {
+            it.next();
+            if ( !isSkippedProperty(it) )
+                properties.insert( it.name(), GlobalProperty{it.value(), it.flags()} );
+        }
+        return properties;
+    }
+
+    /**
+     * Remember properties of objects reachable from global object
+     * (built-ins, their prototypes, plugins) which scripts can modify.
+     */
+    void snapshotSharedObject(const QScriptValue &object, int depth, QSet<qint64> *visited)
+    {
+        if ( !object.isObject() || visited->contains(object.objectId()) )
+            return;
+
+        visited->insert( object.objectId() );
+
+        const auto properties = ownProperties(object);
+
+        // Top-level globals are restored separately.
+        if (depth > 0)
+            m_sharedObjects.append( SharedObject{object, properties} );
+
+        if (depth >= 2)
+            return;
+
+        snapshotSharedObject(object.prototype(), depth + 1, visited);
+        for (const auto &property : properties)
+            snapshotSharedObject(property.value, depth + 1, visited);
+    }
+
+    bool sharedObjectsChanged() const
+    {
+        for (const auto &sharedObject : m_sharedObjects) {
+            const auto properties = ownProperties(sharedObject.object);
+            if ( properties.size() != sharedObject.properties.size() )
+                return true;
+
+            for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+                const auto oldIt = sharedObject.properties.constFind(it.key());
+                if ( oldIt == sharedObject.properties.constEnd() || oldIt->flags != it->flags )
+                    return true;
+
+                const bool isAccessor = it->flags
+                        & (QScriptValue::PropertyGetter | QScriptValue::PropertySetter);
+                if ( !isAccessor && !oldIt->value.strictlyEquals(it->value) )
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    int m_generation;
+    QScriptEngine m_engine;
+    ScriptableProxy m_proxy;
+    Scriptable m_scriptable;
+    QList<ItemScriptable*> m_plugins;
+    Properties m_globals;
+    QList<SharedObject> m_sharedObjects;
+};
+
+QThreadStorage<ScriptableEngine*> scriptableEngines;
+
+ScriptableEngine *scriptableEngine(MainWindow *mainWindow, ItemFactory *itemFactory, int generation)
+{
+    auto engine = scriptableEngines.localData();
+    if (engine == nullptr || engine->generation() != generation) {
+        // Old engine is deleted.
+        engine = new ScriptableEngine(mainWindow, itemFactory, generation);
+        scriptableEngines.setLocalData(engine);
+    }
+    return engine;
+}
+
+void discardScriptableEngine()
+{
+    COPYQ_LOG("Discarding script engine with modified built-in objects");
+    scriptableEngines.setLocalData(nullptr);
+}
+
+} // namespace
+
+ScriptableWorkerActivity::ScriptableWorkerActivity()
+{
+    m_elapsed.start();
+
+    const auto dispatcher = QAbstractEventDispatcher::instance();
+    if (dispatcher) {
+        connect( dispatcher, SIGNAL(aboutToBlock()),
+                 this, SLOT(onAboutToBlock()) );
+        connect( dispatcher, SIGNAL(awake()),
+                 this, SLOT(onAwake()) );
+    }
+}
+
+void ScriptableWorkerActivity::onAboutToBlock()
+{
+    m_idle.start();
+}
+
+void ScriptableWorkerActivity::onAwake()
+{
+    if ( m_idle.isValid() ) {
+        m_idleMs += m_idle.elapsed();
+        m_idle.invalidate();
+    }
+}
+
 ScriptableWorkerSocketGuard::ScriptableWorkerSocketGuard(const ClientSocketPtr &socket)
     : m_socket(socket)
 {
@@ -51,11 +282,13 @@ ClientSocket *ScriptableWorkerSocketGuard::socket() const
 ScriptableWorker::ScriptableWorker(
         MainWindow *mainWindow,
         const ClientSocketPtr &socket,
-        const QList<ItemScriptable*> &scriptables)
+        ItemFactory *itemFactory,
+        int engineGeneration)
     : QRunnable()
     , m_wnd(mainWindow)
-    , m_socketGuard(new ScriptableWorkerSocketGuard(socket))
-    , m_scriptables(scriptables)
+    , m_socketGuard(socket ? new ScriptableWorkerSocketGuard(socket) : nullptr)
+    , m_itemFactory(itemFactory)
+    , m_engineGeneration(engineGeneration)
 {
 }
 
@@ -63,46 +296,55 @@ ScriptableWorker::~ScriptableWorker() = default;
 
 void ScriptableWorker::run()
 {
+    auto engine = scriptableEngine(m_wnd, m_itemFactory, m_engineGeneration);
+
+    if (!m_socketGuard)
+        return;
+
     auto socket = m_socketGuard->socket();
 
     setCurrentThreadName("Script-" + QString::number(socket->id()));
 
-    QScriptEngine engine;
-    ScriptableProxy proxy(m_wnd);
-    Scriptable scriptable(&engine, &proxy);
+    auto proxy = engine->proxy();
+    auto scriptable = engine->scriptable();
 
-    QObject::connect( &proxy, SIGNAL(sendMessage(QByteArray,int)),
+    QObject::connect( proxy, SIGNAL(sendMessage(QByteArray,int)),
                       socket, SLOT(sendMessage(QByteArray,int)) );
 
-    QObject::connect( &scriptable, SIGNAL(sendMessage(QByteArray,int)),
+    QObject::connect( scriptable, SIGNAL(sendMessage(QByteArray,int)),
                       socket, SLOT(sendMessage(QByteArray,int)) );
     QObject::connect( socket, SIGNAL(messageReceived(QByteArray,int)),
-                      &scriptable, SLOT(onMessageReceived(QByteArray,int)) );
+                      scriptable, SLOT(onMessageReceived(QByteArray,int)) );
 
     QObject::connect( socket, SIGNAL(disconnected()),
-                      &scriptable, SLOT(onDisconnected()) );
+                      scriptable, SLOT(onDisconnected()) );
     QObject::connect( socket, SIGNAL(connectionFailed()),
-                      &scriptable, SLOT(onDisconnected()) );
+                      scriptable, SLOT(onDisconnected()) );
 
-    QMetaObject::invokeMethod(socket, "start", Qt::QueuedConnection);
+    ScriptableWorkerActivity activity;
 
-    auto plugins = engine.newObject();
-    engine.globalObject().setProperty("plugins", plugins);
+    QMetaObject::invokeMethod(socket, "start", Qt::QueuedConnection);
 
-    for (auto scriptableObject : m_scriptables) {
-        scriptableObject->setScriptable(&scriptable);
-        const auto obj = engine.newQObject(scriptableObject);
-        const auto name = scriptableObject->objectName();
-        plugins.setProperty(name, obj);
+    for (auto scriptableObject : engine->plugins())
         scriptableObject->start();
-    }
 
-    while ( scriptable.isConnected() )
-        QCoreApplication::processEvents();
+    // Sleep until a message from client, disconnection or reply from main thread arrives.
+    while ( scriptable->isConnected() )
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+
+    COPYQ_LOG( QString("Client %1 finished (busy: %2 ms, idle: %3 ms)")
+               .arg(socket->id())
+               .arg(activity.busyMs())
+               .arg(activity.idleMs()) );
+
+    // Ignore any pending messages for the finished client.
+    QObject::disconnect(proxy, nullptr, socket, nullptr);
+    QObject::disconnect(scriptable, nullptr, socket, nullptr);
+    QObject::disconnect(socket, nullptr, scriptable, nullptr);
+    QCoreApplication::removePostedEvents(scriptable);
 
-    for (auto scriptableObject : m_scriptables)
-        scriptableObject->deleteLater();
-    m_scriptables.clear();
+    if ( !engine->reset() )
+        discardScriptableEngine();
 
     QMetaObject::invokeMethod(m_socketGuard, "deleteLater", Qt::QueuedConnection);
 }
@@ -25,13 +25,14 @@
 #include "scriptable/scriptable.h"
 #include "scriptable/scriptableproxy.h"
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QRunnable>
 
 class ClientSocket;
 using ClientSocketPtr = std::shared_ptr<ClientSocket>;
 
-class ItemScriptable;
+class ItemFactory;
 
 /**
  * Handles socket destruction.
@@ -54,13 +55,48 @@ private:
     ClientSocketPtr m_socket;
 };
 
+/**
+ * Measures time current thread spends waiting for events and time it is busy.
+ */
+class ScriptableWorkerActivity : public QObject {
+    Q_OBJECT
+public:
+    ScriptableWorkerActivity();
+
+    qint64 idleMs() const { return m_idleMs; }
+
+    qint64 busyMs() const { return m_elapsed.elapsed() - m_idleMs; }
+
+private slots:
+    void onAboutToBlock();
+    void onAwake();
+
+private:
+    QElapsedTimer m_elapsed;
+    QElapsedTimer m_idle;
+    qint64 m_idleMs = 0;
+};
+
+/**
+ * Runs script for a client.
+ *
+ * Script engine with plugin objects is initialized only once per thread
+ * and reused (after resetting its state) by subsequent clients
+ * while @a engineGeneration stays the same. Engine is recreated if a script
+ * modifies built-in objects, their prototypes or plugin objects.
+ *
+ * If @a socket is null, the worker only prepares engine for current thread.
+ *
+ * The thread blocks while waiting for messages from client or main thread.
+ */
 class ScriptableWorker : public QRunnable
 {
 public:
     ScriptableWorker(
             MainWindow *mainWindow,
             const ClientSocketPtr &socket,
-            const QList<ItemScriptable*> &scriptables);
+            ItemFactory *itemFactory,
+            int engineGeneration);
 
     ~ScriptableWorker();
 
@@ -72,7 +108,8 @@ public:
 private:
     MainWindow *m_wnd;
     QPointer<ScriptableWorkerSocketGuard> m_socketGuard;
-    QList<ItemScriptable*> m_scriptables;
+    ItemFactory *m_itemFactory;
+    int m_engineGeneration;
 };
 
 #endif // SCRIPTABLEWORKER_H
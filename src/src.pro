@@ -80,7 +80,12 @@ HEADERS += \
     item/itemeditor.h \
     item/itemeditorwidget.h \
     item/itemfactory.h \
+    item/itemfilter.h \
+    item/itemheightcache.h \
+    item/itemsearchindex.h \
     item/itemwidget.h \
+    item/mappeditemdata.h \
+    item/painteditem.h \
     item/serialize.h \
     platform/dummy/dummyplatform.h \
     platform/platformnativeinterface.h \
@@ -118,6 +123,7 @@ HEADERS += \
     common/commandtester.h \
     gui/filtercompleter.h \
     common/sleeptimer.h \
+    common/textsearch.h \
     tests/test_utils.h \
     gui/filedialog.h \
     gui/windowgeometryguard.h \
@@ -146,6 +152,7 @@ SOURCES += \
     common/server.cpp \
     common/shortcuts.cpp \
     common/textdata.cpp \
+    common/textsearch.cpp \
     gui/aboutdialog.cpp \
     gui/actiondialog.cpp \
     gui/actionhandler.cpp \
@@ -184,7 +191,12 @@ SOURCES += \
     item/itemeditor.cpp \
     item/itemeditorwidget.cpp \
     item/itemfactory.cpp \
+    item/itemfilter.cpp \
+    item/itemheightcache.cpp \
+    item/itemsearchindex.cpp \
     item/itemwidget.cpp \
+    item/mappeditemdata.cpp \
+    item/painteditem.cpp \
     item/serialize.cpp \
     main.cpp \
     ../qt/bytearrayclass.cpp \
@@ -245,8 +257,8 @@ CONFIG(debug, debug|release) {
 CONFIG(tests) {
     DEFINES += HAS_TESTS
     QT += testlib
-    SOURCES += tests/tests.cpp
-    HEADERS += tests/tests.h
+    SOURCES += tests/tests.cpp tests/benchmarks.cpp
+    HEADERS += tests/tests.h tests/benchmarks.h
 }
 
 include(platform/platform.pri)
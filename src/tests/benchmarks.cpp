@@ -0,0 +1,285 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmarks.h"
+
+#include "common/contenttype.h"
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+#include "item/clipboardmodel.h"
+#include "item/itemfilter.h"
+#include "item/serialize.h"
+
+#include <QApplication>
+#include <QBuffer>
+#include <QDataStream>
+#include <QImage>
+#include <QList>
+#include <QTest>
+
+namespace {
+
+void removeLastItem(ClipboardItemList *items)
+{
+    items->remove(items->size() - 1, 1);
+}
+
+void removeLastItem(QList<ClipboardItem> *items)
+{
+    items->removeLast();
+}
+
+template <typename ItemList>
+void benchmarkClipboardItemList(int itemCount)
+{
+    ItemList items;
+    ClipboardItem item;
+    for (int i = 0; i < itemCount; ++i) {
+        item.setText( QString::number(i) );
+        items.insert(items.size(), item);
+    }
+
+    // Add new item to top, evict last item and move items from middle and bottom to top.
+    QBENCHMARK {
+        items.insert(0, item);
+        removeLastItem(&items);
+        items.move(items.size() / 2, 0);
+        items.move(items.size() - 2, 0);
+    }
+}
+
+/// Returns about 1 MB of data of given kind for compression benchmarks.
+QByteArray benchmarkData(const QString &format)
+{
+    const int size = 1024 * 1024;
+
+    if (format == "image/bmp") {
+        QImage image(512, 512, QImage::Format_RGB32);
+        for (int y = 0; y < image.height(); ++y) {
+            for (int x = 0; x < image.width(); ++x)
+                image.setPixel( x, y, qRgb(x / 2, y / 2, (x * y) % 251) );
+        }
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "BMP");
+        return buffer.data();
+    }
+
+    QByteArray data;
+    for (int i = 0; data.size() < size; ++i) {
+        const QByteArray line = "Line " + QByteArray::number(i)
+                + " with some text and number " + QByteArray::number(i * 7919 % 10007);
+        if (format == mimeHtml)
+            data.append("<li><a href=\"#item" + QByteArray::number(i) + "\">" + line + "</a></li>\n");
+        else
+            data.append(line + "\n");
+    }
+    return data;
+}
+
+} // namespace
+
+Benchmarks::Benchmarks(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void Benchmarks::benchmarkItemList_data()
+{
+    QTest::addColumn<bool>("deque");
+    QTest::addColumn<int>("itemCount");
+
+    for (int itemCount : {1000, 10000, 100000}) {
+        const auto count = QByteArray::number(itemCount);
+        QTest::newRow(("QList " + count).constData()) << false << itemCount;
+        QTest::newRow(("deque " + count).constData()) << true << itemCount;
+    }
+}
+
+void Benchmarks::benchmarkItemList()
+{
+    QFETCH(bool, deque);
+    QFETCH(int, itemCount);
+
+    if (deque)
+        benchmarkClipboardItemList<ClipboardItemList>(itemCount);
+    else
+        benchmarkClipboardItemList< QList<ClipboardItem> >(itemCount);
+}
+
+void Benchmarks::benchmarkItemData_data()
+{
+    QTest::addColumn<QString>("format");
+    QTest::addColumn<QString>("policy");
+
+    QStringList codecs = QStringList() << "none" << "zlib";
+    if ( isDataCodecAvailable(DataCodec::Zstd) )
+        codecs.append("zstd");
+
+    for (const auto &format : {mimeText, mimeHtml, "image/bmp"}) {
+        for (const auto &codec : codecs) {
+            const QString policy = QString("%1=%2").arg(format, codec);
+            QTest::newRow( policy.toUtf8().constData() ) << QString(format) << policy;
+        }
+    }
+}
+
+void Benchmarks::benchmarkItemData()
+{
+    QFETCH(QString, format);
+    QFETCH(QString, policy);
+
+    const QVariantMap data = createDataMap( format, benchmarkData(format) );
+    const auto compressionPolicy = DataCompressionPolicy::fromString(policy);
+    const int dataSize = data.value(format).toByteArray().size();
+
+    // Save and load data from tab file.
+    QBENCHMARK {
+        QByteArray savedBytes;
+        {
+            QDataStream out(&savedBytes, QIODevice::WriteOnly);
+            serializeItem(&out, data, compressionPolicy);
+        }
+
+        QVariantMap loadedData;
+        QDataStream in(savedBytes);
+        deserializeData(&in, &loadedData);
+
+        QCOMPARE( loadedData.value(format).toByteArray().size(), dataSize );
+    }
+}
+
+void Benchmarks::benchmarkTextMatcher_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("matcher");
+
+    // Literal words as from search bar and regular expression with Unicode letters.
+    for (const auto &pattern : {"žluťoučký.*kůň", "\\bh\\w+ček\\b"}) {
+        QStringList matchers = QStringList() << "TextMatcher" << "QRegExp";
+#if QT_VERSION >= 0x050000
+        matchers.append("QRegularExpression");
+#endif
+        for (const auto &matcher : matchers) {
+            const QString name = QString("%1 %2").arg(matcher, QString::fromUtf8(pattern));
+            QTest::newRow( name.toUtf8().constData() ) << QString::fromUtf8(pattern) << matcher;
+        }
+    }
+}
+
+void Benchmarks::benchmarkTextMatcher()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, matcher);
+
+    QStringList texts;
+    for (int i = 0; i < 10000; ++i) {
+        QString text = QString::fromUtf8("Příliš %1 úpěl ďábelské ódy ").arg(i).repeated(10);
+        if (i % 100 == 0)
+            text.append( QString::fromUtf8("Žluťoučký %1 kůň, hříbeček").arg(i) );
+        texts.append(text);
+    }
+
+    const QRegExp re(pattern, Qt::CaseInsensitive);
+    const TextMatcher textMatcher(re);
+#if QT_VERSION >= 0x050000
+    const QRegularExpression regularExpression(
+                pattern,
+                QRegularExpression::CaseInsensitiveOption
+                | QRegularExpression::UseUnicodePropertiesOption);
+#endif
+
+    const auto matches = [&](const QString &text) {
+#if QT_VERSION >= 0x050000
+        if (matcher == "QRegularExpression")
+            return regularExpression.match(text).hasMatch();
+#endif
+        if (matcher == "QRegExp")
+            return re.indexIn(text) != -1;
+        return textMatcher.matches(text);
+    };
+
+    int matchCount = 0;
+    QBENCHMARK {
+        matchCount = 0;
+        for (const auto &text : texts) {
+            if ( matches(text) )
+                ++matchCount;
+        }
+    }
+
+    // All matchers must find same items.
+    QCOMPARE(matchCount, 100);
+}
+
+void Benchmarks::benchmarkTraySearch_data()
+{
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("decode and lower-case each item") << false;
+    QTest::newRow("cached texts") << true;
+}
+
+void Benchmarks::benchmarkTraySearch()
+{
+    QFETCH(bool, cached);
+
+    ClipboardModel model;
+    for (int i = 0; i < 10000; ++i) {
+        const QString text = QString("Item %1\n").arg(i).repeated(50);
+        model.insertItem( createDataMap(mimeText, text), model.rowCount() );
+    }
+
+    // Search text matches only the last item so all items are searched.
+    const QString searchText = "ITEM 9999";
+    const int maxItemCount = 20;
+
+    QBENCHMARK {
+        int itemCount = 0;
+        for (int row = 0; row < model.rowCount() && itemCount < maxItemCount; ++row) {
+            const QModelIndex index = model.index(row);
+            QString preview;
+            int lineCount;
+            if (cached) {
+                const QString text = index.data(contentType::text).toString();
+                if ( !text.contains(searchText, Qt::CaseInsensitive) )
+                    continue;
+                preview = index.data(contentType::previewText).toString();
+                lineCount = index.data(contentType::textLineCount).toInt();
+            } else {
+                const QString text = getTextData( index.data(contentType::data).toMap() );
+                if ( !text.toLower().contains(searchText.toLower()) )
+                    continue;
+                preview = textPreview(text);
+                lineCount = text.count('\n') + 1;
+            }
+            QCOMPARE( preview, QString("Item 9999...") );
+            QCOMPARE( lineCount, 51 );
+            ++itemCount;
+        }
+        QCOMPARE( itemCount, 1 );
+    }
+}
+
+int runBenchmarks(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    Benchmarks benchmarks;
+    return QTest::qExec(&benchmarks, argc, argv);
+}
@@ -0,0 +1,50 @@
+/*
+    Copyright (c) 2017, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QObject>
+
+/**
+ * Benchmarks for data structures and algorithms used by the application.
+ *
+ * Unlike Tests, these don't need running server.
+ */
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Benchmarks(QObject *parent = nullptr);
+
+private slots:
+    void benchmarkItemList_data();
+    void benchmarkItemList();
+    void benchmarkItemData_data();
+    void benchmarkItemData();
+    void benchmarkTextMatcher_data();
+    void benchmarkTextMatcher();
+    void benchmarkTraySearch_data();
+    void benchmarkTraySearch();
+};
+
+int runBenchmarks(int argc, char *argv[]);
+
+#endif // BENCHMARKS_H
@@ -35,8 +35,10 @@
 
 #include <QApplication>
 #include <QClipboard>
+#include <QDataStream>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QElapsedTimer>
 #include <QFileInfo>
 #include <QMap>
@@ -131,6 +133,36 @@ bool waitForProcessFinished(QProcess *p)
     return p->state() == QProcess::NotRunning;
 }
 
+/// Returns measured item heights saved for tab (see ItemHeightCache::save()).
+QMap<quint64, qint32> readItemHeights(const QString &tabFileName)
+{
+    QMap<quint64, qint32> heights;
+
+    QFile file(tabFileName + ".sizes");
+    if ( !file.open(QIODevice::ReadOnly) )
+        return heights;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    qint32 version;
+    uint layoutKey;
+    qint32 count;
+    stream >> version >> layoutKey >> count;
+
+    quint64 key;
+    qint32 height;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        stream >> key >> height;
+        heights[key] = height;
+    }
+
+    if ( stream.status() != QDataStream::Ok )
+        heights.clear();
+
+    return heights;
+}
+
 bool closeProcess(QProcess *p)
 {
     if ( waitForProcessFinished(p) )
@@ -666,6 +698,18 @@ void Tests::commandEvalArguments()
         "Test 1, Test 2\n");
 }
 
+void Tests::commandEvalIsolated()
+{
+    // Changes from a script must not leak to scripts of following clients.
+    RUN("eval" << "x = 1; String.prototype.test = 2; Math.test = 3; plugins.test = 4", "4\n");
+    for (int i = 0; i < 10; ++i) {
+        RUN("eval" << "typeof x", "undefined\n");
+        RUN("eval" << "typeof ''.test", "undefined\n");
+        RUN("eval" << "typeof Math.test", "undefined\n");
+        RUN("eval" << "typeof plugins.test", "undefined\n");
+    }
+}
+
 void Tests::commandPrint()
 {
     RUN("print" << "1", "1");
@@ -1201,6 +1245,39 @@ void Tests::commandsExportImport()
     RUN("tab" << tab2 << "read" << "0", "1");
 }
 
+void Tests::commandsImportV3()
+{
+    const auto tab = testTab(1);
+
+    QTemporaryFile tmp;
+    QVERIFY(tmp.open());
+    {
+        QByteArray tabBytes;
+        {
+            QDataStream tabOut(&tabBytes, QIODevice::WriteOnly);
+            tabOut.setVersion(QDataStream::Qt_4_7);
+            tabOut << static_cast<qint32>(2);
+            serializeData( &tabOut, createDataMap(mimeText, QByteArray("A")) );
+            serializeData( &tabOut, createDataMap(mimeText, QByteArray("B")) );
+        }
+
+        QVariantMap tabMap;
+        tabMap["name"] = tab;
+        tabMap["data"] = tabBytes;
+
+        QVariantMap data;
+        data["tabs"] = QVariantList() << tabMap;
+
+        QDataStream out(&tmp);
+        out.setVersion(QDataStream::Qt_4_7);
+        out << QByteArray("CopyQ v3") << data;
+    }
+    tmp.close();
+
+    RUN("importData" << tmp.fileName(), "true\n");
+    RUN("tab" << tab << "read" << "0" << "1", "A\nB");
+}
+
 void Tests::commandsGetSetCommands()
 {
     RUN("commands().length", "0\n");
@@ -1405,6 +1482,25 @@ void Tests::moveItems()
     RUN(args << "testSelected", tab + " 1 0 1\n");
 }
 
+void Tests::moveAndEditItems()
+{
+    const auto tab = QString(clipboardTabName);
+    const auto args = Args() << "separator" << " ";
+    RUN(args << "add" << "D" << "C" << "B" << "A", "");
+
+    // move item to bottom
+    RUN(args << "keys" << "RIGHT" << "CTRL+DOWN" << "CTRL+DOWN" << "CTRL+DOWN", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "B C D A");
+    RUN(args << "testSelected", tab + " 3 3\n");
+
+    // Rendered items must stay with moved rows.
+    RUN(args << "keys" << "UP" << "F2" << "END" << ":2" << "F2", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "B C D2 A");
+
+    RUN(args << "keys" << "HOME" << "F2" << "END" << ":1" << "F2", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "B1 C D2 A");
+}
+
 void Tests::deleteItems()
 {
     const auto tab = QString(clipboardTabName);
@@ -1476,6 +1572,45 @@ void Tests::editItems()
     RUN("read" << "0", "Line 1\nLine 2");
 }
 
+void Tests::editPaintedItems()
+{
+    RUN("config" << "paint_items" << "true", "true\n");
+    RUN("config" << "edit_ctrl_return" << "true", "true\n");
+
+    RUN("write" << "text/html" << "<b>HTML</b>", "");
+    RUN("add" << "Line 2" << "Line 1", "");
+
+    RUN("keys" << "DOWN" << "DOWN", "");
+    RUN("testSelected", QString(clipboardTabName) + " 2 2\n");
+
+    RUN("keys" << "UP", "");
+    RUN("keys" << "F2" << "END" << ":+" << "F2", "");
+    RUN("read" << "1", "Line 2+");
+    RUN("read" << "0", "Line 1");
+
+    RUN("keys" << "UP" << "SHIFT+F2" << ":Note" << "F2", "");
+    RUN("read" << mimeText << "0" << mimeItemNotes << "0", "Line 1\nNote");
+    RUN("testSelected", QString(clipboardTabName) + " 0 0\n");
+}
+
+void Tests::browseImageItems()
+{
+    const auto tab = QString(clipboardTabName);
+
+    // Images are decoded in background, invalid images must not break browsing.
+    RUN("write" << "image/png" << "not an image", "");
+    RUN("write" << "image/bmp" << "BM", "");
+    RUN("add" << "A", "");
+
+    RUN("keys" << "END", "");
+    RUN("testSelected", tab + " 2 2\n");
+    RUN("keys" << "HOME", "");
+    RUN("testSelected", tab + " 0 0\n");
+
+    RUN("size", "3\n");
+    RUN("read" << "image/png" << "2", "not an image");
+}
+
 void Tests::createNewItem()
 {
     RUN("config" << "edit_ctrl_return" << "true", "true\n");
@@ -1543,6 +1678,52 @@ void Tests::clipboardToItem()
     WAIT_ON_OUTPUT("read" << "0", bytes);
 }
 
+void Tests::clipboardToExistingItemInLargeTab()
+{
+    RUN("config" << "maxitems" << "10000", "10000\n");
+    RUN("eval" << "for (var i = 0, items = []; i < 10000; ++i) items.push('ITEM' + i); add.apply(this, items)", "");
+    RUN("size", "10000\n");
+    RUN("separator" << " " << "read" << "0" << "9999", "ITEM9999 ITEM0");
+
+    // Existing item is moved to top instead of adding new one.
+    TEST( m_test->setClipboard("ITEM0") );
+    WAIT_ON_OUTPUT("read" << "0", "ITEM0");
+    RUN("separator" << " " << "read" << "1" << "9999", "ITEM9999 ITEM1");
+    RUN("size", "10000\n");
+
+    TEST( m_test->setClipboard("ITEM5000") );
+    WAIT_ON_OUTPUT("read" << "0", "ITEM5000");
+    RUN("separator" << " " << "read" << "1" << "2", "ITEM0 ITEM9999");
+    RUN("size", "10000\n");
+
+    // Changed item is found by its new content.
+    RUN("change" << "9999" << "text/plain" << "CHANGED", "");
+    TEST( m_test->setClipboard("CHANGED") );
+    WAIT_ON_OUTPUT("read" << "0", "CHANGED");
+    RUN("separator" << " " << "read" << "1" << "9999", "ITEM5000 ITEM2");
+    RUN("size", "10000\n");
+
+    // New item removes the last one.
+    TEST( m_test->setClipboard("NEW") );
+    WAIT_ON_OUTPUT("read" << "0", "NEW");
+    RUN("separator" << " " << "read" << "1" << "9999", "CHANGED ITEM3");
+    RUN("size", "10000\n");
+
+    // Removed item is added again.
+    TEST( m_test->setClipboard("ITEM2") );
+    WAIT_ON_OUTPUT("read" << "0", "ITEM2");
+    RUN("separator" << " " << "read" << "1" << "9999", "NEW ITEM4");
+    RUN("size", "10000\n");
+
+    // Item near bottom is found after removing items from top.
+    RUN("remove" << "0" << "1", "");
+    RUN("size", "9998\n");
+    TEST( m_test->setClipboard("ITEM5") );
+    WAIT_ON_OUTPUT("read" << "0", "ITEM5");
+    RUN("separator" << " " << "read" << "1" << "9997", "CHANGED ITEM4");
+    RUN("size", "9998\n");
+}
+
 void Tests::itemToClipboard()
 {
     RUN("add" << "TESTING2" << "TESTING1", "");
@@ -1591,6 +1772,218 @@ void Tests::tabAdd()
     RUN(args << "read" << "0" << "1" << "2", "abc def ghi");
 }
 
+void Tests::tabChangesAfterRestart()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << " ";
+
+    RUN(args << "add" << "E" << "D" << "C" << "B" << "A", "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "A B C D E");
+
+    const QString fileName = tabFileName(tab);
+    const QFileInfo tabFileBefore(fileName);
+    QVERIFY( tabFileBefore.exists() );
+    const QFileInfo journalBefore(fileName + ".log");
+
+    // Only changes since last save are stored.
+    RUN(args << "add" << "X", "");
+    RUN(args << "remove" << "2", "");
+    RUN(args << "change" << "1" << "text/plain" << "Y", "");
+    RUN(args << "write" << "3" << "text/plain" << "Z", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4" << "5", "X Y C Z D E");
+
+    TEST( m_test->stopServer() );
+
+    // Changes are appended to journal and tab file is not rewritten.
+    const QFileInfo tabFileAfter(fileName);
+    QCOMPARE( tabFileAfter.size(), tabFileBefore.size() );
+    QCOMPARE( tabFileAfter.lastModified(), tabFileBefore.lastModified() );
+    const QFileInfo journalAfter(fileName + ".log");
+    QVERIFY( journalAfter.exists() );
+    QVERIFY( journalAfter.size() > (journalBefore.exists() ? journalBefore.size() : 0) );
+
+    TEST( m_test->startServer() );
+
+    RUN(args << "size", "6\n");
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4" << "5", "X Y C Z D E");
+
+    RUN(args << "remove" << "0" << "1", "");
+    RUN(args << "add" << "W", "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "size", "5\n");
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "W C Z D E");
+}
+
+void Tests::tabBigItemsAfterRestart()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << " ";
+
+    const QString writeBigItem =
+            "var data = new Array(1024 * 1024).join('%1');"
+            "write('text/plain', '%1', 'image/png', data, 'text/html', data)";
+
+    RUN(args << "eval" << writeBigItem.arg("X"), "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "eval" << "str(read('image/png', 0)).length", "1048575\n");
+
+    // Saving another big item rewrites the tab file.
+    RUN(args << "eval" << writeBigItem.arg("Y"), "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "0" << "1", "Y X");
+    RUN(args << "eval" << "str(read('image/png', 1)).length", "1048575\n");
+    RUN(args << "eval" << "str(read('text/html', 1)).substr(0, 3)", "XXX\n");
+    RUN(args << "eval" << "str(read('image/png', 0)).substr(0, 3)", "YYY\n");
+
+    // Big items can be modified.
+    RUN(args << "change" << "1" << "text/html" << "Z", "");
+    RUN(args << "read" << "text/html" << "1", "Z");
+    RUN(args << "eval" << "str(read('image/png', 1)).length", "1048575\n");
+
+    // Items are saved in format readable by older versions.
+    TEST( m_test->stopServer() );
+    {
+        QFile tabFile( tabFileName(tab) );
+        QVERIFY( tabFile.open(QIODevice::ReadOnly) );
+        QDataStream stream(&tabFile);
+        qint32 itemCount;
+        qint32 itemVersion;
+        stream >> itemCount >> itemVersion;
+        QCOMPARE( itemCount, 2 );
+        QCOMPARE( itemVersion, -2 );
+    }
+    TEST( m_test->startServer() );
+    RUN(args << "read" << "0" << "1", "Y X");
+
+    // Item with big text (only in tab file) is found by hash stored in tab file index.
+    const QByteArray bigText(100 * 1024, 'T');
+    TEST( m_test->setClipboard(bigText) );
+    WAIT_ON_OUTPUT("read" << "0", bigText);
+    TEST( m_test->setClipboard("SMALL") );
+    WAIT_ON_OUTPUT("read" << "0", "SMALL");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN("size", "2\n");
+    RUN("read" << "1", bigText);
+    TEST( m_test->setClipboard(bigText) );
+    WAIT_ON_OUTPUT("read" << "0", bigText);
+    RUN("size", "2\n");
+}
+
+void Tests::tabsPreloadedAfterRestart()
+{
+    const Args args1 = Args("tab") << testTab(1) << "separator" << " ";
+    const Args args2 = Args("tab") << testTab(2) << "separator" << " ";
+
+    RUN("config" << "preload_tabs" << "true", "true\n");
+    RUN(args1 << "add" << "C" << "B" << "A", "");
+    RUN(args2 << "add" << "Z" << "Y" << "X", "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args1 << "read" << "0" << "1" << "2", "A B C");
+    RUN(args2 << "read" << "0" << "1" << "2", "X Y Z");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    // Items read in background must not be used for removed or renamed tabs.
+    const Args args3 = Args("tab") << testTab(3) << "separator" << " ";
+    RUN("renametab" << testTab(2) << testTab(3), "");
+    RUN("removetab" << testTab(1), "");
+    RUN(args1 << "size", "0\n");
+    RUN(args3 << "read" << "0" << "1" << "2", "X Y Z");
+    RUN(args2 << "size", "0\n");
+}
+
+void Tests::tabCompressedItemsAfterRestart()
+{
+    const Args args = Args("tab") << testTab(1) << "separator" << " ";
+
+    RUN("config" << "item_data_compression" << "zstd,text/html=none,image/png=zlib",
+        "zstd,text/html=none,image/png=zlib\n");
+
+    const QString writeBigItem =
+            "var data = new Array(64 * 1024).join('%1');"
+            "write('text/plain', '%1', 'image/png', data, 'text/html', data, 'image/bmp', data)";
+
+    RUN(args << "eval" << writeBigItem.arg("X"), "");
+    RUN(args << "eval" << writeBigItem.arg("Y"), "");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "0" << "1", "Y X");
+    for (const auto &format : {"image/png", "text/html", "image/bmp"}) {
+        RUN(args << "eval" << QString("str(read('%1', 1)).length").arg(format), "65535\n");
+        RUN(args << "eval" << QString("str(read('%1', 0)).substr(0, 3)").arg(format), "YYY\n");
+    }
+}
+
+void Tests::tabItemHeightsAfterRestart()
+{
+    RUN("config" << "paint_items" << "true", "true\n");
+
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+    const QString addItems =
+            "for (var i = 0; i < 200; ++i)"
+            "  add(new Array(i % 10 + 2).join('line ' + i + '\\n'))";
+
+    RUN(args << "eval" << addItems, "");
+    RUN("setCurrentTab" << tab, "");
+    RUN("keys" << "END", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 199 199\n");
+    RUN("keys" << "HOME", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 0 0\n");
+
+    // Don't load the tab on start so only saved heights are available.
+    RUN("setCurrentTab" << clipboardTabName, "");
+
+    // Heights of rendered items are saved with tab.
+    TEST( m_test->stopServer() );
+    const QString fileName = tabFileName(tab);
+    const auto heights = readItemHeights(fileName);
+    QVERIFY( !heights.isEmpty() );
+    QVERIFY( heights.size() <= 200 );
+    for (const auto height : heights)
+        QVERIFY( height > 0 );
+    TEST( m_test->startServer() );
+
+    // Saved heights are loaded and kept even for items which are not rendered again.
+    RUN("setCurrentTab" << tab, "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 0 0\n");
+    RUN(args << "size", "200\n");
+
+    TEST( m_test->stopServer() );
+    const auto heightsAfterRestart = readItemHeights(fileName);
+    for (auto it = heights.constBegin(); it != heights.constEnd(); ++it)
+        QCOMPARE( heightsAfterRestart.value(it.key()), it.value() );
+    TEST( m_test->startServer() );
+
+    RUN("setCurrentTab" << tab, "");
+    RUN("keys" << "END", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 199 199\n");
+    RUN("keys" << "HOME", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 0 0\n");
+}
+
 void Tests::tabRemove()
 {
     const QString tab = testTab(1);
@@ -1759,6 +2152,88 @@ void Tests::removeAllFoundItems()
     RUN("read" << "0" << "1" << "2", "b49\nb48\nb47");
 }
 
+void Tests::filterItemsInLargeTab()
+{
+    RUN("add" << "x", "");
+    RUN("eval" << "for (var i = 0; i < 2000; ++i) add(i)", "");
+    RUN("size", "2001\n");
+
+    // Match at the bottom is found in background.
+    RUN("filter" << "x", "");
+    WAIT_ON_OUTPUT("testSelected", QString(clipboardTabName) + " 2000 2000\n");
+
+    RUN("filter" << "", "");
+    RUN("filter" << "1999", "");
+    RUN("testSelected", QString(clipboardTabName) + " 1999 1999\n");
+}
+
+void Tests::filterItemsRefined()
+{
+    RUN("add" << "abc" << "ab" << "a" << "x", "");
+
+    RUN("filter" << "a", "");
+    RUN("testSelected", QString(clipboardTabName) + " 1 1\n");
+    RUN("filter" << "ab", "");
+    RUN("testSelected", QString(clipboardTabName) + " 2 2\n");
+    RUN("filter" << "abc", "");
+    RUN("testSelected", QString(clipboardTabName) + " 3 3\n");
+
+    // Previous results are restored.
+    RUN("filter" << "ab", "");
+    RUN("testSelected", QString(clipboardTabName) + " 2 2\n");
+
+    // Results are updated after items change.
+    RUN("change" << "1" << "text/plain" << "abc", "");
+    RUN("filter" << "abc", "");
+    RUN("testSelected", QString(clipboardTabName) + " 1 1\n");
+
+    // Texts for filtering are updated after items are added and removed.
+    RUN("add" << "xyz", "");
+    RUN("filter" << "xyz", "");
+    RUN("testSelected", QString(clipboardTabName) + " 0 0\n");
+    RUN("remove" << "0" << "1", "");
+    RUN("filter" << "abc", "");
+    RUN("testSelected", QString(clipboardTabName) + " 0 0\n");
+}
+
+void Tests::filterWordsInOrder()
+{
+    RUN("add" << "a foo b bar" << "bar foo" << "x", "");
+
+    RUN("filter" << "foo bar", "");
+    RUN("testSelected", QString(clipboardTabName) + " 2 2\n");
+
+    RUN("filter" << "bar foo", "");
+    RUN("testSelected", QString(clipboardTabName) + " 1 1\n");
+
+    RUN("filter" << "foo", "");
+    RUN("testSelected", QString(clipboardTabName) + " 1 1\n");
+}
+
+void Tests::searchAllTabs()
+{
+    const QString tab1 = testTab(1);
+    const QString tab2 = testTab(2);
+    RUN("tab" << tab1 << "add" << "apple pie" << "banana", "");
+    RUN("tab" << tab2 << "add" << "pineapple" << "cherry", "");
+
+    const QString script =
+            "searchAllTabs('APPLE').forEach("
+            "  function(item) { print(item.tab + ':' + item.row + '\\n') })";
+    const QString expected = tab1 + ":1\n" + tab2 + ":1\n";
+    RUN("eval" << script, expected);
+
+    // Search tabs which are not loaded.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+    RUN("eval" << script, expected);
+    RUN("eval" << "searchAllTabs(/pie$/).length", "1\n");
+
+    // Escape sequences are not literal text.
+    RUN("eval" << "searchAllTabs(/\\x41PPLE/i).length", "2\n");
+    RUN("eval" << "searchAllTabs(/\\x41/).length", "0\n");
+}
+
 void Tests::nextPrevious()
 {
     const QString tab = testTab(1);
@@ -2001,6 +2476,23 @@ void Tests::traySearch()
     WAIT_FOR_CLIPBOARD("B");
 }
 
+void Tests::traySearchIgnoresCase()
+{
+    RUN("add" << "\n\nmulti-line\ntext" << "Apple" << "banana", "");
+
+    RUN("menu", "");
+    waitFor(waitMsShow);
+    RUN("keys" << "P" << "ENTER", "");
+    WAIT_FOR_CLIPBOARD("Apple");
+
+    // Search text again after item changed.
+    RUN("change" << "1" << "text/plain" << "PINE", "");
+    RUN("menu", "");
+    waitFor(waitMsShow);
+    RUN("keys" << "i" << "ENTER", "");
+    WAIT_FOR_CLIPBOARD("PINE");
+}
+
 void Tests::trayPaste()
 {
     RUN("config" << "tray_tab_is_current" << "false", "false\n");
@@ -2170,6 +2662,49 @@ void Tests::shortcutCommandMatchCmd()
     RUN("tab" << QString(clipboardTabName) << "size", "4\n");
 }
 
+void Tests::shortcutCommandMatchCmdCached()
+{
+    const auto tab1 = testTab(1);
+    const auto logTab = testTab(2);
+    const auto failTab = testTab(3);
+
+    // Match command passes only if at least four match commands were
+    // started at the same time and no item is in failTab.
+    const auto script = QString(R"(
+        function cmd(text) {
+          return {
+            name: text,
+            inMenu: true,
+            shortcuts: ['Ctrl+F1'],
+            matchCmd: 'copyq: tab("%2"); add("' + text + '");'
+                + ' for (var i = 0; i < 100 && size() < 4; ++i) sleep(50);'
+                + ' if (size() < 4) fail();'
+                + ' tab("%3"); if (size() > 0) fail();'
+                + ' str(data(mimeText)) == "' + text + '" || fail()',
+            cmd: 'copyq: tab("%3"); var n = size(); tab("%1"); add("matched-' + text + '-" + n)'
+          }
+        }
+        setCommands([ cmd('A'), cmd('B'), cmd('C'), cmd('D'), cmd('E'), cmd('F') ])
+        )").arg(tab1, logTab, failTab);
+    RUN(script, "");
+
+    RUN("add" << "F" << "E" << "D" << "C" << "B" << "A", "");
+
+    const auto pressAndRead = QString("keys('Ctrl+F1'); tab('%1'); read(0)").arg(tab1);
+
+    // Third command is enabled only if match commands run in parallel.
+    RUN("selectItems" << "2", "true\n");
+    WAIT_ON_OUTPUT(pressAndRead, "matched-C-0");
+
+    // New results would fail.
+    RUN("tab" << failTab << "add" << "X", "");
+    RUN("selectItems" << "0", "true\n");
+
+    // Remembered result is used for the same item.
+    RUN("selectItems" << "2", "true\n");
+    WAIT_ON_OUTPUT(pressAndRead, "matched-C-1");
+}
+
 void Tests::shortcutCommandSelectedItemData()
 {
     const auto tab1 = testTab(1);
@@ -2328,11 +2863,37 @@ void Tests::automaticCommandNoOutputTab()
     RUN("tab" << QString(clipboardTabName) << "size", "0\n");
 }
 
+void Tests::automaticCommandScriptInputOutput()
+{
+    const auto tab1 = testTab(1);
+    const auto script = R"(
+        var tab1 = ')" + tab1 + R"('
+        setCommands([{
+            automatic: true, input: mimeText, output: mimeText, outputTab: tab1,
+            cmd: 'copyq: print(str(input()).toUpperCase())'
+        }])
+        )";
+    RUN(script, "");
+    TEST( m_test->setClipboard("test") );
+    WAIT_ON_OUTPUT("tab" << tab1 << "read" << "0", "TEST");
+}
+
 int Tests::run(const QStringList &arguments, QByteArray *stdoutData, QByteArray *stderrData, const QByteArray &in)
 {
     return m_test->run(arguments, stdoutData, stderrData, in);
 }
 
+QString Tests::tabFileName(const QString &tabName)
+{
+    QByteArray configFileName;
+    run(Args("info") << "config", &configFileName);
+
+    QString part( tabName.toUtf8().toBase64() );
+    part.replace( QChar('/'), QString('-') );
+    return QString::fromUtf8(configFileName).trimmed()
+            .replace( QRegExp("\\.(ini|conf)$"), "_tab_" ) + part + ".dat";
+}
+
 bool Tests::hasTab(const QString &tabName)
 {
     QByteArray out;
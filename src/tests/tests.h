@@ -54,6 +54,7 @@ private slots:
     void commandEvalThrows();
     void commandEvalSyntaxError();
     void commandEvalArguments();
+    void commandEvalIsolated();
     void commandPrint();
     void commandAbort();
     void commandFail();
@@ -107,6 +108,7 @@ private slots:
     void commandSelectItems();
 
     void commandsExportImport();
+    void commandsImportV3();
 
     void commandsGetSetCommands();
 
@@ -127,6 +129,7 @@ private slots:
     void selectItems();
 
     void moveItems();
+    void moveAndEditItems();
     void deleteItems();
     void searchItems();
     void searchRowNumber();
@@ -135,14 +138,22 @@ private slots:
     void createTabDialog();
 
     void editItems();
+    void editPaintedItems();
+    void browseImageItems();
     void createNewItem();
     void editNotes();
 
     void toggleClipboardMonitoring();
 
     void clipboardToItem();
+    void clipboardToExistingItemInLargeTab();
     void itemToClipboard();
     void tabAdd();
+    void tabChangesAfterRestart();
+    void tabBigItemsAfterRestart();
+    void tabsPreloadedAfterRestart();
+    void tabCompressedItemsAfterRestart();
+    void tabItemHeightsAfterRestart();
     void tabRemove();
     void tabIcon();
     void action();
@@ -151,6 +162,10 @@ private slots:
     void importExportTab();
 
     void removeAllFoundItems();
+    void filterItemsInLargeTab();
+    void filterItemsRefined();
+    void filterWordsInOrder();
+    void searchAllTabs();
 
     void nextPrevious();
 
@@ -166,6 +181,7 @@ private slots:
     void menu();
 
     void traySearch();
+    void traySearchIgnoresCase();
     void trayPaste();
 
     // Options for tray menu.
@@ -177,6 +193,7 @@ private slots:
     void shortcutCommandOverrideEnter();
     void shortcutCommandMatchInput();
     void shortcutCommandMatchCmd();
+    void shortcutCommandMatchCmdCached();
 
     void shortcutCommandSelectedItemData();
     void shortcutCommandSetSelectedItemData();
@@ -189,12 +206,15 @@ private slots:
     void automaticCommandSetData();
     void automaticCommandOutputTab();
     void automaticCommandNoOutputTab();
+    void automaticCommandScriptInputOutput();
 
 private:
     void clearServerErrors();
     int run(const QStringList &arguments, QByteArray *stdoutData = nullptr,
             QByteArray *stderrData = nullptr, const QByteArray &in = QByteArray());
     bool hasTab(const QString &tabName);
+    /// Return path to data file of a tab.
+    QString tabFileName(const QString &tabName);
 
     TestInterfacePtr m_test;
 };